@@ -4,8 +4,13 @@
 //
 // This sketch controls a WS2812B (NeoPixel) LED strip with support for:
 //   - Multiple animation palettes
+//   - Selectable effects (palette wave, noise, fire, twinkle)
 //   - Real-time control via potentiometer knobs (brightness, BPM, wave length scale)
-//   - Optional ultrasound distance sensor for interactive effects
+//   - Palette switching with a crossfade (button or serial command)
+//   - Frames, patterns and parameters streamed from a host over Serial
+//   - Optional microphone: the wave follows the tempo and beat of the music
+//   - Optional ultrasound distance sensors for interactive effects
+//   - Warm boot: the last palette, effect, settings and phase resume after a power cycle
 //   - Debug logging (enable via config)
 //
 // Configuration:
@@ -22,9 +27,23 @@
 //
 // File structure:
 //   - animation.*: animation logic
-//   - palette.*: color palette definitions
+//   - effects.*: effect registry (palette wave, noise, fire, twinkle)
+//   - frame_timer.*: fixed-point frame scheduling
+//   - scheduler.*: cooperative task scheduler running loop()
+//   - output.*: frame-coalescing FastLED.show() scheduling
+//   - strips.*: additional output strips (EXTRA_LED_STRIPS)
+//   - zones.*: independent zones of the main strip (ANIMATION_ZONES)
+//   - palette.*: PROGMEM palette registry and crossfade
 //   - knob.h: analog knob mapping
+//   - knob_adc.*: interrupt-driven, filtered knob sampling
 //   - ultrasound.*: distance sensor
+//   - audio.*: microphone beat tracking (AUDIO_MIC_PIN)
+//   - telemetry.*: frame-time histograms (TELEMETRY)
+//   - ram_plan.*: compile-time RAM plan, free RAM and stack headroom
+//   - persist.*: wear-levelled EEPROM record of the live state (PERSIST_STATE)
+//   - stream.*: binary serial protocol for host-driven frames
+//   - power.*: power estimation and current limiting
+//   - quality.*: adaptive interpolation resolution under load
 //   - debug.h: debug logging utilities
 //   - config.h: main configuration
 //
@@ -34,62 +53,123 @@
 #include "config.h"
 #include <FastLED.h>
 #include "animation.h"
+#include "audio.h"
+#include "effects.h"
+#include "frame_timer.h"
+#include "output.h"
+#include "power.h"
+#include "quality.h"
+#include "ram_plan.h"
+#include "scheduler.h"
+#include "strips.h"
+#include "telemetry.h"
 #include "palette.h"
+#include "persist.h"
 #include "knob.h"
+#include "knob_adc.h"
 #include "ultrasound.h"
+#include "stream.h"
+
+// Prototypes. The Arduino builder would generate these, but declaring them
+// keeps the sketch valid C++ so the host build (host/) can compile it as-is.
+void setLeds();
+void brightnessByKnob();
+void bpmByKnob();
+void waveLengthByKnob();
+void bpmByAudio();
+void brightnessByAudio();
+void handleUltrasound();
+void dimSensorSpans();
+void selectPalette(uint8_t index);
+void selectEffect(uint8_t index);
+void paletteByButton();
+void handleSerialCommands();
+void handleCommandByte(uint8_t c);
+bool handleStream();
+bool handleStreamCommand();
+void stopStreaming();
+void reportOutputStats();
+bool frameReady(unsigned long now, unsigned long& due);
+void runFrame();
+bool serialReady(unsigned long now, unsigned long& due);
+void runSerial();
+void runKnobs();
+bool audioReady(unsigned long now, unsigned long& due);
+void runAudio();
+void runRanging();
+bool patternReady(unsigned long now, unsigned long& due);
+void runPattern();
+void runPersist();
+PersistState liveState();
+void restoreState(const PersistState& saved, uint8_t& effect);
+void reportBoot();
 
 CRGB leds[NUM_LEDS];
-CRGBPalette256 currentPalette;
-TBlendType currentBlending;
+CRGBPalette16 currentPalette;
 
-// Palette array and index definitions
-const TProgmemRGBPalette16* const* gPalettes = PREDEFINED_PALETTES;  // matches extern in config.h
-const uint8_t gPaletteCount = PREDEFINED_PALETTES_COUNT;
+// Index into the palette registry (palette.h)
 uint8_t gPaletteIndex = PALETTE_INDEX;
 
 // looper is the global colorShift used to index into the virtual pattern.
 // It is incremented by 1 for each physical frame; RESOLUTION is handled as
 // a separate multiplier on the frame rate rather than baked into looper.
+// frameTimer decides when frames are due (see frame_timer.h); the output
+// stage decides when they are shown (see output.h).
 static long looper = 0;
-long stopper = millis();
-bool shouldUpdate = true;
+FrameTimer frameTimer;
+
+// True while a host streams frames (stream.h): leds[] then holds the last
+// streamed frame instead of the animation, until STREAM_TIMEOUT_MS passes
+// without a frame or the host sends the 'A' command.
+static bool streaming = false;
+static unsigned long lastStreamFrame = 0;
+static bool streamedFrame = false;  // received, to be shown and acknowledged
+
+// loop() runs these as scheduler.h tasks. The frame (advance, render, show)
+// always goes first; the rest fit in the time left before the next one.
+static const SchedTask kTasks[] = {
+  // name       run                ready            period deadline priority (µs)
+  { "frame",     runFrame,          frameReady,          0,    1000, 0 },
+  { "serial",    runSerial,         serialReady,         0,    2000, 1 },  // 64-byte UART buffer
+  { "audio",     runAudio,          audioReady,          0,   16000, 2 },  // a microphone hop; the ring holds 3
+  { "knobs",     runKnobs,          nullptr,          1000,   10000, 2 },
+  { "ranging",   runRanging,        nullptr,          5000,   20000, 3 },  // echoes are timed by interrupt
+  { "pattern",   runPattern,        patternReady,        0,   20000, 4 },  // fade and rebuild steps
+  { "persist",   runPersist,        nullptr,         10000,  100000, 5 },  // one EEPROM byte per run
+  { "telemetry", reportOutputStats, nullptr,      10000000, 1000000, 5 },
+};
+static_assert(sizeof(kTasks) / sizeof(kTasks[0]) <= kSchedMaxTasks, "raise kSchedMaxTasks");
+static bool frameShown = false;  // in this loop()
+
+// Boot timing, in µs since reset: setup() done and the first frame shown.
+static unsigned long bootSetupMicros = 0;
+static unsigned long bootFirstFrameMicros = 0;
+static bool bootFirstFrame = false;
+static bool bootRestored = false;  // state resumed from EEPROM
+
+// knob_adc.h slots of the configured knobs.
+#ifdef BRIGHTNESS_KNOB_PIN
+static uint8_t brightnessKnob;
+#endif
+#ifdef BPM_KNOB_PIN
+static uint8_t bpmKnob;
+#endif
+#ifdef WAVE_LENGTH_SCALE_KNOB_PIN
+static uint8_t waveLengthKnob;
+#endif
 
 int resolution = RESOLUTION;
 int brightness = BRIGHTNESS;
 float waveLengthScale = WAVE_LENGTH_SCALE;
 float bpm = BPM;
 
-// Calculate the delay between frames so that:
-//   - One "beat" (as defined by BPM) is the time required to step through
-//     NUM_LEDS distinct start indices in the virtual pattern.
-//   - If RESOLUTION > 1, we refresh RESOLUTION times more often, i.e. there
-//     are NUM_LEDS * RESOLUTION frames per beat.
-int calculateDelayMillis() {
-  // Frames per beat = NUM_LEDS * resolution
-  float framesPerBeat = (float)NUM_LEDS * (float)resolution;
-  // Beats per second = bpm / 60
-  float beatsPerSecond = bpm / 60.0f;
-  // Frames per second = framesPerBeat * beatsPerSecond
-  float framesPerSecond = framesPerBeat * beatsPerSecond;
-
-  if (framesPerSecond <= 0.0f) {
-    dbg::println("Animation configuration reached maximum speed or invalid BPM!");
-    return 1;
-  }
-
-  int delayMillis = (int)(1000.0f / framesPerSecond);
-  if (delayMillis < 1) {
-    dbg::println("Animation configuration reached maximum speed or invalid BPM!");
-    delayMillis = 1;
-  }
-  return delayMillis;
-}
-
-int delayMillis = calculateDelayMillis();
-
+// Level of the LEDs under each ultrasound sensor that covers part of the
+// strip (a sensor over the whole strip sets the brightness instead).
+static uint8_t sensorLevel[US_SENSOR_COUNT > 0 ? US_SENSOR_COUNT : 1];
 
 void setup() {
-  dbg::begin();
+  ramPlanSetup();
+  dbg::begin(SERIAL_BAUD);
 
   pinMode(LED_BUILTIN, OUTPUT);
   digitalWrite(LED_BUILTIN, HIGH);
@@ -98,63 +178,118 @@ void setup() {
   dbg::println("Resolution:  ");
   dbg::println(RESOLUTION);
 
-  dbg::println("delayMillis:  ");
-  dbg::println(delayMillis);
-
 #ifdef BRIGHTNESS_KNOB_PIN
   dbg::print("Using brightness knob at pin  ");
   dbg::println(BRIGHTNESS_KNOB_PIN);
+  brightnessKnob = knobAdcAdd(BRIGHTNESS_KNOB_PIN);
 #endif
 
   // Allow setting BPM by a knob
 #ifdef BPM_KNOB_PIN
   dbg::print("Using BPM knob at pin  ");
   dbg::println(BPM_KNOB_PIN);
+  bpmKnob = knobAdcAdd(BPM_KNOB_PIN);
 #endif
 
   // Allow setting wave length scale by a knob
 #ifdef WAVE_LENGTH_SCALE_KNOB_PIN
   dbg::print("Using wavelength scale knob at pin  ");
   dbg::println(WAVE_LENGTH_SCALE_KNOB_PIN);
+  waveLengthKnob = knobAdcAdd(WAVE_LENGTH_SCALE_KNOB_PIN);
 #endif
 
-  ultrasoundSetup();  // If pins are not set, it does not execute anything
+#ifdef AUDIO_MIC_PIN
+  dbg::print("Using microphone at pin  ");
+  dbg::println(AUDIO_MIC_PIN);
+#endif
+  audioSetup();
+
+  knobAdcStart();  // If no knob or microphone pins are set, it does not execute anything
 
-  delay(300);
+  // Allow switching palettes by a button
+#ifdef PALETTE_BUTTON_PIN
+  pinMode(PALETTE_BUTTON_PIN, INPUT_PULLUP);
+  dbg::print("Using palette button at pin  ");
+  dbg::println(PALETTE_BUTTON_PIN);
+#endif
 
-  uint8_t sel = (PALETTE_INDEX < PREDEFINED_PALETTES_COUNT)
-                  ? PALETTE_INDEX
-                  : 0;
-  currentPalette = *(PREDEFINED_PALETTES[sel]);
+  ultrasoundSetup();  // If pins are not set, it does not execute anything
+  memset(sensorLevel, 255, sizeof(sensorLevel));
+
+  // Resume the show of the last power cycle (persist.h), else start from
+  // the config.h defaults.
+  uint8_t effect = EFFECT_INDEX;
+  PersistState saved;
+  bootRestored = persistSetup(saved);
+  if (bootRestored) restoreState(saved, effect);
 
   FastLED.addLeds<LED_TYPE, LED_PIN, COLOR_ORDER>(leds, NUM_LEDS).setCorrection(LED_STRIP_COLOR_CORRECTION);
+  stripsSetup();  // EXTRA_LED_STRIPS, if any
+  streamSetup(leds, NUM_LEDS);
   FastLED.setBrightness(brightness);
 
-  // Set currentPalette from palette array and index
+  // Set currentPalette from the palette registry and index
   if (gPaletteIndex >= gPaletteCount) gPaletteIndex = 0;
-  currentPalette = CRGBPalette16(*gPalettes[gPaletteIndex]);
+  paletteLoad(gPaletteIndex, currentPalette);
+
+  effectSelect(effect < effectCount() ? effect : 0, waveLengthScale);
 
   // Build initial virtual LED buffer based on starting waveLengthScale/resolution
   RebuildVirtualLeds(waveLengthScale, resolution);
 
+  qualitySetup(resolution);
+  outputSetup(setLeds, brightness);
+  outputRenderScalesBrightness(effectScalesBrightness());
+
+  // Start the frame clock last so setup time does not count as skipped frames.
+  frameTimerStart(frameTimer, bpm, resolution, micros());
+  dbg::println("Frame period (us):  ");
+  dbg::println(frameTimer.periodMicros);
+  schedulerSetup(kTasks, sizeof(kTasks) / sizeof(kTasks[0]));
+
+  if (dbg::enabled) ramPlanReport();
   dbg::println("Controller setup completed");
+  bootFirstFrame = false;
+  bootSetupMicros = micros();
 }
 
 void loop() {
-  handleUltrasound();  // If pins are not set, this function does nothing
+  tel::Timer loopTimer;
+  frameShown = false;
+  schedulerRun();
+  loopTimer.stop(frameShown ? tel::Probe::Frame : tel::Probe::Idle);
+}
+
+// Frame task: due at every frame boundary, and whenever the output stage
+// has something to show (a new pattern, a brightness change, a streamed
+// frame).
+bool frameReady(unsigned long now, unsigned long& due) {
+  if (frameTimer.rateDivisor != 0) {
+    due = frameTimer.nextDue;
+    if ((long)(now - due) >= 0) return true;
+  }
+  if (streaming) return streamedFrame;
+  return (!streamBusy() || streamLedsIntact()) && outputPending(now);
+}
 
-  long now = millis();
-  long elapsed = now - stopper;
+void runFrame() {
+  const unsigned long start = micros();
+  long expectedFrames = frameTimerAdvance(frameTimer, start);
 
-  if (elapsed >= delayMillis) {
-    long expectedFrames = elapsed / delayMillis;
+  if (expectedFrames > 0) {
     int missedFrames = (int)expectedFrames - 1;
 
     // Advance looper by the number of frames we conceptually rendered.
+    // Sub-frames the quality level leaves out keep the previous key and
+    // are dropped by the output stage.
     looper += expectedFrames;
-    shouldUpdate = true;
+    if (!streaming) {
+      outputMarkFrame(effectRenderKey(qualityFrame(looper), resolution, waveLengthScale));
+    }
 
     if (missedFrames > 0) {
+      qualityNoteSkipped(missedFrames);
+      tel::missedFrames(missedFrames);
       dbg::print("[ANIMATION] Skipped frames: ");
       dbg::print(missedFrames);
       dbg::print(", ");
@@ -164,6 +299,55 @@ void loop() {
     }
   }
 
+  // Everything else only marks what changed; this is the single place
+  // that renders and calls FastLED.show().
+  if (streaming) {
+    // Show only right after a frame, while the host waits for the ACK: on
+    // AVR show() blocks interrupts and would drop bytes of the next frame.
+    if (streamedFrame) {
+      frameShown = outputUpdate(micros());
+      streamAck();
+      streamedFrame = false;
+    }
+  } else if (!streamBusy() || streamLedsIntact()) {  // not while a frame is half received
+    frameShown = outputUpdate(micros());
+    if (frameShown && !bootFirstFrame) {
+      bootFirstFrame = true;
+      bootFirstFrameMicros = micros();
+      if (dbg::enabled) reportBoot();
+    }
+    if (frameShown && qualityRecord(micros() - start, frameTimer.periodMicros)) {
+      dbg::print("[QUALITY] Level ");
+      dbg::print(qualityLevel());
+      dbg::print(", rendering every ");
+      dbg::print(qualityStep());
+      dbg::println(". sub-frame");
+      tel::quality(qualityLevel(), qualityStep());
+    }
+  }
+}
+
+// Serial task: while bytes wait, a packet is half received, or streaming
+// (to notice the host going quiet).
+bool serialReady(unsigned long, unsigned long&) {
+  if (SERIAL_STREAMING) {
+    return streaming || streamBusy() || Serial.available() > 0;
+  }
+  return SERIAL_COMMANDS && Serial.available() > 0;
+}
+
+void runSerial() {
+  if (SERIAL_STREAMING) {
+    streamedFrame = handleStream() || streamedFrame;
+  } else if (SERIAL_COMMANDS) {
+    handleSerialCommands();
+  }
+}
+
+void runKnobs() {
+  tel::Timer knobTimer;
+  knobAdcPoll();  // only samples on boards without the ADC interrupt
+
   // Allow setting brightness by a knob
 #ifdef BRIGHTNESS_KNOB_PIN
   brightnessByKnob();
@@ -179,22 +363,143 @@ void loop() {
   waveLengthByKnob();
 #endif
 
-  if (shouldUpdate) {
-    setLeds();
-    stopper = now;
-    shouldUpdate = false;
+  // Allow switching palettes by a button
+#ifdef PALETTE_BUTTON_PIN
+  paletteByButton();
+#endif
+
+  knobTimer.stop(tel::Probe::Knobs);
+}
+
+// Audio task: one microphone hop through the beat tracker (audio.h), then
+// the frame rate and brightness follow it.
+bool audioReady(unsigned long, unsigned long&) {
+  return audioPending();
+}
+
+void runAudio() {
+  tel::Timer audioTimer;
+  if (!audioProcess()) return;
+  audioTimer.stop(tel::Probe::Audio);
+  bpmByAudio();
+  brightnessByAudio();
+}
+
+void runRanging() {
+  tel::Timer sensorTimer;
+  handleUltrasound();  // If pins are not set, this function does nothing
+  sensorTimer.stop(tel::Probe::Sensor);
+}
+
+// Persist task: saves the live settings and phase to EEPROM when due.
+void runPersist() {
+  persistUpdate(liveState(), millis());
+}
+
+PersistState liveState() {
+  PersistState state;
+  state.palette = gPaletteIndex;
+  state.effect = effectIndex();
+  state.brightness = (uint8_t)constrain(brightness, 0, 255);
+  state.centiBpm = (uint16_t)(bpm * 100.0f + 0.5f);
+  state.milliWave = (uint16_t)(waveLengthScale * 1000.0f + 0.5f);
+  state.phase = (uint32_t)looper;
+  return state;
+}
+
+// Applies a restored state in setup(), before the palette and the pattern
+// are built; values the build no longer accepts keep their defaults.
+void restoreState(const PersistState& saved, uint8_t& effect) {
+  if (saved.palette < gPaletteCount) gPaletteIndex = saved.palette;
+  effect = saved.effect;
+  brightness = constrain(saved.brightness, BRIGHTNESS_MIN, BRIGHTNESS_MAX);
+  if (saved.centiBpm > 0) bpm = constrain(saved.centiBpm / 100.0f, BPM_MIN, BPM_MAX);
+  if (saved.milliWave > 0) waveLengthScale = constrain(saved.milliWave / 1000.0f, (float)WAVE_LENGTH_SCALE_MIN, kPlanWaveLengthScaleMax);
+  looper = (long)saved.phase;
+  dbg::print("[BOOT] Resumed palette ");
+  dbg::print(gPaletteIndex);
+  dbg::print(", effect ");
+  dbg::print(effect);
+  dbg::print(", brightness ");
+  dbg::print(brightness);
+  dbg::print(", BPM ");
+  dbg::print(bpm);
+  dbg::print(", wave length scale ");
+  dbg::print(waveLengthScale);
+  dbg::print(", phase ");
+  dbg::println(looper);
+}
+
+// [BOOT] setup=<µs> first_frame=<µs> restored=<0|1> saves=<records written>
+// (times since reset; first_frame=0 until a frame was shown)
+void reportBoot() {
+  Serial.print("[BOOT] setup=");
+  Serial.print(bootSetupMicros);
+  Serial.print(" first_frame=");
+  Serial.print(bootFirstFrame ? bootFirstFrameMicros : 0UL);
+  Serial.print(" restored=");
+  Serial.print(bootRestored ? 1 : 0);
+  Serial.print(" saves=");
+  Serial.println((unsigned int)persistSaves());
+}
+
+// Pattern task: palette crossfade and background rebuild steps.
+bool patternReady(unsigned long, unsigned long&) {
+  return paletteFadeActive() || VirtualLedsRebuildPending();
+}
+
+void runPattern() {
+  // One slice of the palette per run, and a new pass only once the pattern
+  // of the previous one is on the strip, so a fade never piles more than a
+  // slice and a rebuild step onto one run.
+  if (!VirtualLedsRebuildPending() && paletteFadeStep(PALETTE_FADE_ENTRIES_PER_STEP)) {
+    RequestVirtualLedsRebuild(waveLengthScale);
+  }
+
+  // Continue a background pattern rebuild; show it as soon as it is done.
+  if (StepVirtualLedsRebuild(VIRTUAL_LEDS_REBUILD_STEP)) {
+    outputMarkDirty(OUTPUT_DIRTY_PATTERN);
   }
 }
 
+// Render callback of the output stage: fills leds[] without showing.
 void setLeds() {
-  // Always render from the precomputed virtual buffer.
-  FillLEDsFromPaletteColors(looper, resolution, waveLengthScale);
-  FastLED.show();
+  if (streaming) {
+    // leds[] holds the streamed frame
+    if (kPowerEstimate) outputSetLoad(powerLedsLoad());
+    return;
+  }
+
+  // The wave's load is read from the pattern before rendering, as the
+  // high-precision render needs the limited brightness up front; other
+  // effects are measured once rendered.
+  const long frame = qualityFrame(looper);
+  uint32_t load = 0;
+  bool loadKnown = kPowerEstimate && effectFrameLoad(frame, resolution, waveLengthScale, load);
+  if (loadKnown) outputSetLoad(load);
+  SetRenderBrightness(outputShowBrightness());  // high-precision render only
+  effectRender(frame, resolution, waveLengthScale);
+  dimSensorSpans();
+  if (kPowerEstimate && !loadKnown) outputSetLoad(powerLedsLoad());
+}
+
+// Telemetry task, every 10 s.
+void reportOutputStats() {
+  if (!dbg::enabled) return;
+
+  const OutputStats& stats = outputStats();
+  dbg::print("[OUTPUT] Shows: ");
+  dbg::print(stats.shows);
+  dbg::print(", coalesced: ");
+  dbg::print(stats.coalesced);
+  dbg::print(", skipped: ");
+  dbg::println(stats.skipped);
 }
 
 void brightnessByKnob() {
 #ifdef BRIGHTNESS_KNOB_PIN
-  int newBrightness = calculateKnobValueForPin<int>(BRIGHTNESS_KNOB_PIN, BRIGHTNESS_MIN, BRIGHTNESS_MAX, 0, KNOB_5V);
+  if (!knobAdcReady(brightnessKnob)) return;  // no reading yet
+  int newBrightness = mapKnobReading<int>(knobAdcRead(brightnessKnob), BRIGHTNESS_MIN, BRIGHTNESS_MAX, 0, KNOB_5V);
   if (abs(brightness - newBrightness) > BRIGHTNESS_CHANGE_THRESHOLD) {
     if (newBrightness <= BRIGHTNESS_CHANGE_THRESHOLD) { newBrightness = 0; }  // if brightness is below threshold, set it to 0
     dbg::print("[ANIMATION] Brightness changed from ");
@@ -202,64 +507,329 @@ void brightnessByKnob() {
     dbg::print(" to ");
     dbg::println(newBrightness);
     brightness = newBrightness;
-    FastLED.setBrightness(brightness);
-    FastLED.show();
+    outputSetBrightness(brightness);
   }
 #endif  // BRIGHTNESS_KNOB_PIN
 }
 
 void bpmByKnob() {
 #ifdef BPM_KNOB_PIN
-  float newBPM = calculateKnobValueForPin<float>(BPM_KNOB_PIN, BPM_MIN, BPM_MAX, 0, KNOB_5V);
+  if (!knobAdcReady(bpmKnob)) return;  // no reading yet
+  float newBPM = mapKnobReading<float>(knobAdcRead(bpmKnob), BPM_MIN, BPM_MAX, 0, KNOB_5V);
   if (abs(bpm - newBPM) > BPM_CHANGE_THRESHOLD) {  // add threshold to avoid flickering
     dbg::print("[ANIMATION] BPM changed from ");
     dbg::print(bpm);
     dbg::print(" to ");
     dbg::println(newBPM);
     bpm = newBPM;
-    delayMillis = calculateDelayMillis();
+    frameTimerSetRate(frameTimer, bpm, resolution, micros());
   }
 #endif  // BPM_KNOB_PIN
 }
 
+// While a beat is tracked the frame rate follows it: one wave cycle per
+// AUDIO_BEATS_PER_WAVE beats, nudged so that the beats fall on the same
+// wave positions. Once the beat is lost the rate goes back to `bpm`.
+void bpmByAudio() {
+#if AUDIO_ENABLED
+  static bool following = false;
+  const uint32_t milliBpm = audioMilliBpm();
+  if (milliBpm == 0) {
+    if (following) {
+      following = false;
+      dbg::println("[AUDIO] Beat lost");
+      frameTimerSetRate(frameTimer, bpm, resolution, micros());
+    }
+    return;
+  }
+  if (!following) {
+    following = true;
+    dbg::print("[AUDIO] Beat found at BPM ");
+    dbg::println(milliBpm / 1000.0f);
+  }
+
+  // Position in the current beat of the wave and of the music, in 1/65536
+  // beat; the music ahead (positive error) speeds the wave up, by up to a
+  // quarter.
+  const unsigned long now = micros();
+  const long cycle = (long)NUM_LEDS * resolution;
+  const long inBeat = (looper % cycle) * AUDIO_BEATS_PER_WAVE % cycle;
+  const uint16_t wavePhase = (uint16_t)(((uint64_t)inBeat << 16) / cycle);
+  const int16_t error = (int16_t)(audioBeatPhase(now) - wavePhase);
+  const float target = milliBpm / (1000.0f * AUDIO_BEATS_PER_WAVE) * (1.0f + error / 131072.0f);
+  frameTimerSetRate(frameTimer, target, resolution, now);
+#endif  // AUDIO_ENABLED
+}
+
+// Full brightness on the loudest bass, dimmed by up to
+// AUDIO_BRIGHTNESS_DEPTH as it gets quieter.
+void brightnessByAudio() {
+#if AUDIO_ENABLED
+  if (AUDIO_BRIGHTNESS_DEPTH == 0) return;
+  const uint8_t dim = scale8(AUDIO_BRIGHTNESS_DEPTH, 255 - audioBandLevel(0));
+  outputSetBrightness(brightness - scale8((uint8_t)brightness, dim));
+#endif  // AUDIO_ENABLED
+}
+
 void waveLengthByKnob() {
 #ifdef WAVE_LENGTH_SCALE_KNOB_PIN
-  float newWaveLengthScale = calculateKnobValueForPin<float>(WAVE_LENGTH_SCALE_KNOB_PIN, WAVE_LENGTH_SCALE_MIN, WAVE_LENGTH_SCALE_MAX, 0, KNOB_5V);
+  if (!knobAdcReady(waveLengthKnob)) return;  // no reading yet
+  float newWaveLengthScale = mapKnobReading<float>(knobAdcRead(waveLengthKnob), WAVE_LENGTH_SCALE_MIN, kPlanWaveLengthScaleMax, 0, KNOB_5V);
   if (abs(waveLengthScale - newWaveLengthScale) > WAVE_LENGTH_SCALE_CHANGE_THRESHOLD) {  // add threshold to avoid flickering
     dbg::print("[ANIMATION] Wave length scale changed from ");
     dbg::print(waveLengthScale);
     dbg::print(" to ");
     dbg::println(newWaveLengthScale);
     waveLengthScale = newWaveLengthScale;
-    // Rebuild virtual buffer to reflect new wave length scale.
-    RebuildVirtualLeds(waveLengthScale, resolution);
-    setLeds();
+    // Rebuild virtual buffer to reflect new wave length scale. It is built
+    // in the background over the next loops and swapped in between frames.
+    effectRebuild(waveLengthScale);
   }
 #endif  // WAVE_LENGTH_SCALE_KNOB_PIN
 }
 
+// Starts a crossfade to registry palette `index`; out of range is ignored.
+void selectPalette(uint8_t index) {
+  if (index >= gPaletteCount) return;
+  dbg::print("[ANIMATION] Palette changed from ");
+  dbg::print(gPaletteIndex);
+  dbg::print(" to ");
+  dbg::println(index);
+  gPaletteIndex = index;
+  CRGBPalette16 target;
+  paletteLoad(gPaletteIndex, target);
+  paletteFadeTo(target);
+}
+
+// Switches to effects.h effect `index`; out of range is ignored.
+void selectEffect(uint8_t index) {
+  uint8_t previous = effectIndex();
+  if (!effectSelect(index, waveLengthScale)) return;
+  dbg::print("[ANIMATION] Effect changed from ");
+  dbg::print(effectName(previous));
+  dbg::print(" to ");
+  dbg::println(effectName(index));
+  if (!streaming) {
+    outputRenderScalesBrightness(effectScalesBrightness());
+  }
+  outputMarkDirty(OUTPUT_DIRTY_PATTERN);
+}
+
+void paletteByButton() {
+#ifdef PALETTE_BUTTON_PIN
+  // Button to GND: LOW while pressed. A press counts once the level has
+  // been stable for PALETTE_BUTTON_DEBOUNCE_MS.
+  static bool pressed = false;
+  static bool lastLevel = HIGH;
+  static unsigned long lastChange = 0;
+
+  bool level = digitalRead(PALETTE_BUTTON_PIN);
+  unsigned long now = millis();
+  if (level != lastLevel) {
+    lastLevel = level;
+    lastChange = now;
+    return;
+  }
+  if (now - lastChange < PALETTE_BUTTON_DEBOUNCE_MS || pressed == (level == LOW)) return;
+
+  pressed = (level == LOW);
+  if (pressed) {
+    selectPalette((gPaletteIndex + 1) % gPaletteCount);
+  }
+#endif  // PALETTE_BUTTON_PIN
+}
+
+// Single-character commands on Serial:
+//   '0'..'9'  crossfade to that palette
+//   'n' / 'p' next / previous palette
+//   'e'       next effect
+//   't' / 'T' print / clear telemetry and scheduler statistics (and print the
+//             RAM plan and readings; TELEMETRY builds); 't' also prints the
+//             boot timing
+void handleSerialCommands() {
+  while (Serial.available() > 0) {
+    handleCommandByte((uint8_t)Serial.read());
+  }
+}
+
+void handleCommandByte(uint8_t c) {
+  if (!SERIAL_COMMANDS) return;
+
+  if (c >= '0' && c <= '9') {
+    selectPalette((uint8_t)(c - '0'));
+  } else if (c == 'n') {
+    selectPalette((gPaletteIndex + 1) % gPaletteCount);
+  } else if (c == 'p') {
+    selectPalette((gPaletteIndex + gPaletteCount - 1) % gPaletteCount);
+  } else if (c == 'e') {
+    selectEffect((effectIndex() + 1) % effectCount());
+  } else if (c == 't') {
+    reportBoot();
+    tel::report();
+    if (tel::enabled) {
+      schedulerReport();
+      ramPlanReport();
+    }
+  } else if (c == 'T') {
+    tel::reset();
+    if (tel::enabled) schedulerResetStats();
+  }
+}
+
+// Serial input with SERIAL_STREAMING: packets and Adalight frames (see
+// stream.h). While animating, bytes between packets are still taken as
+// single-character commands; while streaming they are dropped. Returns true
+// when a frame arrived, to be shown and then acknowledged.
+bool handleStream() {
+  unsigned long now = millis();
+  switch (streamPoll(STREAM_BYTES_PER_LOOP, now, streaming ? nullptr : handleCommandByte)) {
+    case StreamEvent::Frame:
+      if (!streaming) {
+        dbg::println("[STREAM] Streaming started");
+        streaming = true;
+        outputRenderScalesBrightness(false);  // streamed frames are scaled by FastLED
+      }
+      lastStreamFrame = now;
+      outputMarkDirty(OUTPUT_DIRTY_PATTERN);
+      return true;
+    case StreamEvent::Pattern:
+      streamAck();  // shown from the next animation frame on
+      break;
+    case StreamEvent::Command:
+      if (handleStreamCommand()) {
+        streamAck();
+      } else {
+        streamNak();
+      }
+      break;
+    case StreamEvent::Error:
+      streamNak();
+      if (!streaming) {
+        outputMarkDirty(OUTPUT_DIRTY_PATTERN);  // leds[] may hold part of a frame
+      }
+      break;
+    case StreamEvent::None:
+      break;
+  }
+  if (streaming && now - lastStreamFrame > STREAM_TIMEOUT_MS) {
+    stopStreaming();
+  }
+  return false;
+}
+
+// Commands in stream packets: a command byte and big-endian arguments.
+//   'B' u8          brightness
+//   'S' u16         BPM x 100
+//   'W' u16         wave length scale x 1000
+//   'P' u8          crossfade to that palette
+//   'L' 16 x RGB    crossfade to this palette
+//   'E' u8          switch to that effect
+//   'A'             resume the animation now
+// Values are held to the same limits as the knobs and restoreState().
+// Returns false for an unknown command or wrong arguments.
+bool handleStreamCommand() {
+  uint8_t length;
+  const uint8_t* cmd = streamCommand(length);
+  uint16_t arg = length == 3 ? ((uint16_t)cmd[1] << 8) | cmd[2] : 0;
+  switch (cmd[0]) {
+    case 'B':
+      if (length != 2) return false;
+      brightness = constrain(cmd[1], BRIGHTNESS_MIN, BRIGHTNESS_MAX);
+      outputSetBrightness(brightness);
+      return true;
+    case 'S':
+      if (arg == 0) return false;
+      bpm = constrain(arg / 100.0f, BPM_MIN, BPM_MAX);
+      frameTimerSetRate(frameTimer, bpm, resolution, micros());
+      return true;
+    case 'W':
+      if (arg == 0) return false;
+      waveLengthScale = constrain(arg / 1000.0f, (float)WAVE_LENGTH_SCALE_MIN, kPlanWaveLengthScaleMax);
+      effectRebuild(waveLengthScale);
+      return true;
+    case 'P':
+      if (length != 2 || cmd[1] >= gPaletteCount) return false;
+      selectPalette(cmd[1]);
+      return true;
+    case 'L': {
+      if (length != 1 + 16 * 3) return false;
+      CRGBPalette16 palette;
+      for (uint8_t i = 0; i < 16; ++i) {
+        palette[i] = CRGB(cmd[1 + 3 * i], cmd[2 + 3 * i], cmd[3 + 3 * i]);
+      }
+      paletteFadeTo(palette);
+      return true;
+    }
+    case 'E':
+      if (length != 2 || cmd[1] >= effectCount()) return false;
+      selectEffect(cmd[1]);
+      return true;
+    case 'A':
+      if (length != 1) return false;
+      if (streaming) stopStreaming();
+      return true;
+  }
+  return false;
+}
+
+void stopStreaming() {
+  dbg::println("[STREAM] Streaming stopped");
+  streaming = false;
+  outputRenderScalesBrightness(effectScalesBrightness());
+  outputMarkDirty(OUTPUT_DIRTY_PATTERN);  // back to the animation
+}
+
 void handleUltrasound() {
   // If pins are not set, this function does nothing
   ultrasoundUpdate();
 
-  if (ultrasoundHasReading()) {  // thread blocking check
-    float cm = ultrasoundRead_cm();
+  for (uint8_t sensor = 0; sensor < US_SENSOR_COUNT; ++sensor) {
+    if (!ultrasoundHasReading(sensor)) continue;  // thread blocking check
+    float cm = ultrasoundRead_cm(sensor);
     // dbg::print("[US] ");
     // dbg::println(cm);
+    if (cm >= (US_MAX_DISTANCE_CM + 10)) continue;  // ensure that measuers out of the "useful" range are not consumed
+
+    long first, count;
+    ultrasoundSpan(sensor, first, count);
+    if (first <= 0 && count >= NUM_LEDS) {
+      /* example: map 3-30 cm to brightness 0-255 */
+      int newBright = constrain(
+        map((int)cm, US_MIN_DISTANCE_CM, US_MAX_DISTANCE_CM, BRIGHTNESS_MAX, BRIGHTNESS_MIN),
+        BRIGHTNESS_MIN, BRIGHTNESS_MAX);
+
+      if (abs(newBright - brightness) > BRIGHTNESS_CHANGE_THRESHOLD) {
+        dbg::print("[ANIMATION] Brightness changed from ");
+        dbg::print(brightness);
+        dbg::print(" to ");
+        dbg::println(newBright);
+        brightness = newBright;
+        outputSetBrightness(brightness);
+      }
+      continue;
+    }
 
-    /* example: map 3-30 cm to brightness 0-255 */
-    int newBright = constrain(
-      map((int)cm, US_MIN_DISTANCE_CM, US_MAX_DISTANCE_CM, BRIGHTNESS_MAX, BRIGHTNESS_MIN),
-      BRIGHTNESS_MIN, BRIGHTNESS_MAX);
-
-    if (abs(newBright - brightness) > BRIGHTNESS_CHANGE_THRESHOLD && cm < (US_MAX_DISTANCE_CM + 10)) {  // ensure that measuers out of the "useful" range are not consumed
-      dbg::print("[ANIMATION] Brightness changed from ");
-      dbg::print(brightness);
-      dbg::print(" to ");
-      dbg::println(newBright);
-      brightness = newBright;
-      FastLED.setBrightness(brightness);
-      FastLED.show();
+    // A sensor over part of the strip dims only its LEDs.
+    int newLevel = constrain(map((int)cm, US_MIN_DISTANCE_CM, US_MAX_DISTANCE_CM, 255, 0), 0, 255);
+    if (abs(newLevel - sensorLevel[sensor]) > BRIGHTNESS_CHANGE_THRESHOLD) {
+      dbg::print("[US] Sensor ");
+      dbg::print(sensor);
+      dbg::print(" level ");
+      dbg::println(newLevel);
+      sensorLevel[sensor] = (uint8_t)newLevel;
+      outputMarkDirty(OUTPUT_DIRTY_PATTERN);
     }
   }
 }
+
+// Scales the LEDs under each partial-strip ultrasound sensor by its level.
+void dimSensorSpans() {
+  for (uint8_t sensor = 0; sensor < US_SENSOR_COUNT; ++sensor) {
+    if (sensorLevel[sensor] == 255) continue;
+    long first, count;
+    ultrasoundSpan(sensor, first, count);
+    first = constrain(first, 0L, (long)NUM_LEDS);
+    count = constrain(count, 0L, (long)NUM_LEDS - first);
+    nscale8_video(leds + first, (uint16_t)count, sensorLevel[sensor]);
+  }
+}
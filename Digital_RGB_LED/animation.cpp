@@ -1,86 +1,223 @@
 #include "animation.h"
 #include "config.h"
 #include <FastLED.h>
-#include <ctype.h>
 #include "palette.h"
+#include "power.h"
+#include "ram_plan.h"
+#include "strips.h"
 
 // Global virtual LED buffer and its length.
-CRGB* gVirtualLeds = nullptr;
+VirtualPixel* gVirtualLeds = nullptr;
 long gVirtualLedCount = 0;
 
-// Compute how many physical sections are actively rendered before mirroring.
-static long normalizedFoldCount() {
-  long folds = ANIMATION_PARTS;
-  if (folds < 1) {
-    folds = 1;
+// Number of sections the strip is split into (ANIMATION_PARTS, at least 1).
+static constexpr long kFoldCount = (ANIMATION_PARTS < 1) ? 1 : ANIMATION_PARTS;
+
+// LEDs in one independent section; ceil division keeps all LEDs covered.
+static constexpr long kIndependentLedCount = stripSectionLength(NUM_LEDS, kFoldCount);
+
+// ANIMATION_PARTS_TYPE, parsed once by the compiler.
+static constexpr PartsType kPartsType = parsePartsType(ANIMATION_PARTS_TYPE);
+static_assert(kPartsType != PartsType::Unknown, "ANIMATION_PARTS_TYPE must be \"FOLDED\" or \"CUT\"");
+
+static_assert(!(RENDER_DIRECT_PALETTE && RENDER_HIGH_PRECISION),
+              "RENDER_HIGH_PRECISION renders from the pattern buffer; disable RENDER_DIRECT_PALETTE");
+
+// Longest virtual pattern the arena holds, from the RAM plan (ram_plan.h):
+// the independent section at WAVE_LENGTH_SCALE_MAX, capped by
+// VIRTUAL_LEDS_MAX.
+static constexpr long kVirtualLedCapacity = kPlanPatternPixels;
+
+// Two statically allocated pattern slots: the front one is rendered from
+// (gVirtualLeds), the back one receives rebuilds. No heap is involved, so a
+// rebuild can neither fragment memory nor fail. The direct palette mode
+// renders without a pattern, so the arena shrinks to a placeholder.
+static VirtualPixel gVirtualArena[2][kPlanPatternSlot];
+static uint8_t gFrontSlot = 0;
+
+// The direct palette mode renders from the palette expanded to its 256
+// indices instead: a table read per pixel rather than a paletteSample().
+// Every palette change reaches the renderer through a rebuild, which
+// refreshes the table. A placeholder in buffered builds.
+static CRGB gPaletteTable[kPlanPaletteTable];
+
+// State of the rebuild in progress in the back slot.
+static long gBackLedCount = 0;   // target pattern length
+static long gBackFilled = 0;     // pixels generated so far
+static bool gBackPending = false;  // a rebuild has been requested
+static bool gBackReady = false;    // back slot is complete, waiting for a frame boundary
+static bool gUploadOpen = false;   // back slot handed out by BeginVirtualLedsUpload()
+static uint16_t gPatternVersion = 0;  // bumped on every swap, see FrameRenderKey()
+
+// Load (power.h) of each slot's pattern, for FrameLoad(): gPatternLoad[slot][k]
+// is the load of pixels [0, k * kLoadBlock), gPatternLoadTotal[slot] that of
+// the whole pattern. Built along with the pattern; a sum per block rather
+// than per pixel keeps it at half a byte per pattern pixel.
+static constexpr bool kPatternLoad = kPlanPatternLoad;
+static constexpr long kLoadBlock = kPlanLoadBlock;
+static uint32_t gPatternLoad[2][kPlanLoadSums];
+static uint32_t gPatternLoadTotal[2];
+static uint32_t gBackLoad = 0;  // load of the back slot pixels generated so far
+static void accumulateBackLoad(long begin, long end);
+
+// Pattern length for a wave length scale: the independent LED count so
+// animations shrink with ANIMATION_PARTS and then mirror/copy across sections.
+static long patternLengthForScale(float waveLengthScale) {
+  if (waveLengthScale <= 0.0f) {
+    waveLengthScale = 1.0f;
   }
-  return folds;
+  float rawLength = (float)kIndependentLedCount * waveLengthScale;
+  long patternSize = (long)(rawLength + 0.5f);
+  if (patternSize < 1) patternSize = 1;  // at least one virtual pixel
+  return patternSize;
 }
 
-static long getIndependentLedCount() {
-  long folds = normalizedFoldCount();
-  long unique = (NUM_LEDS + folds - 1) / folds;  // ceil division keeps all LEDs covered
-  if (unique < 1) {
-    unique = 1;
+// Same, limited to what the arena can hold. The direct palette mode keeps
+// no pattern, so it has no limit.
+static long patternSizeForScale(float waveLengthScale) {
+  long patternSize = patternLengthForScale(waveLengthScale);
+  if (!RENDER_DIRECT_PALETTE && patternSize > kVirtualLedCapacity) {
+    patternSize = kVirtualLedCapacity;
   }
-  return unique;
+  return patternSize;
 }
 
-// Map a logical LED index into the canonical (independent) section, mirroring derived folds.
-static long canonicalIndexForLed(long ledIndex, long canonicalLen);
-
-static bool equalsIgnoreCase(const char* lhs, const char* rhs) {
-  if (!lhs || !rhs) {
-    return false;
+// Pattern pixels [begin, end) of a pattern of `count` pixels. One overload
+// per VirtualPixel type; a build uses only one of them.
+[[maybe_unused]] static void fillPattern(CRGB* pattern, long begin, long end, long count) {
+  for (long i = begin; i < end; ++i) {
+    uint8_t paletteIndex = (uint8_t)((i * 256L) / count);
+    pattern[i] = paletteSample(currentPalette, paletteIndex);
   }
-  while (*lhs && *rhs) {
-    char lc = (char)tolower(*lhs++);
-    char rc = (char)tolower(*rhs++);
-    if (lc != rc) {
-      return false;
-    }
+}
+
+// 16-bit linear interpolation from a towards b by f / 256.
+static inline uint16_t lerp16(uint16_t a, uint16_t b, uint8_t f) {
+  return (b >= a) ? (uint16_t)(a + (((uint32_t)(b - a) * f) >> 8))
+                  : (uint16_t)(a - (((uint32_t)(a - b) * f) >> 8));
+}
+
+// 16-bit pattern: the palette position is kept in 8.8 fixed point and the
+// colour interpolated between neighbouring palette indices (the last one
+// towards the first, as the pattern wraps), so long waves get gradations
+// finer than the 256 palette indices.
+[[maybe_unused]] static void fillPattern(CRGB16* pattern, long begin, long end, long count) {
+  for (long i = begin; i < end; ++i) {
+    uint16_t position = (uint16_t)((i * 65536L) / count);
+    uint8_t index = (uint8_t)(position >> 8);
+    uint8_t frac = (uint8_t)position;
+    const CRGB a = paletteSample(currentPalette, index);
+    const CRGB b = paletteSample(currentPalette, (uint8_t)(index + 1));
+    pattern[i].r = lerp16(a.r * 257, b.r * 257, frac);
+    pattern[i].g = lerp16(a.g * 257, b.g * 257, frac);
+    pattern[i].b = lerp16(a.b * 257, b.b * 257, frac);
   }
-  return (*lhs == '\0' && *rhs == '\0');
 }
 
-static bool partsTypeIsFolded() {
-  return equalsIgnoreCase(ANIMATION_PARTS_TYPE, "FOLDED");
+// Makes a completed back slot the front one. Only called between frames.
+static void swapVirtualLeds() {
+  gFrontSlot ^= 1;
+  gVirtualLeds = RENDER_DIRECT_PALETTE ? nullptr : gVirtualArena[gFrontSlot];
+  gVirtualLedCount = gBackLedCount;
+  gBackReady = false;
+  ++gPatternVersion;
 }
 
-static long canonicalIndexForLed(long ledIndex, long canonicalLen) {
-  if (canonicalLen <= 0) {
-    return 0;
+void RequestVirtualLedsRebuild(float waveLengthScale) {
+  gBackLedCount = patternSizeForScale(waveLengthScale);
+  gBackFilled = 0;
+  gBackPending = true;
+  gBackReady = false;
+  gUploadOpen = false;
+}
+
+bool StepVirtualLedsRebuild(long maxPixels) {
+  if (!gBackPending) {
+    return false;
   }
-  long folds = normalizedFoldCount();
-  if (folds <= 1) {
-    return ledIndex;
+  if (RENDER_DIRECT_PALETTE) {
+    // No pattern, so the new length applies from the next frame; the
+    // palette table is refreshed instead, maxPixels entries per call.
+    long end = gBackFilled + maxPixels;
+    if (end > kPlanPaletteTable) {
+      end = kPlanPaletteTable;
+    }
+    for (long i = gBackFilled; i < end; ++i) {
+      gPaletteTable[i] = paletteSample(currentPalette, (uint8_t)i);
+    }
+    gBackFilled = end;
+    if (gBackFilled < kPlanPaletteTable) {
+      return false;
+    }
+    gBackPending = false;
+    gBackReady = true;
+    return true;
   }
-  long section = ledIndex / canonicalLen;
-  if (section >= folds) {
-    section = folds - 1;
+
+  // Populate the virtual pattern from the current palette.
+  // We map the virtual index linearly into the 0-255 palette index space.
+  VirtualPixel* back = gVirtualArena[gFrontSlot ^ 1];
+  long end = gBackFilled + maxPixels;
+  if (end > gBackLedCount) {
+    end = gBackLedCount;
   }
-  long sectionOffset = ledIndex % canonicalLen;
-  if (!partsTypeIsFolded()) {
-    return sectionOffset;
+  fillPattern(back, gBackFilled, end, gBackLedCount);
+  accumulateBackLoad(gBackFilled, end);
+  gBackFilled = end;
+
+  if (gBackFilled < gBackLedCount) {
+    return false;
   }
-  bool mirrorSection = (section % 2 == 1);
-  if (!mirrorSection) {
-    return sectionOffset;
+  gBackPending = false;
+  gBackReady = true;
+  return true;
+}
+
+bool VirtualLedsRebuildPending() {
+  return gBackPending || gBackReady;
+}
+
+CRGB* BeginVirtualLedsUpload(long count) {
+  if (RENDER_DIRECT_PALETTE || count < 1 || count > kVirtualLedCapacity) {
+    return nullptr;
   }
-  long mirrored = canonicalLen - 1 - sectionOffset;
-  if (mirrored < 0) {
-    mirrored = 0;
+  // The upload replaces whatever was being built in the back slot.
+  gBackLedCount = count;
+  gBackFilled = 0;
+  gBackPending = false;
+  gBackReady = false;
+  gUploadOpen = true;
+  return (CRGB*)gVirtualArena[gFrontSlot ^ 1];
+}
+
+bool VirtualLedsUploadOpen() {
+  return gUploadOpen;
+}
+
+// An upload into a 16-bit slot arrives as packed 8-bit pixels at its start.
+// Widening from the last pixel down never overwrites a pixel not yet read.
+[[maybe_unused]] static void widenUpload(CRGB16* slot, long count) {
+  const CRGB* packed = (const CRGB*)slot;
+  for (long i = count - 1; i >= 0; --i) {
+    CRGB c = packed[i];
+    slot[i].r = c.r * 257;
+    slot[i].g = c.g * 257;
+    slot[i].b = c.b * 257;
   }
-  return mirrored;
 }
 
-// Helper to free any existing virtual buffer.
-static void freeVirtualLeds() {
-  if (gVirtualLeds != nullptr) {
-    free(gVirtualLeds);
-    gVirtualLeds = nullptr;
-    gVirtualLedCount = 0;
+[[maybe_unused]] static void widenUpload(CRGB*, long) {}
+
+bool CommitVirtualLedsUpload() {
+  if (!gUploadOpen) {
+    return false;  // a rebuild request took the back slot meanwhile
   }
+  gUploadOpen = false;
+  widenUpload(gVirtualArena[gFrontSlot ^ 1], gBackLedCount);
+  accumulateBackLoad(0, gBackLedCount);
+  gBackFilled = gBackLedCount;
+  gBackReady = true;
+  return true;
 }
 
 // Rebuilds the virtual LED array based on the provided waveLengthScale and resolution.
@@ -95,72 +232,422 @@ static void freeVirtualLeds() {
 //   - The pattern is generated from the current palette in that virtual space.
 //   - RESOLUTION is used later in FillLEDsFromPaletteColors for phase
 //     interpolation; it does not influence buffer size.
+//
+// This is the synchronous form: the pattern is built in one go and takes
+// effect immediately. Use RequestVirtualLedsRebuild() from the main loop.
 void RebuildVirtualLeds(float waveLengthScale, int resolution) {
-  // Guard against invalid parameters.
-  if (waveLengthScale <= 0.0f) {
-    waveLengthScale = 1.0f;
-  }
-  if (resolution <= 0) {
-    resolution = 1;
-  }
+  (void)resolution;
+  RequestVirtualLedsRebuild(waveLengthScale);
+  StepVirtualLedsRebuild(RENDER_DIRECT_PALETTE ? kPlanPaletteTable : gBackLedCount);
+  swapVirtualLeds();
+}
+
+// Render configuration. The kernels below are templates over a mode type:
+// StaticRenderMode fixes every flag at compile time, so each instantiation
+// is a branch-free kernel for one (fold mode, reversed, interpolating)
+// combination; DynamicRenderMode carries the same flags as run-time values
+// and backs the generic path.
+template<bool Folded, bool Reversed, bool Interpolate>
+struct StaticRenderMode {
+  static constexpr bool folded = Folded;
+  static constexpr bool reversed = Reversed;
+  static constexpr bool interpolate = Interpolate;
+};
+
+struct DynamicRenderMode {
+  bool folded;
+  bool reversed;
+  bool interpolate;
+};
+
+// Geometry of a strip: the main one (NUM_LEDS, ANIMATION_PARTS, render
+// mode flags) or one of the EXTRA_LED_STRIPS.
+struct StripShape {
+  long length;
+  long parts;
+  long unique;  // section length
+  bool folded;
+  bool reversed;
+};
+
+template<typename Mode>
+static StripShape mainStripShape(const Mode& mode) {
+  return { NUM_LEDS, kFoldCount, kIndependentLedCount, mode.folded, mode.reversed };
+}
 
-  long effectiveLedCount = getIndependentLedCount();
-  if (effectiveLedCount < 1) {
-    effectiveLedCount = NUM_LEDS;
+static StripShape extraStripShape(const LedStrip& strip) {
+  return { strip.length, strip.parts, stripSectionLength(strip.length, strip.parts), strip.folded, strip.reversed };
+}
+
+// Physical placement of one section of a strip. Pixel j of the section
+// (counting along the strip) shows canonical index canonicalStart +/- j.
+struct SectionLayout {
+  long physicalStart;
+  long length;
+  long canonicalStart;
+  bool canonicalDescending;
+};
+
+// Describes logical section `section` (logical LEDs section*unique ..).
+// Folded layouts mirror every other section, and mirror the whole canonical
+// run when not reversed so folds animate inward; reversal flips the section
+// to the opposite end of the strip and walks it backwards.
+static SectionLayout sectionLayout(const StripShape& shape, long section) {
+  const long unique = shape.unique;
+  long logicalStart = section * unique;
+  long logicalEnd = logicalStart + unique;
+  if (logicalEnd > shape.length) {
+    logicalEnd = shape.length;
   }
 
-  // Determine virtual pattern length based on the independent LED count so
-  // animations shrink with ANIMATION_PARTS and then mirror/copy across sections.
-  float rawLength = (float)effectiveLedCount * waveLengthScale;
-  long patternSize = (long)(rawLength + 0.5f);
-  if (patternSize < 1) patternSize = 1;  // at least one virtual pixel
+  SectionLayout layout;
+  layout.length = logicalEnd - logicalStart;
 
-  // Optional safety cap; adjust if you know your MCU can handle more.
-  const long MAX_VIRTUAL_LEDS = 3000;  // ~9 KB for CRGB on 8-bit AVR
-  if (patternSize > MAX_VIRTUAL_LEDS) {
-    patternSize = MAX_VIRTUAL_LEDS;
+  bool mirrored = false;
+  if (shape.folded && shape.parts > 1) {
+    mirrored = ((section % 2) == 1) != !shape.reversed;
   }
 
-  // If size didn't change, we just regenerate in-place to reflect palette
-  // or configuration changes.
-  bool sizeChanged = (patternSize != gVirtualLedCount);
+  if (!shape.reversed) {
+    layout.physicalStart = logicalStart;
+    layout.canonicalStart = mirrored ? unique - 1 : 0;
+    layout.canonicalDescending = mirrored;
+  } else {
+    layout.physicalStart = shape.length - logicalEnd;
+    layout.canonicalStart = mirrored ? unique - layout.length : layout.length - 1;
+    layout.canonicalDescending = !mirrored;
+  }
+  return layout;
+}
 
-  if (sizeChanged) {
-    freeVirtualLeds();
-    gVirtualLeds = (CRGB*)malloc(sizeof(CRGB) * patternSize);
-    if (!gVirtualLeds) {
-      // Allocation failed; fall back to no virtual pattern.
-      gVirtualLedCount = 0;
-      return;
+// Writes `count` consecutive pixels of `pattern` (patternLen pixels),
+// starting at index `start`, to dst, stepping dst by `step` (+1 or -1)
+// after each pixel.
+// The ring buffer wrap is handled as a sequence of contiguous spans (two for
+// the usual case, more only when the pattern is shorter than the run), so the
+// inner loops carry no modulo.
+template<typename Mode>
+static void renderCanonicalRun(const Mode& mode, const CRGB* pattern, long patternLen, CRGB* dst, int step, long count, long start, uint8_t blendFactor) {
+  long index = start;
+
+  while (count > 0) {
+    long run = patternLen - index;
+    if (run > count) {
+      run = count;
+    }
+    const CRGB* src = pattern + index;
+
+    if (!mode.interpolate) {
+      for (long i = 0; i < run; ++i) {
+        *dst = src[i];
+        dst += step;
+      }
+    } else {
+      // The last pixel of the pattern blends towards pattern[0].
+      bool touchesEnd = (index + run == patternLen);
+      long inner = touchesEnd ? run - 1 : run;
+      for (long i = 0; i < inner; ++i) {
+        *dst = blend(src[i], src[i + 1], blendFactor);
+        dst += step;
+      }
+      if (touchesEnd) {
+        *dst = blend(src[inner], pattern[0], blendFactor);
+        dst += step;
+      }
     }
-    gVirtualLedCount = patternSize;
+
+    count -= run;
+    index = 0;
   }
+}
 
-  // Populate the virtual pattern from the current palette.
-  // We map the virtual index linearly into the 0-255 palette index space.
-  for (long i = 0; i < gVirtualLedCount; ++i) {
-    uint8_t paletteIndex = (uint8_t)((i * 256L) / gVirtualLedCount);
-    gVirtualLeds[i] = ColorFromPalette(currentPalette, paletteIndex, 255, currentBlending);
+// ── High-precision output ──
+// The gamma curve is evaluated by the compiler: ln / exp as constexpr
+// series, tabulated once into flash. The Arduino AVR core compiles with
+// -std=gnu++11, so each helper is a single return, recursing where a loop
+// would do.
+static constexpr double kLn2 = 0.69314718055994530942;
+
+// 2 atanh(z) as the series z + z^3 / 3 + ..., `term` being z^k.
+static constexpr double atanhSeries(double zz, double term, int k, double sum) {
+  return k < 40 ? atanhSeries(zz, term * zz, k + 2, sum + term / k) : 2.0 * sum;
+}
+
+// ln(x) = 2 atanh(z) with z = (x - 1) / (x + 1), after halving x into
+// [0.5, 1] so that |z| <= 1/3.
+static constexpr double logNormalized(double x, int exponent) {
+  return x < 0.5 ? logNormalized(x * 2.0, exponent - 1)
+                 : atanhSeries((x - 1.0) / (x + 1.0) * ((x - 1.0) / (x + 1.0)), (x - 1.0) / (x + 1.0), 1, 0.0) +
+                       exponent * kLn2;
+}
+
+// x > 0
+static constexpr double constexprLog(double x) {
+  return logNormalized(x, 0);
+}
+
+static constexpr double expSeries(double y, double term, int k, double sum) {
+  return k < 20 ? expSeries(y, term * (y / k), k + 1, sum + term * (y / k)) : sum;
+}
+
+static constexpr double halve(double x, int halvings) {
+  return halvings > 0 ? halve(x * 0.5, halvings - 1) : x;
+}
+
+static constexpr double expNormalized(double y, int halvings) {
+  return y < -kLn2 ? expNormalized(y + kLn2, halvings + 1) : halve(expSeries(y, 1.0, 1, 1.0), halvings);
+}
+
+// y <= 0
+static constexpr double constexprExp(double y) {
+  return expNormalized(y, 0);
+}
+
+// Output level at full brightness for linear input i / 256, in 8.8 fixed
+// point (255.0 = 65280): (i / 256) ^ RENDER_GAMMA.
+static constexpr uint16_t gammaLevel(int i) {
+  return i == 0 ? 0 : (uint16_t)(constexprExp(RENDER_GAMMA * constexprLog(i / 256.0)) * 65280.0 + 0.5);
+}
+
+struct GammaTable {
+  uint16_t level[257];
+};
+
+#define GAMMA_LEVELS_4(i) gammaLevel(i), gammaLevel(i + 1), gammaLevel(i + 2), gammaLevel(i + 3)
+#define GAMMA_LEVELS_16(i) GAMMA_LEVELS_4(i), GAMMA_LEVELS_4(i + 4), GAMMA_LEVELS_4(i + 8), GAMMA_LEVELS_4(i + 12)
+#define GAMMA_LEVELS_64(i) GAMMA_LEVELS_16(i), GAMMA_LEVELS_16(i + 16), GAMMA_LEVELS_16(i + 32), GAMMA_LEVELS_16(i + 48)
+static constexpr GammaTable kGammaTable PROGMEM = { {
+  GAMMA_LEVELS_64(0), GAMMA_LEVELS_64(64), GAMMA_LEVELS_64(128), GAMMA_LEVELS_64(192), gammaLevel(256),
+} };
+#undef GAMMA_LEVELS_64
+#undef GAMMA_LEVELS_16
+#undef GAMMA_LEVELS_4
+
+// The gamma table scaled by the brightness (RAM, rebuilt on change) and the
+// frame counter of the dither.
+static uint16_t gLevels[kPlanLevels];
+static int gLevelsBrightness = -1;
+static uint8_t gDitherFrame = 0;
+
+// Per-pixel offset of the dither threshold, so neighbours do not flicker in
+// step; odd, so it cycles through all 256 offsets.
+static constexpr uint8_t kDitherStride = 167;
+
+void SetRenderBrightness(uint8_t brightness) {
+  if (!RENDER_HIGH_PRECISION || brightness == gLevelsBrightness) {
+    return;
+  }
+  gLevelsBrightness = brightness;
+  for (int i = 0; i <= 256; ++i) {
+    // FastLED's brightness scale, (v * (b + 1)) >> 8, with 0 fully off.
+    uint16_t full = pgm_read_word(&kGammaTable.level[i]);
+    gLevels[i] = brightness == 0 ? 0 : (uint16_t)(((uint32_t)full * (brightness + 1)) >> 8);
   }
 }
 
-void FillLEDsFromPaletteColors(long colorShift, int resolution, float waveLengthScale) {
-  // Ensure we have a valid virtual pattern that matches the current
-  // waveLengthScale/resolution configuration.
-  if (gVirtualLeds == nullptr || gVirtualLedCount <= 0) {
-    RebuildVirtualLeds(waveLengthScale, resolution);
+// Level table lookup, linearly interpolated on the low byte.
+static inline uint16_t levelOf(uint16_t linear) {
+  uint8_t index = (uint8_t)(linear >> 8);
+  uint16_t a = gLevels[index];
+  uint16_t b = gLevels[index + 1];
+  return (uint16_t)(a + (((uint32_t)(b - a) * (uint8_t)linear) >> 8));
+}
+
+uint16_t RenderLevel(uint16_t linear) {
+  return RENDER_HIGH_PRECISION ? levelOf(linear) : 0;
+}
+
+static uint8_t reverseBits(uint8_t v) {
+  v = (uint8_t)((v & 0xF0) >> 4 | (v & 0x0F) << 4);
+  v = (uint8_t)((v & 0xCC) >> 2 | (v & 0x33) << 2);
+  v = (uint8_t)((v & 0xAA) >> 1 | (v & 0x55) << 1);
+  return v;
+}
+
+// Truncates an 8.8 level after adding the threshold: over all 256
+// thresholds the outputs sum to the level exactly. Levels stay <= 65280,
+// so the sum cannot overflow.
+static inline void ditherPixel(CRGB* dst, const CRGB16& c, uint8_t threshold) {
+  dst->r = (uint8_t)((uint16_t)(levelOf(c.r) + threshold) >> 8);
+  dst->g = (uint8_t)((uint16_t)(levelOf(c.g) + threshold) >> 8);
+  dst->b = (uint8_t)((uint16_t)(levelOf(c.b) + threshold) >> 8);
+}
+
+static inline CRGB16 lerp16(const CRGB16& a, const CRGB16& b, uint8_t f) {
+  CRGB16 c = { lerp16(a.r, b.r, f), lerp16(a.g, b.g, f), lerp16(a.b, b.b, f) };
+  return c;
+}
+
+// 16-bit counterpart of renderCanonicalRun(): blends in 16 bits, then maps
+// every channel through the level table and dithers it to 8 bits. The
+// dither threshold advances once per rendered frame, in bit-reversed order
+// so that any 2^k consecutive frames already spread it evenly.
+template<typename Mode>
+static void renderCanonicalRun(const Mode& mode, const CRGB16* pattern, long patternLen, CRGB* dst, int step, long count, long start, uint8_t blendFactor) {
+  uint8_t threshold = reverseBits(gDitherFrame++);
+  long index = start;
+
+  while (count > 0) {
+    long run = patternLen - index;
+    if (run > count) {
+      run = count;
+    }
+    const CRGB16* src = pattern + index;
+
+    if (!mode.interpolate) {
+      for (long i = 0; i < run; ++i) {
+        ditherPixel(dst, src[i], threshold);
+        threshold += kDitherStride;
+        dst += step;
+      }
+    } else {
+      // The last pixel of the pattern blends towards pattern[0].
+      bool touchesEnd = (index + run == patternLen);
+      long inner = touchesEnd ? run - 1 : run;
+      for (long i = 0; i < inner; ++i) {
+        ditherPixel(dst, lerp16(src[i], src[i + 1], blendFactor), threshold);
+        threshold += kDitherStride;
+        dst += step;
+      }
+      if (touchesEnd) {
+        ditherPixel(dst, lerp16(src[inner], pattern[0], blendFactor), threshold);
+        threshold += kDitherStride;
+        dst += step;
+      }
+    }
+
+    count -= run;
+    index = 0;
   }
+}
 
-  if (gVirtualLeds == nullptr || gVirtualLedCount <= 0) {
-    // Still nothing usable; as a last resort, write black.
-    for (int i = 0; i < NUM_LEDS; ++i) {
-      leds[i] = CRGB::Black;
+// Direct palette counterpart of renderCanonicalRun(): the colour of virtual
+// pixel v is that of palette index v * 256 / patternLen, read from the
+// palette table (sampled on the fly in buffered builds) instead of from
+// gVirtualLeds. The palette index is tracked as a fixed-point position
+// (whole step plus a remainder carried in units of 1/patternLen), so each
+// pixel costs an add, a compare and a table read, no division, and the
+// result is bit-identical to the buffered pattern.
+template<typename Mode>
+static void renderCanonicalRunDirect(const Mode& mode, CRGB* dst, int step, long count, long start, long patternLen, uint8_t blendFactor) {
+  const long wholeStep = 256L / patternLen;
+  const long remainderStep = 256L % patternLen;
+
+  // Position of virtual pixel `start`; the only division in the frame.
+  long virtualIndex = start;
+  long index = (start * 256L) / patternLen;
+  long remainder = (start * 256L) % patternLen;
+  CRGB color = paletteSample(currentPalette, (uint8_t)index);
+
+  for (long i = 0; i < count; ++i) {
+    // Position of the following virtual pixel (wrapping to 0 at the end).
+    long nextVirtualIndex = virtualIndex + 1;
+    long nextIndex = index + wholeStep;
+    long nextRemainder = remainder + remainderStep;
+    if (nextRemainder >= patternLen) {
+      nextRemainder -= patternLen;
+      ++nextIndex;
+    }
+    if (nextVirtualIndex == patternLen) {
+      nextVirtualIndex = 0;
+      nextIndex = 0;
+      nextRemainder = 0;
+    }
+
+    if (RENDER_DIRECT_PALETTE) {
+      const CRGB* palette = gPaletteTable;
+      *dst = mode.interpolate ? blend(palette[index], palette[nextIndex], blendFactor) : palette[index];
+      dst += step;
+    } else {
+      // Each palette sample serves as this pixel's blend target and as the
+      // next pixel's colour; long patterns repeat an index over several
+      // pixels and sample it once.
+      const CRGB nextColor = nextIndex == index ? color : paletteSample(currentPalette, (uint8_t)nextIndex);
+      *dst = mode.interpolate ? blend(color, nextColor, blendFactor) : color;
+      dst += step;
+      color = nextColor;
     }
+
+    virtualIndex = nextVirtualIndex;
+    index = nextIndex;
+    remainder = nextRemainder;
+  }
+}
+
+// Copies `count` pixels from src to dst, either in order or reversed
+// (src walked backwards from src[0]).
+static void copySection(CRGB* dst, const CRGB* src, long count, bool reversed) {
+  if (!reversed) {
+    memcpy(dst, src, sizeof(CRGB) * count);
     return;
   }
+  for (long i = 0; i < count; ++i) {
+    dst[i] = *(src - i);
+  }
+}
 
-  if (resolution <= 0) resolution = 1;
+// Fills sections firstSection.. of a strip with block copies of the
+// canonical run, which is held in `canonical` (`unique` pixels, stored
+// descending when canonicalDescending). A strip with a shorter section uses
+// the start of the run.
+static void copyStripSections(const StripShape& shape, CRGB* dst, long firstSection,
+                              const CRGB* canonical, long unique, bool canonicalDescending) {
+  for (long section = firstSection; section < shape.parts && section * shape.unique < shape.length; ++section) {
+    SectionLayout layout = sectionLayout(shape, section);
+    // Where canonical index canonicalStart lives inside the run.
+    long sourceOffset = canonicalDescending
+                          ? (unique - 1 - layout.canonicalStart)
+                          : layout.canonicalStart;
+    bool reversed = (layout.canonicalDescending != canonicalDescending);
+    copySection(&dst[layout.physicalStart], canonical + sourceOffset, layout.length, reversed);
+  }
+}
+
+// Renders one frame: the canonical run goes straight into the physical span
+// of the main strip's first section (always full length) in that section's
+// direction, then the remaining sections and every extra strip are filled
+// with forward or reversed block copies of it. With more parts than LEDs
+// the trailing sections are empty.
+// renderRun(dst, step, count) produces the canonical run.
+template<typename Mode, typename RunRenderer>
+static void renderFrame(const Mode& mode, const RunRenderer& renderRun) {
+  const long unique = kIndependentLedCount;
+  const StripShape shape = mainStripShape(mode);
+  SectionLayout first = sectionLayout(shape, 0);
+  CRGB* firstStart = &leds[first.physicalStart];
+  if (!first.canonicalDescending) {
+    renderRun(firstStart, 1, unique);
+  } else {
+    renderRun(firstStart + unique - 1, -1, unique);
+  }
 
+  copyStripSections(shape, leds, 1, firstStart, unique, first.canonicalDescending);
+  for (uint8_t strip = 0; strip < gExtraStripCount; ++strip) {
+    copyStripSections(extraStripShape(gExtraStrips[strip]), gExtraStrips[strip].leds, 0,
+                      firstStart, unique, first.canonicalDescending);
+  }
+}
+
+template<typename Mode>
+static void renderBufferedFrame(const Mode& mode, long baseShift, uint8_t blendFactor) {
+  renderFrame(mode, [&](CRGB* dst, int step, long count) {
+    renderCanonicalRun(mode, gVirtualLeds, gVirtualLedCount, dst, step, count, baseShift, blendFactor);
+  });
+}
+
+template<typename Mode>
+static void renderDirectFrame(const Mode& mode, long baseShift, long patternLen, uint8_t blendFactor) {
+  renderFrame(mode, [&](CRGB* dst, int step, long count) {
+    renderCanonicalRunDirect(mode, dst, step, count, baseShift, patternLen, blendFactor);
+  });
+}
+
+template<bool Interpolate>
+using ConfiguredRenderMode = StaticRenderMode<kPartsType == PartsType::Folded, ANIMATION_REVERSED, Interpolate>;
+
+// Splits the frame counter into the pattern start index and the blend
+// factor towards the next pixel.
+static void framePhase(long colorShift, int resolution, long patternLen, long& baseShift, uint8_t& blendFactor) {
   // Interpret colorShift as the global frame counter. We derive an integer
   // base index and a sub-frame phase from it so that:
   //   - Over NUM_LEDS * resolution frames (one beat), the base index advances
@@ -171,33 +658,242 @@ void FillLEDsFromPaletteColors(long colorShift, int resolution, float waveLength
 
   long integerStep = frame / resolution;          // base start index
   uint8_t phase = (uint8_t)(frame % resolution);  // 0 .. (resolution-1)
-  uint8_t blendFactor = (uint8_t)((255L * phase) / resolution);
-
-  // Wrap base index into [0, gVirtualLedCount).
-  long wrappedBaseShift = integerStep % gVirtualLedCount;
-  if (wrappedBaseShift < 0) wrappedBaseShift += gVirtualLedCount;
-
-  const long independentLedCount = getIndependentLedCount();
-  const long foldCount = normalizedFoldCount();
-  const bool isFoldedMode = partsTypeIsFolded();
-  const bool invertCanonicalForInward = (isFoldedMode && foldCount > 1 && independentLedCount > 0 && !ANIMATION_REVERSED);
-
-  for (int physicalIndex = 0; physicalIndex < NUM_LEDS; physicalIndex++) {
-    long logicalIndex = ANIMATION_REVERSED ? (NUM_LEDS - physicalIndex - 1) : physicalIndex;
-    long canonicalIndex = canonicalIndexForLed(logicalIndex, independentLedCount);
-    if (invertCanonicalForInward) {
-      canonicalIndex = (independentLedCount - 1) - canonicalIndex;
+  blendFactor = (uint8_t)((255L * phase) / resolution);
+
+  // Wrap base index into [0, patternLen).
+  baseShift = integerStep % patternLen;
+  if (baseShift < 0) baseShift += patternLen;
+}
+
+// Prepares the buffered pattern for a frame and returns its phase.
+static void prepareBufferedFrame(long colorShift, int& resolution, float waveLengthScale, long& baseShift, uint8_t& blendFactor) {
+  // Frame boundary: a finished background rebuild takes effect here, so a
+  // frame never mixes two patterns.
+  if (gBackReady) {
+    swapVirtualLeds();
+  }
+
+  // Ensure we have a valid virtual pattern that matches the current
+  // waveLengthScale/resolution configuration.
+  if (gVirtualLeds == nullptr || gVirtualLedCount <= 0) {
+    RebuildVirtualLeds(waveLengthScale, resolution);
+  }
+
+  if (RENDER_HIGH_PRECISION && gLevelsBrightness < 0) {
+    SetRenderBrightness(255);  // full brightness until told otherwise
+  }
+
+  if (resolution <= 0) resolution = 1;
+  framePhase(colorShift, resolution, gVirtualLedCount, baseShift, blendFactor);
+}
+
+RenderKey FrameRenderKey(long colorShift, int resolution, float waveLengthScale) {
+  RenderKey key;
+  if (resolution <= 0) resolution = 1;
+  // The next render swaps a finished rebuild in.
+  key.patternVersion = (uint16_t)(gPatternVersion + (gBackReady ? 1 : 0));
+  if (RENDER_DIRECT_PALETTE) {
+    key.patternLen = patternLengthForScale(waveLengthScale);
+  } else {
+    key.patternLen = gBackReady ? gBackLedCount : gVirtualLedCount;
+  }
+
+  if (key.patternLen <= 0) {
+    // No pattern yet: the render builds one, so never report a repeat.
+    key.patternLen = 0;
+    key.baseShift = colorShift;
+    key.blendFactor = 0;
+    return key;
+  }
+  framePhase(colorShift, resolution, key.patternLen, key.baseShift, key.blendFactor);
+  return key;
+}
+
+void FillLEDsFromPaletteColors(long colorShift, int resolution, float waveLengthScale) {
+  if (RENDER_DIRECT_PALETTE) {
+    FillLEDsFromPaletteDirect(colorShift, resolution, waveLengthScale);
+    return;
+  }
+
+  long baseShift;
+  uint8_t blendFactor;
+  prepareBufferedFrame(colorShift, resolution, waveLengthScale, baseShift, blendFactor);
+
+  // blend() with a zero factor returns the first colour unchanged, so the
+  // integer phases of an interpolating configuration take the copy kernel.
+  if (resolution > 1 && blendFactor != 0) {
+    renderBufferedFrame(ConfiguredRenderMode<true>(), baseShift, blendFactor);
+  } else {
+    renderBufferedFrame(ConfiguredRenderMode<false>(), baseShift, blendFactor);
+  }
+}
+
+void FillLEDsFromPaletteColorsGeneric(long colorShift, int resolution, float waveLengthScale, bool folded, bool reversed) {
+  long baseShift;
+  uint8_t blendFactor;
+  if (RENDER_DIRECT_PALETTE) {
+    if (resolution <= 0) resolution = 1;
+    const long patternLen = patternLengthForScale(waveLengthScale);
+    framePhase(colorShift, resolution, patternLen, baseShift, blendFactor);
+    DynamicRenderMode mode = { folded, reversed, resolution > 1 && blendFactor != 0 };
+    renderDirectFrame(mode, baseShift, patternLen, blendFactor);
+    return;
+  }
+
+  prepareBufferedFrame(colorShift, resolution, waveLengthScale, baseShift, blendFactor);
+  DynamicRenderMode mode = { folded, reversed, resolution > 1 && blendFactor != 0 };
+  renderBufferedFrame(mode, baseShift, blendFactor);
+}
+
+void FillLEDsFromPaletteDirect(long colorShift, int resolution, float waveLengthScale) {
+  if (resolution <= 0) resolution = 1;
+  const long patternLen = patternLengthForScale(waveLengthScale);
+  if (RENDER_DIRECT_PALETTE) {
+    // No pattern to swap, but a completed rebuild (new length or palette)
+    // still counts as a new pattern from this frame on.
+    if (gBackReady) {
+      swapVirtualLeds();
     }
-    long virtualIndex = (wrappedBaseShift + canonicalIndex) % gVirtualLedCount;
+    gVirtualLedCount = patternLen;
+  }
 
-    CRGB color;
-    if (resolution == 1) {
-      color = gVirtualLeds[virtualIndex];
-    } else {
-      long nextVirtualIndex = (virtualIndex + 1) % gVirtualLedCount;
-      color = blend(gVirtualLeds[virtualIndex], gVirtualLeds[nextVirtualIndex], blendFactor);
+  long baseShift;
+  uint8_t blendFactor;
+  framePhase(colorShift, resolution, patternLen, baseShift, blendFactor);
+
+  if (resolution > 1 && blendFactor != 0) {
+    renderDirectFrame(ConfiguredRenderMode<true>(), baseShift, patternLen, blendFactor);
+  } else {
+    renderDirectFrame(ConfiguredRenderMode<false>(), baseShift, patternLen, blendFactor);
+  }
+}
+
+void FillStripFromPattern(const LedStrip& strip, const CRGB* pattern, long patternLen, long colorShift, int resolution) {
+  if (resolution <= 0) resolution = 1;
+  long baseShift;
+  uint8_t blendFactor;
+  framePhase(colorShift, resolution, patternLen, baseShift, blendFactor);
+  const DynamicRenderMode mode = { strip.folded, strip.reversed, resolution > 1 && blendFactor != 0 };
+  const StripShape shape = extraStripShape(strip);
+  const SectionLayout first = sectionLayout(shape, 0);
+  CRGB* firstStart = &strip.leds[first.physicalStart];
+  if (!first.canonicalDescending) {
+    renderCanonicalRun(mode, pattern, patternLen, firstStart, 1, first.length, baseShift, blendFactor);
+  } else {
+    renderCanonicalRun(mode, pattern, patternLen, firstStart + first.length - 1, -1, first.length, baseShift, blendFactor);
+  }
+  copyStripSections(shape, strip.leds, 1, firstStart, shape.unique, first.canonicalDescending);
+}
+
+void FillLEDsFromSection(SectionRenderFn renderSection) {
+  renderFrame(ConfiguredRenderMode<false>(), [&](CRGB* dst, int step, long count) {
+    renderSection(dst, step, count);
+  });
+}
+
+long SectionLedCount() {
+  return kIndependentLedCount;
+}
+
+// ── Power ──
+// Load of a pattern pixel: its levels as shown at full brightness, through
+// the gamma curve for the high-precision pattern.
+[[maybe_unused]] static uint16_t pixelLoad(const CRGB& c) {
+  return powerPixelLoad(c.r, c.g, c.b);
+}
+
+[[maybe_unused]] static uint16_t pixelLoad(const CRGB16& c) {
+  return powerPixelLoad((uint8_t)(pgm_read_word(&kGammaTable.level[c.r >> 8]) >> 8),
+                        (uint8_t)(pgm_read_word(&kGammaTable.level[c.g >> 8]) >> 8),
+                        (uint8_t)(pgm_read_word(&kGammaTable.level[c.b >> 8]) >> 8));
+}
+
+static void accumulateBackLoad(long begin, long end) {
+  if constexpr (kPatternLoad) {
+    const uint8_t slot = gFrontSlot ^ 1;
+    const VirtualPixel* pattern = gVirtualArena[slot];
+    uint32_t load = begin == 0 ? 0 : gBackLoad;
+    for (long i = begin; i < end; ++i) {
+      if (i % kLoadBlock == 0) gPatternLoad[slot][i / kLoadBlock] = load;
+      load += pixelLoad(pattern[i]);
+    }
+    gBackLoad = load;
+    if (end == gBackLedCount) gPatternLoadTotal[slot] = load;
+  }
+}
+
+// Load of pattern pixels [0, index): a block sum plus at most
+// kLoadBlock - 1 pixels.
+static uint32_t patternLoadBefore(uint8_t slot, long count, long index) {
+  if (index >= count) return gPatternLoadTotal[slot];
+  const long block = index / kLoadBlock;
+  const VirtualPixel* pattern = gVirtualArena[slot];
+  uint32_t load = gPatternLoad[slot][block];
+  for (long i = block * kLoadBlock; i < index; ++i) {
+    load += pixelLoad(pattern[i]);
+  }
+  return load;
+}
+
+// Load of `length` pattern pixels from `start` on, wrapping around the
+// pattern (and tiling it as often as the length asks for).
+static uint32_t windowLoad(uint8_t slot, long count, long start, long length) {
+  const uint32_t total = gPatternLoadTotal[slot];
+  uint32_t load = (uint32_t)(length / count) * total;
+  const long end = start + length % count;
+  if (end <= count) {
+    return load + patternLoadBefore(slot, count, end) - patternLoadBefore(slot, count, start);
+  }
+  return load + total - patternLoadBefore(slot, count, start) + patternLoadBefore(slot, count, end - count);
+}
+
+// Load of all strips for a frame starting at pattern pixel `baseShift`.
+// Canonical index c shows pattern pixel (baseShift + c) % count and every
+// section shows a contiguous range of canonical indices, so each section
+// is one window; full sections share one.
+static uint32_t framePatternLoad(uint8_t slot, long count, long baseShift) {
+  const uint32_t fullSection = windowLoad(slot, count, baseShift, kIndependentLedCount);
+  uint32_t load = 0;
+  auto addStrip = [&](const StripShape& shape) {
+    for (long section = 0; section < shape.parts && section * shape.unique < shape.length; ++section) {
+      SectionLayout layout = sectionLayout(shape, section);
+      if (layout.length == kIndependentLedCount) {
+        load += fullSection;
+        continue;
+      }
+      long lowest = layout.canonicalDescending ? layout.canonicalStart - layout.length + 1 : layout.canonicalStart;
+      load += windowLoad(slot, count, (baseShift + lowest) % count, layout.length);
     }
+  };
+  addStrip(mainStripShape(ConfiguredRenderMode<false>()));
+  for (uint8_t strip = 0; strip < gExtraStripCount; ++strip) {
+    addStrip(extraStripShape(gExtraStrips[strip]));
+  }
+  return load;
+}
 
-    leds[physicalIndex] = color;
+bool FrameLoad(long colorShift, int resolution, float waveLengthScale, uint32_t& load) {
+  (void)waveLengthScale;
+  if (!kPatternLoad) {
+    return false;
+  }
+  // The next render swaps a finished rebuild in first.
+  const uint8_t slot = gBackReady ? gFrontSlot ^ 1 : gFrontSlot;
+  const long count = gBackReady ? gBackLedCount : gVirtualLedCount;
+  if (gVirtualLeds == nullptr || count <= 0) {
+    return false;  // no pattern yet
+  }
+  if (resolution <= 0) resolution = 1;
+  long baseShift;
+  uint8_t blendFactor;
+  framePhase(colorShift, resolution, count, baseShift, blendFactor);
+  load = framePatternLoad(slot, count, baseShift);
+  if (resolution > 1 && blendFactor != 0) {
+    // Blended pixels lie between this window and the one a pixel further,
+    // and so does their load; the two differ by a few pixels at most.
+    uint32_t next = framePatternLoad(slot, count, baseShift + 1 == count ? 0 : baseShift + 1);
+    int32_t delta = (int32_t)(next - load);
+    load = (uint32_t)((int32_t)load + delta / 256 * blendFactor + delta % 256 * blendFactor / 256);
   }
+  return true;
 }
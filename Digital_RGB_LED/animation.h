@@ -2,18 +2,171 @@
 #define ANIMATION_H
 
 #include <FastLED.h>
+#include "config.h"
 
-// Precomputed virtual LED strip state.
-// Length depends on NUM_LEDS, WAVE_LENGTH_SCALE and RESOLUTION.
-extern CRGB* gVirtualLeds;
+// How ANIMATION_PARTS sections are laid out (ANIMATION_PARTS_TYPE).
+enum class PartsType : uint8_t {
+  Folded,   // every second section is mirrored
+  Cut,      // sections are plain copies
+  Unknown,
+};
+
+constexpr char asciiToLower(char c) {
+  return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+}
+
+constexpr bool constexprEqualsIgnoreCase(const char* lhs, const char* rhs) {
+  return asciiToLower(*lhs) != asciiToLower(*rhs) ? false
+         : (*lhs == '\0')                        ? true
+                                                 : constexprEqualsIgnoreCase(lhs + 1, rhs + 1);
+}
+
+// Parses an ANIMATION_PARTS_TYPE string ("FOLDED" / "CUT", any case).
+// Usable in constant expressions, so the string never reaches the MCU.
+constexpr PartsType parsePartsType(const char* type) {
+  return constexprEqualsIgnoreCase(type, "FOLDED") ? PartsType::Folded
+         : constexprEqualsIgnoreCase(type, "CUT")  ? PartsType::Cut
+                                                   : PartsType::Unknown;
+}
+
+// One pixel of the high-precision pattern: 16 bits per channel, linear.
+struct CRGB16 {
+  uint16_t r;
+  uint16_t g;
+  uint16_t b;
+};
+
+// Pixel type of the virtual pattern: 8 bits per channel, or 16 with
+// RENDER_HIGH_PRECISION.
+#if RENDER_HIGH_PRECISION
+typedef CRGB16 VirtualPixel;
+#else
+typedef CRGB VirtualPixel;
+#endif
+
+// Precomputed virtual LED strip state (the front slot of a static,
+// double-buffered arena; see VIRTUAL_LEDS_MAX in config.h).
+// Length depends on NUM_LEDS, WAVE_LENGTH_SCALE and ANIMATION_PARTS.
+// With RENDER_DIRECT_PALETTE there is no buffer: gVirtualLeds stays null
+// and gVirtualLedCount is the length of the wave being rendered.
+extern VirtualPixel* gVirtualLeds;
 extern long gVirtualLedCount;
 
 // Rebuild the virtual LED buffer according to current
-// WAVE_LENGTH_SCALE and RESOLUTION. Safe to call whenever these change.
+// WAVE_LENGTH_SCALE and RESOLUTION, synchronously: the new pattern is in
+// place when the call returns. Meant for setup() and tools.
 void RebuildVirtualLeds(float waveLengthScale, int resolution);
 
+// Background rebuild, for use while animating. Request starts (or restarts)
+// building the pattern for waveLengthScale in the back slot; each Step call
+// generates at most maxPixels of it and returns true once the pattern is
+// complete. The next FillLEDsFromPaletteColors() call then swaps it in at
+// the frame boundary; until then the old pattern keeps rendering.
+void RequestVirtualLedsRebuild(float waveLengthScale);
+bool StepVirtualLedsRebuild(long maxPixels);
+// True from a request until the new pattern has been rendered once.
+bool VirtualLedsRebuildPending();
+
+// Pattern upload (serial streaming): returns the back slot for `count`
+// 8-bit pixels to be written straight into, or nullptr when it cannot hold
+// them (or with RENDER_DIRECT_PALETTE). CommitVirtualLedsUpload() makes it
+// take effect at the next frame, like a finished rebuild. It returns false
+// when a RequestVirtualLedsRebuild() took the back slot in between; an
+// upload that is never committed is simply dropped. With
+// RENDER_HIGH_PRECISION the commit widens the pixels to 16 bits in place.
+// VirtualLedsUploadOpen() is false once such a request took the slot: the
+// uploader must stop writing into it, as the rebuild (and after the swap,
+// the rendering) owns it from then on.
+CRGB* BeginVirtualLedsUpload(long count);
+bool VirtualLedsUploadOpen();
+bool CommitVirtualLedsUpload();
+
 // Render function: maps the virtual LED state to the physical strip by
-// sliding a window over gVirtualLeds using the given colorShift.
+// sliding a window over gVirtualLeds using the given colorShift. Only the
+// independent section (NUM_LEDS / ANIMATION_PARTS LEDs) is rendered; the
+// other sections are filled by straight or mirrored copies of it.
+// Dispatches to a kernel specialized at compile time for the configured
+// ANIMATION_PARTS_TYPE / ANIMATION_REVERSED and for interpolating vs.
+// non-interpolating frames, so the pixel loops carry no config branches.
 void FillLEDsFromPaletteColors(long colorShift, int resolution, float waveLengthScale);
 
+// Same output through a single kernel that reads the layout flags at run
+// time. Kept for benchmarking and cross-checking the specialized kernels;
+// the linker drops it from the firmware when unused.
+void FillLEDsFromPaletteColorsGeneric(long colorShift, int resolution, float waveLengthScale, bool folded, bool reversed);
+
+// Bufferless render: each pixel is sampled straight from currentPalette at
+// its position in the wave, so the pattern length is not limited by
+// VIRTUAL_LEDS_MAX and a wave length change costs nothing. Output matches
+// the buffered path. FillLEDsFromPaletteColors() uses it when
+// RENDER_DIRECT_PALETTE is true in config.h; it is callable either way.
+void FillLEDsFromPaletteDirect(long colorShift, int resolution, float waveLengthScale);
+
+// Renders an 8-bit `pattern` of patternLen pixels onto `strip` (strips.h)
+// the way FillLEDsFromPaletteColors() renders the virtual pattern onto the
+// main strip: the phase comes from colorShift and resolution, the first
+// section is rendered and the others are copied by the strip's fold type and
+// direction. It uses the generic kernel and only touches strip.leds[0,
+// length). This is how zones.h renders each zone.
+struct LedStrip;
+void FillStripFromPattern(const LedStrip& strip, const CRGB* pattern, long patternLen, long colorShift, int resolution);
+
+// Renders `count` pixels of the independent section, canonical index 0
+// first, to dst, stepping dst by `step` (+1 or -1) after each pixel.
+typedef void (*SectionRenderFn)(CRGB* dst, int step, long count);
+
+// Frame of any effect (effects.h): renderSection produces the independent
+// section (NUM_LEDS / ANIMATION_PARTS LEDs) once, and the fold / cut /
+// reverse mapping fills the rest of the strip and the EXTRA_LED_STRIPS
+// from it, exactly as for the palette wave.
+void FillLEDsFromSection(SectionRenderFn renderSection);
+long SectionLedCount();
+
+// ── High-precision output (RENDER_HIGH_PRECISION) ──
+// The pattern holds 16-bit linear colour, interpolated between palette
+// entries when it is built and between pattern pixels in 16 bits when
+// RESOLUTION > 1. Each channel then goes through a 257-entry level table
+// (gamma RENDER_GAMMA with the brightness folded in, linearly interpolated)
+// to an 8.8 fixed-point output level, which is dithered to 8 bits: a
+// threshold that runs through all 256 values over 256 rendered frames (in
+// bit-reversed order, offset per pixel) is added before truncation, so the
+// average of the shown values is the 8.8 level exactly and low brightness
+// keeps its gradations instead of banding. The strip is then shown at full
+// FastLED brightness (see outputRenderScalesBrightness() in output.h).
+// Budget on a 16 MHz AVR: roughly 200 cycles per rendered pixel against
+// about 100 for the 8-bit path; only the canonical section is rendered.
+//
+// SetRenderBrightness() rebuilds the level table when the brightness
+// changes (257 multiplies); RenderLevel() maps a 16-bit linear value to its
+// 8.8 output level. Both do nothing useful without RENDER_HIGH_PRECISION.
+void SetRenderBrightness(uint8_t brightness);
+uint16_t RenderLevel(uint16_t linear);
+
+// Identifies the frame FillLEDsFromPaletteColors() would render for these
+// arguments: equal keys mean identical leds[] contents (up to the dither
+// with RENDER_HIGH_PRECISION). Palette changes are not covered; report
+// those to the output stage separately.
+struct RenderKey {
+  uint16_t patternVersion;  // bumped whenever a new pattern takes effect
+  long patternLen;
+  long baseShift;
+  uint8_t blendFactor;
+};
+
+inline bool operator==(const RenderKey& a, const RenderKey& b) {
+  return a.patternVersion == b.patternVersion && a.patternLen == b.patternLen
+         && a.baseShift == b.baseShift && a.blendFactor == b.blendFactor;
+}
+
+RenderKey FrameRenderKey(long colorShift, int resolution, float waveLengthScale);
+
+// Load (power.h) of the frame FillLEDsFromPaletteColors() would render for
+// these arguments, over the main strip and the EXTRA_LED_STRIPS, at full
+// brightness. Read from prefix sums kept with the pattern, so the cost does
+// not grow with the strip: a few block sums and pattern pixels per section.
+// Interpolated frames are estimated from the two windows they blend. False
+// when there is nothing to read it from (no estimate compiled in, see
+// kPowerEstimate, RENDER_DIRECT_PALETTE, or no pattern yet).
+bool FrameLoad(long colorShift, int resolution, float waveLengthScale, uint32_t& load);
+
 #endif  // ANIMATION_H
@@ -0,0 +1,373 @@
+#include "audio.h"
+
+// ── FFT ──
+
+// sin(2πk/64) for k = 0..16, Q15.
+static const int16_t kSine[AUDIO_FFT_SIZE / 4 + 1] PROGMEM = {
+  0, 3212, 6393, 9512, 12539, 15446, 18204, 20787, 23170,
+  25329, 27245, 28898, 30273, 31356, 32137, 32609, 32767,
+};
+
+// sin(2πk/64) for k < 48, from the quarter wave.
+static int16_t sine(uint8_t k) {
+  if (k <= 16) return (int16_t)pgm_read_word(&kSine[k]);
+  if (k <= 32) return (int16_t)pgm_read_word(&kSine[32 - k]);
+  return -(int16_t)pgm_read_word(&kSine[k - 32]);
+}
+
+void audioFft(int16_t* re, int16_t* im) {
+  for (uint8_t i = 1, j = 0; i < AUDIO_FFT_SIZE; ++i) {
+    uint8_t bit = AUDIO_FFT_SIZE >> 1;
+    for (; j & bit; bit >>= 1) j ^= bit;
+    j |= bit;
+    if (i < j) {
+      int16_t t = re[i]; re[i] = re[j]; re[j] = t;
+      t = im[i]; im[i] = im[j]; im[j] = t;
+    }
+  }
+  // Butterflies with w = cos - i sin; halving each stage keeps every
+  // value within the input's range.
+  for (uint8_t half = 1; half < AUDIO_FFT_SIZE; half <<= 1) {
+    const uint8_t stride = AUDIO_FFT_SIZE / (2 * half);
+    for (uint8_t k = 0; k < half; ++k) {
+      const int32_t wr = sine(k * stride + AUDIO_FFT_SIZE / 4);
+      const int32_t wi = sine(k * stride);
+      for (uint8_t a = k; a < AUDIO_FFT_SIZE; a += 2 * half) {
+        const uint8_t b = a + half;
+        const int16_t tr = (int16_t)((wr * re[b] + wi * im[b]) >> 15);
+        const int16_t ti = (int16_t)((wr * im[b] - wi * re[b]) >> 15);
+        re[b] = (int16_t)((re[a] - tr) >> 1);
+        im[b] = (int16_t)((im[a] - ti) >> 1);
+        re[a] = (int16_t)((re[a] + tr) >> 1);
+        im[a] = (int16_t)((im[a] + ti) >> 1);
+      }
+    }
+  }
+}
+
+#if AUDIO_ENABLED
+
+static_assert(AUDIO_SAMPLE_RATE >= 1000 && AUDIO_SAMPLE_RATE <= 4500,
+              "AUDIO_SAMPLE_RATE must be between 1000 and 4500 (two ADC conversions per sample)");
+static_assert(AUDIO_BPM_MIN > 0 && AUDIO_BPM_MAX > AUDIO_BPM_MIN, "AUDIO_BPM_MIN must be below AUDIO_BPM_MAX");
+
+// First half of a symmetric 64-point Hann window, Q15.
+static const int16_t kWindow[AUDIO_FFT_SIZE / 2] PROGMEM = {
+  0, 81, 325, 728, 1286, 1995, 2847, 3833, 4944, 6169, 7495, 8909, 10398, 11946, 13539, 15159,
+  16792, 18421, 20029, 21601, 23122, 24575, 25947, 27224, 28393, 29443, 30363, 31145, 31779, 32260, 32584, 32747,
+};
+
+// First bin of each band, and the end of the last.
+static const uint8_t kBandFirst[AUDIO_BANDS + 1] = { 1, 3, 8, 16, AUDIO_FFT_SIZE / 2 };
+
+static constexpr uint8_t kMaxLag = AUDIO_MAX_LAG;
+static constexpr uint8_t kMinLag = AUDIO_MIN_LAG;
+static constexpr uint8_t kLags = kMaxLag - kMinLag + 1;
+static_assert(kMinLag >= 2 && 3 * kMaxLag < 256, "AUDIO_BPM_MIN..AUDIO_BPM_MAX out of range for AUDIO_SAMPLE_RATE");
+static const uint8_t kStamps = 64;  // hop end times kept, for beats up to a period back
+static_assert(kMaxLag < kStamps, "AUDIO_BPM_MIN too low to time a beat period of hops");
+
+static const uint8_t kRingHops = 4;
+static_assert(kRingHops * AUDIO_FFT_SIZE == 256, "the ring index wraps as a uint8_t");
+static const uint8_t kAutocorrShift = 7;  // leak of the autocorrelation per hop (1/128, ~2 s)
+static const uint8_t kPhaseShift = 2;     // beat phase loop filter: 1/4 of each error
+
+// Written by audioPush() (the ADC interrupt).
+static uint8_t ring[kRingHops * AUDIO_FFT_SIZE];
+static unsigned long hopEnd[kRingHops];  // micros() when each hop was complete
+static uint8_t writePos = 0;
+static volatile uint8_t pendingHops = 0;
+static volatile uint8_t readHop = 0;  // also moved by audioPush() when a hop is dropped
+static volatile uint16_t droppedHops = 0;
+
+// audioProcess() state.
+static uint16_t magnitude[AUDIO_FFT_SIZE / 2];  // previous hop's bins
+static int32_t fluxMean = 0;
+static uint32_t onsetPeak = 0;
+static uint8_t onsets[256];  // onset strength per hop, indexed by hopIndex
+static uint8_t hopIndex = 0;
+static uint16_t hopStamp[kStamps];  // micros() / 32 when each hop was complete, by hopIndex
+static uint16_t hops = 0;    // processed, saturating
+static uint8_t quietHops = 0;  // since the last strong onset, saturating
+static uint32_t autocorr[kLags];
+static uint32_t bandPeak[AUDIO_BANDS];
+static uint8_t bandLevel[AUDIO_BANDS];
+static unsigned long lastHopEnd = 0;
+static uint32_t hopMicros16 = 0;  // measured hop interval, 1/16 µs
+static bool tracked = false;
+static uint32_t beatMicros = 0;
+static unsigned long lastBeat = 0;
+static uint16_t costMicros = 0;
+static_assert(sizeof(ring) + sizeof(hopEnd) + sizeof(onsets) + sizeof(hopStamp) + sizeof(magnitude) + sizeof(autocorr) +
+                  sizeof(bandPeak) + sizeof(bandLevel) ==
+                AUDIO_RAM_BYTES,
+              "AUDIO_RAM_BYTES (audio.h) must count the buffers above");
+
+void audioSetup() {
+  noInterrupts();
+  writePos = 0;
+  pendingHops = 0;
+  readHop = 0;
+  droppedHops = 0;
+  interrupts();
+  memset(magnitude, 0, sizeof(magnitude));
+  memset(onsets, 0, sizeof(onsets));
+  memset(hopStamp, 0, sizeof(hopStamp));
+  memset(autocorr, 0, sizeof(autocorr));
+  memset(bandPeak, 0, sizeof(bandPeak));
+  memset(bandLevel, 0, sizeof(bandLevel));
+  fluxMean = 0;
+  onsetPeak = 0;
+  hopIndex = 0;
+  hops = 0;
+  quietHops = 0;
+  hopMicros16 = 0;
+  tracked = false;
+  beatMicros = 0;
+  costMicros = 0;
+}
+
+void audioPush(uint16_t raw) {
+  ring[writePos++] = (uint8_t)(raw >> 2);
+  if ((writePos & (AUDIO_FFT_SIZE - 1)) != 0) {
+    return;
+  }
+  const uint8_t hop = (uint8_t)((writePos / AUDIO_FFT_SIZE + kRingHops - 1) % kRingHops);
+  hopEnd[hop] = micros();
+  if (pendingHops < kRingHops - 1) {
+    ++pendingHops;
+  } else {
+    readHop = (readHop + 1) % kRingHops;  // the oldest is overwritten next
+    ++droppedHops;
+  }
+}
+
+bool audioPending() {
+  return pendingHops > 0;
+}
+
+// Copies the oldest waiting hop into `re`, mean removed and windowed;
+// false when there is none. The copy runs with interrupts on: if
+// audioPush() drops the hop meanwhile (the ring filled up), its samples
+// are being overwritten, so the copy is discarded and the next oldest
+// taken instead. The drop is already counted by audioPush().
+static bool takeHop(int16_t* re, unsigned long& end) {
+  for (;;) {
+    noInterrupts();
+    const uint8_t hop = readHop;
+    const bool pending = pendingHops > 0;
+    end = hopEnd[hop];
+    interrupts();
+    if (!pending) return false;
+
+    const uint8_t* samples = &ring[hop * AUDIO_FFT_SIZE];
+    uint16_t sum = 0;
+    for (uint8_t i = 0; i < AUDIO_FFT_SIZE; ++i) sum += samples[i];
+    const int16_t mean = (int16_t)(sum >> AUDIO_FFT_BITS);
+    for (uint8_t i = 0; i < AUDIO_FFT_SIZE; ++i) {
+      const int16_t w = (int16_t)pgm_read_word(&kWindow[i < AUDIO_FFT_SIZE / 2 ? i : AUDIO_FFT_SIZE - 1 - i]);
+      re[i] = (int16_t)(((int32_t)(((int16_t)samples[i] - mean) << 6) * w) >> 15);
+    }
+
+    noInterrupts();
+    const bool intact = readHop == hop;
+    if (intact) {
+      readHop = (hop + 1) % kRingHops;
+      --pendingHops;
+    }
+    interrupts();
+    if (intact) return true;
+  }
+}
+
+// Spectral flux of the hop in re/im (after the FFT), and the band levels.
+static uint32_t spectrum(const int16_t* re, const int16_t* im) {
+  uint32_t flux = 0;
+  for (uint8_t band = 0; band < AUDIO_BANDS; ++band) {
+    uint32_t energy = 0;
+    for (uint8_t k = kBandFirst[band]; k < kBandFirst[band + 1]; ++k) {
+      // |x| ~ max + 3/8 min (alpha max plus beta min, within 7%)
+      uint16_t a = (uint16_t)abs(re[k]);
+      uint16_t b = (uint16_t)abs(im[k]);
+      if (a < b) { uint16_t t = a; a = b; b = t; }
+      const uint16_t m = a + (uint16_t)((3u * b) >> 3);
+      if (m > magnitude[k]) flux += m - magnitude[k];
+      magnitude[k] = m;
+      energy += m;
+    }
+    bandPeak[band] -= bandPeak[band] >> 6;
+    if (energy > bandPeak[band]) bandPeak[band] = energy;
+    bandLevel[band] = bandPeak[band] == 0 ? 0 : (uint8_t)((energy * 255) / bandPeak[band]);
+  }
+  return flux;
+}
+
+// Onset strength 0-255: the flux above its moving average, against the
+// recent peak.
+static uint8_t onsetStrength(uint32_t flux) {
+  const uint32_t onset = (int32_t)flux > fluxMean ? flux - (uint32_t)fluxMean : 0;
+  fluxMean += ((int32_t)flux - fluxMean) / 8;
+  onsetPeak -= onsetPeak >> 7;
+  if (onset > onsetPeak) onsetPeak = onset;
+  return onsetPeak == 0 ? 0 : (uint8_t)((onset * 255) / onsetPeak);
+}
+
+// Beat period in 1/16 hops from the autocorrelation, 0 when no lag stands
+// out.
+static uint16_t trackTempo() {
+  const uint32_t hopMicros = hopMicros16 >> 4;
+  if (hops < 3 * kMaxLag || quietHops > 2 * kMaxLag || hopMicros == 0) return 0;
+  uint32_t lo = 60000000UL / ((uint32_t)AUDIO_BPM_MAX * hopMicros);
+  uint32_t hi = (60000000UL + (uint32_t)AUDIO_BPM_MIN * hopMicros - 1) / ((uint32_t)AUDIO_BPM_MIN * hopMicros);
+  if (lo < kMinLag + 1) lo = kMinLag + 1;
+  if (hi > kMaxLag - 1) hi = kMaxLag - 1;
+  if (lo > hi) return 0;
+
+  uint8_t best = (uint8_t)lo;
+  uint32_t sum = 0;
+  for (uint8_t lag = (uint8_t)lo; lag <= hi; ++lag) {
+    const uint32_t value = autocorr[lag - kMinLag];
+    sum += value;
+    if (value > autocorr[best - kMinLag]) best = lag;
+  }
+  const uint32_t peak = autocorr[best - kMinLag];
+  const uint32_t count = hi - lo + 1;
+  // Four times the mean to start tracking, twice to keep it: noise alone
+  // peaks at about 1.5 times, a steady beat at more than ten.
+  const bool clear = (uint64_t)peak * count > (uint64_t)sum * (tracked ? 2 : 4);
+  if (peak == 0 || !clear) return 0;
+
+  // Parabola through the peak and its neighbours.
+  const int32_t left = (int32_t)autocorr[best - 1 - kMinLag];
+  const int32_t right = (int32_t)autocorr[best + 1 - kMinLag];
+  const int32_t curve = left - 2 * (int32_t)peak + right;
+  int32_t offset = curve == 0 ? 0 : 8 * (left - right) / curve;
+  if (offset > 8) offset = 8;
+  if (offset < -8) offset = -8;
+  return (uint16_t)(best * 16 + offset);
+}
+
+// Hops since the most recent beat: the comb over the last three periods
+// of `lag16` with the most onset strength.
+static uint8_t beatOffset(uint16_t lag16) {
+  const uint8_t period = (uint8_t)((lag16 + 8) >> 4);
+  const uint8_t second = (uint8_t)((2 * lag16 + 8) >> 4);
+  uint8_t best = 0;
+  uint16_t bestSum = 0;
+  for (uint8_t phase = 0; phase < period; ++phase) {
+    const uint8_t at = (uint8_t)(hopIndex - phase);
+    const uint16_t sum = onsets[at] + onsets[(uint8_t)(at - period)] + onsets[(uint8_t)(at - second)];
+    if (sum > bestSum) {
+      bestSum = sum;
+      best = phase;
+    }
+  }
+  return best;
+}
+
+// Moves lastBeat towards `measured` on the grid of beatMicros.
+static void trackPhase(unsigned long measured) {
+  const long period = (long)beatMicros;
+  const long diff = (long)(measured - lastBeat);
+  const long cycles = diff >= 0 ? (diff + period / 2) / period : -((-diff + period / 2) / period);
+  const unsigned long predicted = lastBeat + (unsigned long)(cycles * period);
+  const long error = (long)(measured - predicted);
+  lastBeat = predicted + (unsigned long)(error / (1 << kPhaseShift));
+}
+
+bool audioProcess() {
+  const unsigned long start = micros();
+  int16_t re[AUDIO_FFT_SIZE];
+  int16_t im[AUDIO_FFT_SIZE] = {};
+  unsigned long end;
+  if (!takeHop(re, end)) return false;
+
+  if (hops > 0) {
+    const uint32_t interval16 = (uint32_t)(end - lastHopEnd) << 4;
+    hopMicros16 = hopMicros16 == 0 ? interval16 : hopMicros16 - (hopMicros16 >> 5) + (interval16 >> 5);
+  }
+  lastHopEnd = end;
+
+  audioFft(re, im);
+  const uint8_t onset = onsetStrength(spectrum(re, im));
+  onsets[++hopIndex] = onset;
+  hopStamp[hopIndex % kStamps] = (uint16_t)(end >> 5);
+  for (uint8_t i = 0; i < kLags; ++i) {
+    autocorr[i] -= autocorr[i] >> kAutocorrShift;
+    if (onset != 0) autocorr[i] += (uint16_t)onset * onsets[(uint8_t)(hopIndex - kMinLag - i)];
+  }
+  if (hops < 0xFFFF) ++hops;
+  if (onset >= 128) {
+    quietHops = 0;
+  } else if (quietHops < 0xFF) {
+    ++quietHops;
+  }
+
+  const uint16_t lag16 = trackTempo();
+  if (lag16 == 0) {
+    tracked = false;
+  } else {
+    const uint32_t period = ((uint32_t)lag16 * hopMicros16) >> 8;
+    // The onset is somewhere in its hop: take the middle. The hops are
+    // timed by their stamps, as a show() in one stretches it.
+    const uint8_t at = (uint8_t)(hopIndex - beatOffset(lag16));
+    const uint16_t stamp = (uint16_t)(end >> 5);
+    const uint16_t sinceEnd = (uint16_t)(stamp - hopStamp[at % kStamps]);
+    const uint16_t sinceStart = (uint16_t)(stamp - hopStamp[(uint8_t)(at - 1) % kStamps]);
+    const unsigned long measured = end - (((unsigned long)sinceEnd + sinceStart) << 4);
+    if (!tracked) {
+      beatMicros = period;
+      lastBeat = measured;
+      tracked = true;
+    } else {
+      beatMicros += ((int32_t)period - (int32_t)beatMicros) / 8;
+      trackPhase(measured);
+    }
+  }
+
+  const unsigned long cost = micros() - start;
+  const uint16_t sample = cost > 0xFFFF ? 0xFFFF : (uint16_t)cost;
+  costMicros = costMicros == 0 ? sample : (uint16_t)(costMicros - costMicros / 8 + sample / 8);
+  return true;
+}
+
+uint32_t audioMilliBpm() {
+  return tracked && beatMicros > 0 ? (uint32_t)(60000000000.0f / beatMicros + 0.5f) : 0;
+}
+
+uint16_t audioBeatPhase(unsigned long now) {
+  if (!tracked || beatMicros == 0) return 0;
+  long elapsed = (long)(now - lastBeat) % (long)beatMicros;
+  if (elapsed < 0) elapsed += (long)beatMicros;
+  // elapsed < beatMicros < 2^20: 12 + 4 bits of fraction without overflow
+  return (uint16_t)(((uint32_t)elapsed << 12) / ((beatMicros + 15) >> 4));
+}
+
+uint8_t audioBandLevel(uint8_t band) {
+  return band < AUDIO_BANDS ? bandLevel[band] : 0;
+}
+
+uint16_t audioProcessMicros() {
+  return costMicros;
+}
+
+uint16_t audioDroppedHops() {
+  noInterrupts();
+  const uint16_t dropped = droppedHops;
+  interrupts();
+  return dropped;
+}
+
+#else  // AUDIO_ENABLED
+
+void audioSetup() {}
+void audioPush(uint16_t) {}
+bool audioPending() { return false; }
+bool audioProcess() { return false; }
+uint32_t audioMilliBpm() { return 0; }
+uint16_t audioBeatPhase(unsigned long) { return 0; }
+uint8_t audioBandLevel(uint8_t) { return 0; }
+uint16_t audioProcessMicros() { return 0; }
+uint16_t audioDroppedHops() { return 0; }
+
+#endif  // AUDIO_ENABLED
@@ -0,0 +1,111 @@
+// Audio beat tracking for Digital_RGB_LED
+//
+// With a microphone on AUDIO_MIC_PIN the sketch follows the music: the
+// tracked tempo and beat phase drive the frame timer, so the wave moves
+// AUDIO_BEATS_PER_WAVE beats per cycle and in step with the beat, and the
+// energy of four frequency bands is available to modulate brightness.
+//
+// Pipeline:
+//   - Sampling: on AVR Timer1 starts the ADC conversions at a fixed rate
+//     and they alternate between the microphone and the knobs (knob_adc),
+//     so the microphone is read AUDIO_SAMPLE_RATE times a second. The ADC
+//     interrupt puts each sample into a ring of four hops of
+//     AUDIO_FFT_SIZE 8-bit samples with audioPush() and notes micros()
+//     whenever a hop is complete.
+//   - audioProcess(), one hop per call (the sketch's audio task): the
+//     hop's mean is removed, a Hann window applied and a 64-point Q15 FFT
+//     (scaled by 1/2 per stage) taken. The rise of the bin magnitudes
+//     over the previous hop (spectral flux) above its moving average is
+//     the onset strength.
+//   - Tempo: the onset strengths of the last 256 hops are kept and their
+//     autocorrelation over the lags of the AUDIO_BPM_MIN..AUDIO_BPM_MAX
+//     range is updated incrementally (a leaky sum, ~2 s memory), so a hop
+//     costs one multiply-add per lag instead of a full correlation. The
+//     highest lag, refined by a parabola through its neighbours, is the
+//     beat period; it counts as tracked while it stands at several times
+//     the mean of the others.
+//   - Beat phase: a comb over the last three beat periods of onsets finds
+//     the hop of the most recent beat, timed by the hop's stamps; a loop
+//     filter keeps the beat times on the tempo grid.
+//
+// Hops are converted to time with the measured hop interval, not the
+// nominal AUDIO_FFT_SIZE / AUDIO_SAMPLE_RATE: FastLED.show() keeps
+// interrupts off for ~30 µs per LED, no conversions start meanwhile, and
+// the hops stretch accordingly. The lags cover tempos down to half that
+// rate of samples.
+//
+// Cost: the DSP state is about 1 KB of RAM. audioProcess() reports its
+// time as the "audio" telemetry probe and keeps a moving average
+// (audioProcessMicros()); a hop that is not processed before the ring
+// fills is dropped and counted (audioDroppedHops()). On the host the
+// pipeline is fed from WAV files (host/tools/audio_wav.cpp), which also
+// prints the cost per hop.
+//
+// Without AUDIO_MIC_PIN the functions are stubs and nothing is allocated.
+// Boards other than AVR have no sampling timer here; call audioPush()
+// from one of the board's own to use the tracker there.
+//
+// ──────────────────────────────────────────────────────────────
+// USAGE:
+//   audioSetup();                         // in setup(), before knobAdcStart()
+//   if (audioProcess()) { ... }           // audio task, while audioPending()
+//   uint32_t milliBpm = audioMilliBpm();  // 0 while no beat is tracked
+//   uint16_t phase = audioBeatPhase(micros());  // 0 on the beat, 1/65536 steps
+//   uint8_t bass = audioBandLevel(0);     // 0-255 against the recent peak
+//
+#ifndef AUDIO_H
+#define AUDIO_H
+
+#include <Arduino.h>
+#include "config.h"
+
+#ifdef AUDIO_MIC_PIN
+#define AUDIO_ENABLED 1
+#else
+#define AUDIO_ENABLED 0
+#endif
+
+constexpr uint8_t AUDIO_FFT_BITS = 6;
+constexpr uint8_t AUDIO_FFT_SIZE = 1 << AUDIO_FFT_BITS;  // samples per hop and per transform
+// Bands of audioBandLevel(), at 4 kHz: 60-160 Hz, 190-440 Hz, 500-940 Hz,
+// 1-2 kHz.
+constexpr uint8_t AUDIO_BANDS = 4;
+// Lags (in hops) of the autocorrelation: the AUDIO_BPM_MIN..AUDIO_BPM_MAX
+// range, down to half the nominal hop rate.
+constexpr uint8_t AUDIO_MIN_LAG = 60UL * AUDIO_SAMPLE_RATE / AUDIO_FFT_SIZE / (2 * AUDIO_BPM_MAX);
+constexpr uint8_t AUDIO_MAX_LAG = 60UL * AUDIO_SAMPLE_RATE / AUDIO_FFT_SIZE / AUDIO_BPM_MIN + 2;
+// RAM of the tracker's buffers, for the RAM plan (ram_plan.h): the sample
+// ring and its hop times, the onsets and hop stamps, the previous bins, the
+// autocorrelation and the band levels.
+constexpr uint16_t AUDIO_RAM_BYTES =
+  AUDIO_ENABLED ? 4 * AUDIO_FFT_SIZE + 4 * sizeof(unsigned long) + 256 + 64 * sizeof(uint16_t) +
+                    AUDIO_FFT_SIZE / 2 * sizeof(uint16_t) + (AUDIO_MAX_LAG - AUDIO_MIN_LAG + 1) * sizeof(uint32_t) +
+                    AUDIO_BANDS * (sizeof(uint32_t) + 1)
+                : 0;
+
+// Clears the tracker; the next hop starts a new tempo estimate.
+void audioSetup();
+// One 10-bit sample, from the ADC interrupt (or the host).
+void audioPush(uint16_t raw);
+// True while a complete hop waits for audioProcess().
+bool audioPending();
+// Processes the oldest waiting hop; false when there was none.
+bool audioProcess();
+
+// Tracked tempo in thousandths of a BPM; 0 while no beat is tracked.
+uint32_t audioMilliBpm();
+// Position of `now` in the current beat: 0 on the beat, 65535 just before
+// the next. 0 while no beat is tracked.
+uint16_t audioBeatPhase(unsigned long now);
+// Energy of band `band` in the last hop, 0-255 against its recent peak.
+uint8_t audioBandLevel(uint8_t band);
+// Microseconds audioProcess() took, averaged over the last hops.
+uint16_t audioProcessMicros();
+// Hops dropped because the ring was full.
+uint16_t audioDroppedHops();
+
+// In-place 64-point FFT of Q15 data, scaled by 1/64 (for tests and the
+// host tools).
+void audioFft(int16_t* re, int16_t* im);
+
+#endif  // AUDIO_H
@@ -18,7 +18,7 @@
 //
 //   Example:
 //     #define US_TRIG_PIN 7
-//     #define US_ECHO_PIN 8
+//     #define US_ECHO_PIN 2
 //     #define BRIGHTNESS_KNOB_PIN A0
 //
 // ──────────────────────────────────────────────────────────────
@@ -30,25 +30,56 @@
 #define CONFIG_H
 
 #include <FastLED.h>
-#include "palette.h"  // brings in PREDEFINED_PALETTES + typedefs
+#include "palette.h"  // brings in the palette registry + typedefs
 
 /* ─────────── Debug flag ─────────────── */
 #define DEBUG 0  // set to 1 in config_override.h for verbose logs
+#define TELEMETRY 0  // set to 1 for frame-time histograms (send 't' on Serial, see telemetry.h)
 
 /* ──────────── Hardware pins ──────────── */
 /* If pins are defined, the corresponding device gets loaded */
 #define LED_PIN 31  // Arduino digital pin
 // #define US_TRIG_PIN 7  // Ultrasound TRIG pin
-// #define US_ECHO_PIN 8  // Ultrasound ECHO pin
+// #define US_ECHO_PIN 2  // Ultrasound ECHO pin (must be an interrupt pin)
+// Several ultrasound sensors instead, pinged in turn (see ultrasound.h),
+// each dimming the LEDs it sits over:
+//   US_SENSOR(trigPin, echoPin, firstLed, ledCount)
+/*
+#define US_SENSORS              \
+  US_SENSOR(7, 2, 0, 100)       \
+  US_SENSOR(8, 3, 100, 100)     \
+  US_SENSOR(9, 18, 200, 100)
+*/
 // #define BRIGHTNESS_KNOB_PIN A0  // Potentiometer for brightness
 // #define BPM_KNOB_PIN A0         // Potentiometer for BPM
 // #define WAVE_LENGTH_SCALE_KNOB_PIN A0 // Potentiometer for wave length scale
+// #define PALETTE_BUTTON_PIN 3    // Push button to GND: next palette
+// #define AUDIO_MIC_PIN A3        // Microphone amplifier output biased to VCC/2: beat tracking (uses Timer1, see audio.h)
 
 /* ────────── LED configuration ────────── */
 #define LED_TYPE WS2812B
 #define LED_STRIP_COLOR_CORRECTION TypicalLEDStrip
 #define COLOR_ORDER GRB
 #define NUM_LEDS 300  // total LEDs on the strip
+// Further strips on their own pins, showing the same animation copied from
+// the main strip's render (see strips.h). Each strip's section
+// (length / parts) must not exceed NUM_LEDS / ANIMATION_PARTS.
+//   LED_STRIP(pin, length, parts, "FOLDED" | "CUT", reversed)
+/*
+#define EXTRA_LED_STRIPS \
+  LED_STRIP(32, 300, 1, "CUT", false) \
+  LED_STRIP(33, 150, 2, "FOLDED", true)
+*/
+// Zones of the main strip, each with its own palette wave, shown by the
+// "zones" effect (see zones.h). Ascending, not overlapping; LEDs outside
+// every zone stay dark.
+//   ZONE(first, length, palette, bpm, scale, parts, "FOLDED" | "CUT", reversed)
+/*
+#define ANIMATION_ZONES \
+  ZONE(0, 100, 0, 5.0, 1.0, 1, "CUT", false) \
+  ZONE(100, 120, 2, 12.0, 0.5, 2, "FOLDED", false) \
+  ZONE(220, 80, 6, 3.0, 1.0, 1, "CUT", true)
+*/
 
 /* ─────────── Animation defaults ─────── */
 #define BRIGHTNESS 220  // 0-255, initial brightness
@@ -59,6 +90,23 @@
 #define ANIMATION_PARTS 1  // number of mirrored sections (1 = disabled)
 #define ANIMATION_PARTS_TYPE "FOLDED"  // "FOLDED" mirrors each second segment, "CUT" tiles without mirroring
 #define PALETTE_INDEX 6 // default palette index (0-based)
+// Own palettes, selectable after the predefined ones (from index 8, see
+// palette.h), each kept in PROGMEM:
+//   GRADIENT_PALETTE(name, index, r, g, b, ..., 255, r, g, b)  stops, indices ascending from 0 to 255
+//   COLOR_PALETTE(name, 0xRRGGBB, ... 16 colours)
+/*
+#define CUSTOM_PALETTES \
+  GRADIENT_PALETTE(sunset, 0, 120, 0, 0, 90, 179, 22, 0, 160, 255, 104, 0, 255, 100, 0, 103) \
+  COLOR_PALETTE(police, 0xFF0000, 0xFF0000, 0, 0, 0x0000FF, 0x0000FF, 0, 0, \
+                0xFF0000, 0xFF0000, 0, 0, 0x0000FF, 0x0000FF, 0, 0)
+*/
+#define EFFECT_INDEX 0  // starting effect (effects.h): 0 wave, 1 noise, 2 fire, 3 twinkle, 4 zones
+#define SERIAL_COMMANDS true  // Serial commands: palette '0'-'9', 'n'ext, 'p'revious; next 'e'ffect; telemetry 't', reset 'T'
+#define SERIAL_STREAMING true  // accept frames, patterns and commands from a host in the binary protocol of stream.h
+#define SERIAL_BAUD 115200     // 500000 or 1000000 (exact on 16 MHz AVR) for streaming at full frame rate
+#define RENDER_DIRECT_PALETTE false  // true: render from a 256-colour palette table, no virtual pattern buffer (saves RAM, no VIRTUAL_LEDS_MAX cap)
+#define RENDER_HIGH_PRECISION false  // true: 16-bit pattern, gamma/brightness table and temporal dithering (smooth low brightness; half the VIRTUAL_LEDS_MAX pixels, ~2x render cost)
+#define RENDER_GAMMA 2.2             // gamma of the high-precision output (1.0: same response as the 8-bit path)
 
 /* ────────── Animation limits ────────── */
 #define BRIGHTNESS_MIN 0
@@ -70,17 +118,57 @@
 #define WAVE_LENGTH_SCALE_MIN 0.01
 #define WAVE_LENGTH_SCALE_MAX 8.0
 #define WAVE_LENGTH_SCALE_CHANGE_THRESHOLD 0.075  // minimum change to update scale
+// Longest virtual pattern (pixels). Two patterns are kept in a static arena
+// (2 x 3 bytes per pixel), so longer waves than this are capped; the wave
+// length knob then ends at the longest wave that fits.
+#define VIRTUAL_LEDS_MAX 600
+// The RAM plan (ram_plan.h) must fit in RAM_PLAN_SRAM_BYTES, or in the
+// board's SRAM when 0, or the build fails; RAM_PLAN_RESERVE_BYTES of it are
+// left to the stack, Serial, FastLED and the fixed-size module state.
+#define RAM_PLAN_SRAM_BYTES 0
+#define RAM_PLAN_RESERVE_BYTES 2048
+#define VIRTUAL_LEDS_REBUILD_STEP 64  // pattern pixels generated per pattern task run while rebuilding
+#define OUTPUT_MAX_LATENCY_MS 20  // longest a brightness-only change waits for the next frame's show
+#define PALETTE_FADE_STEP 8  // max change per colour channel in one crossfade pass
+#define PALETTE_FADE_ENTRIES_PER_STEP 16  // palette entries (of 16) faded per pattern task run
+#define PALETTE_BUTTON_DEBOUNCE_MS 30
+#define EFFECT_FIRE_COOLING 55    // fire: how fast the flames cool (higher = shorter flames)
+#define EFFECT_FIRE_SPARKING 120  // fire: chance of a new spark per step, out of 255
+#define EFFECT_TWINKLE_DENSITY 3  // twinkle: lit cycles per 8 (0-8)
+#define POWER_LIMIT_MA 0    // supply budget of all strips in mA; brighter frames are dimmed to fit (0 = no limit, see power.h)
+#define POWER_MA_RED 16     // mA of one LED's red channel at full level (WS2812B)
+#define POWER_MA_GREEN 11   // mA of one LED's green channel at full level
+#define POWER_MA_BLUE 15    // mA of one LED's blue channel at full level
+#define POWER_MA_IDLE 1     // mA of one dark LED
+#define QUALITY_ADAPTIVE true   // render fewer RESOLUTION sub-frames while frames do not fit their period (quality.h)
+#define QUALITY_HIGH_LOAD 90    // % of the time between rendered frames above which quality drops a level
+#define QUALITY_LOW_LOAD 60     // % of the time one level up that frames must stay under for quality to rise
+#define QUALITY_HOLD_FRAMES 64  // rendered frames in a row under QUALITY_LOW_LOAD before quality rises
+#define STREAM_BYTES_PER_LOOP 256    // serial bytes parsed per serial task run while streaming
+#define STREAM_PACKET_TIMEOUT_MS 100  // a packet stalled this long is dropped
+#define STREAM_TIMEOUT_MS 2000        // the animation resumes this long after the last streamed frame
+#define PERSIST_STATE true          // resume palette, effect, brightness, BPM, wave length and phase after a power cycle (EEPROM, persist.h)
+#define PERSIST_EEPROM_OFFSET 0     // first EEPROM byte used
+#define PERSIST_EEPROM_BYTES 4096   // EEPROM bytes the saved records rotate over (wear levelling); the Mega has 4096, an Uno 1024
+#define PERSIST_SAVE_MS 5000        // a changed setting is saved once it has held this long
+#define PERSIST_PHASE_MS 120000     // the animation phase alone is saved this often (EEPROM wear: see persist.h)
 
 /* ────────── Sensor config ────────── */
-// US_MAX_DISTANCE_CM significantly influences performance and blocking time.
-// Lower values reduce blocking time. Examples:
-// US_MAX_DISTANCE_CM = 50 cm => MAX_CM = 55 cm, blocking time ~3.2 ms if no echo.
-// US_MAX_DISTANCE_CM = 40 cm => MAX_CM = 45 cm, blocking time ~2.6 ms if no echo.
-// US_MAX_DISTANCE_CM = 30 cm => MAX_CM = 35 cm, blocking time ~2.0 ms if no echo.
+// Ranging is interrupt driven, so US_MAX_DISTANCE_CM no longer affects how
+// long loop() blocks; echoes beyond US_MAX_DISTANCE_CM + 5 cm are discarded.
 #define US_MAX_DISTANCE_CM 40  // maximum distance to measure (cm)
 #define US_MIN_DISTANCE_CM 5   // minimum distance to consider valid (cm)
+#define US_GUARD_MS 20         // quiet time after a sensor's echo before the next sensor pings (ms)
+#define US_MEDIAN_READINGS 3   // results per sensor the published distance is the median of (odd, <= 7)
 #define KNOB_5V 1023           // analogRead() max value for 5V reference
 #define KNOB_3_3V 675          // analogRead() max value for 3.3V reference
+#define KNOB_ADC_OVERSAMPLE 16  // ADC samples summed per knob reading (power of two, <= 64)
+#define KNOB_ADC_EMA_SHIFT 2    // knob smoothing: each reading moves the value 1/2^n of the way
+#define AUDIO_SAMPLE_RATE 4000  // microphone samples per second (1000-4500; 64 make a hop)
+#define AUDIO_BPM_MIN 80        // tempo range tracked, whole BPM; one octave, so half and double
+#define AUDIO_BPM_MAX 160       //   tempos are not confused
+#define AUDIO_BEATS_PER_WAVE 16  // music beats per wave cycle (one BPM beat) while a beat is tracked
+#define AUDIO_BRIGHTNESS_DEPTH 0  // 0-255: how far quiet bass dims the strip (0 = brightness not modulated)
 
 /* ─────────── Local overrides ─────────── */
 #ifdef __has_include
@@ -91,11 +179,9 @@
 
 /* ─────────── Globals (defined in .ino) ─ */
 extern CRGB leds[NUM_LEDS];
-extern CRGBPalette256 currentPalette;
-extern TBlendType currentBlending;
+extern CRGBPalette16 currentPalette;
 
-/* palette registry (table lives in palette.cpp, pointer lives in .ino) */
-extern const TProgmemRGBPalette16* const* gPalettes;  // pointer to table
+/* palette registry (table and count live in palette.cpp, index in .ino) */
 extern const uint8_t gPaletteCount;
 extern uint8_t gPaletteIndex;
 
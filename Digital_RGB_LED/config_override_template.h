@@ -13,10 +13,11 @@
 /* ──────────── Hardware pins ──────────── */
 // Define only the pins you are actually using. If a pin is not defined, the feature is disabled.
 #define US_TRIG_PIN 7
-#define US_ECHO_PIN 8
+#define US_ECHO_PIN 2  // must be an interrupt pin (Mega: 2, 3, 18, 19, 20, 21)
 #define BRIGHTNESS_KNOB_PIN A0
 #define BPM_KNOB_PIN A0
 #define WAVE_LENGTH_SCALE_KNOB_PIN A0
+#define PALETTE_BUTTON_PIN 3  // push button to GND
 
 // ────────── Animation parameters (optional overrides) ──────────
 #define BRIGHTNESS 220  // Initial brightness (0-255)
@@ -0,0 +1,57 @@
+#include "echo_timer.h"
+
+void echoTimerReset(EchoTimer& timer) {
+  timer.state = EchoState::Idle;
+  timer.riseAt = 0;
+  timer.width = 0;
+  timer.armedAt = 0;
+}
+
+bool echoTimerIdle(const EchoTimer& timer) {
+  return timer.state == EchoState::Idle;
+}
+
+void echoTimerArm(EchoTimer& timer, unsigned long now) {
+  timer.armedAt = now;
+  timer.state = EchoState::WaitRise;
+}
+
+void echoTimerEdge(EchoTimer& timer, bool level, unsigned long now) {
+  if (level && timer.state == EchoState::WaitRise) {
+    timer.riseAt = now;
+    timer.state = EchoState::Echo;
+  } else if (!level && timer.state == EchoState::Echo) {
+    timer.width = now - timer.riseAt;
+    timer.state = EchoState::Done;
+  }
+}
+
+EchoResult echoTimerPoll(EchoTimer& timer, unsigned long now, unsigned long maxWidth, unsigned int* cm) {
+  EchoResult result = EchoResult::Busy;
+
+  noInterrupts();
+  EchoState state = timer.state;
+  if (state == EchoState::Done) {
+    unsigned long width = timer.width;
+    timer.state = EchoState::Idle;
+    if (width <= maxWidth) {
+      // Rounded like NewPing's ping_cm(); any echo reads as at least 1 cm.
+      unsigned long rounded = (width + US_ROUNDTRIP_CM / 2) / US_ROUNDTRIP_CM;
+      *cm = (unsigned int)(rounded ? rounded : 1);
+      result = EchoResult::Ready;
+    } else {
+      result = EchoResult::Timeout;
+    }
+  } else if (state == EchoState::WaitRise && now - timer.armedAt > US_MAX_RISE_DELAY_US) {
+    timer.state = EchoState::Idle;
+    result = EchoResult::Timeout;
+  } else if (state == EchoState::Echo && now - timer.riseAt > maxWidth) {
+    // Still high past the range limit: out of range. The falling edge that
+    // eventually follows is ignored because the timer is idle by then.
+    timer.state = EchoState::Idle;
+    result = EchoResult::Timeout;
+  }
+  interrupts();
+
+  return result;
+}
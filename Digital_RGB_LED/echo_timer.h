@@ -0,0 +1,58 @@
+// Echo pulse timing core for HC-SR04 style ultrasound sensors
+//
+// Pure state machine with no pin access, shared by the ultrasound driver and
+// the host tests. The driver fires the trigger pulse and calls
+// echoTimerArm(); the echo pin interrupt reports every level change through
+// echoTimerEdge(); the main loop calls echoTimerPoll() to collect a finished
+// measurement or to give up on a missing or too distant echo.
+//
+//   Idle -> (arm) -> WaitRise -> (rising edge) -> Echo -> (falling edge) -> Done
+//             WaitRise / Echo -> (timeout in poll) -> Idle
+//
+// echoTimerEdge() only runs in interrupt context and only moves forward
+// (WaitRise -> Echo -> Done); echoTimerPoll() does every other transition with
+// interrupts briefly disabled, so no field is ever written from both sides.
+//
+#ifndef ECHO_TIMER_H
+#define ECHO_TIMER_H
+
+#include <Arduino.h>
+
+// Round-trip echo time per centimetre, in µs (same constant as NewPing).
+constexpr unsigned int US_ROUNDTRIP_CM = 57;
+// Longest time the sensor takes to start its echo pulse after the trigger.
+constexpr unsigned long US_MAX_RISE_DELAY_US = 5800;
+
+enum class EchoState : uint8_t {
+  Idle,
+  WaitRise,
+  Echo,
+  Done,
+};
+
+struct EchoTimer {
+  volatile EchoState state;
+  volatile unsigned long riseAt;  // written by the ISR before state -> Echo
+  volatile unsigned long width;   // written by the ISR before state -> Done
+  unsigned long armedAt;
+};
+
+enum class EchoResult : uint8_t {
+  Busy,     // measurement in progress (or idle)
+  Ready,    // *cm holds a distance; timer is idle again
+  Timeout,  // no echo or echo longer than the range; timer is idle again
+};
+
+void echoTimerReset(EchoTimer& timer);
+bool echoTimerIdle(const EchoTimer& timer);
+
+// Call right after the trigger pulse has been sent.
+void echoTimerArm(EchoTimer& timer, unsigned long now);
+
+// Call from the echo pin change interrupt with the new pin level.
+void echoTimerEdge(EchoTimer& timer, bool level, unsigned long now);
+
+// Call from loop(). maxWidth is the longest echo accepted (range limit).
+EchoResult echoTimerPoll(EchoTimer& timer, unsigned long now, unsigned long maxWidth, unsigned int* cm);
+
+#endif  // ECHO_TIMER_H
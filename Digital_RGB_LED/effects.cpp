@@ -0,0 +1,288 @@
+#include "effects.h"
+#include "config.h"
+#include "ram_plan.h"
+#include "strips.h"
+#include "zones.h"
+#include <string.h>
+
+extern CRGBPalette16 currentPalette;
+
+// LEDs of the independent section, i.e. pixels an effect renders per frame.
+static constexpr long kSectionLeds = kPlanSectionLeds;
+
+// State of the effects, overlaid: only the selected one uses it.
+static union EffectState {
+  uint8_t fireHeat[kSectionLeds];
+} gState;
+static_assert(sizeof(gState) == kPlanEffectBytes, "kPlanEffectBytes (ram_plan.h) must match the effect state");
+
+// What the render key follows: the wave its pattern and phase, the others
+// every frame or every RESOLUTION frames (one simulation step).
+enum class EffectClock : uint8_t {
+  Pattern,
+  Frame,
+  Step,
+};
+
+// Time of a frame in 1/`perStep` steps (a step is RESOLUTION frames),
+// without overflowing on a long-running frame counter.
+static uint32_t stepTime(long frame, int resolution, uint16_t perStep) {
+  if (resolution <= 0) resolution = 1;
+  return (uint32_t)(frame / resolution) * perStep + (uint32_t)((frame % resolution) * perStep / resolution);
+}
+
+// 16-bit integer hash, for per-pixel randomness without stored state.
+static uint16_t hash16(uint16_t x, uint16_t y) {
+  uint16_t h = (uint16_t)(x * 0x6A09u) ^ (uint16_t)(y * 0xBB67u + 0x3C6Fu);
+  h ^= h >> 7;
+  h = (uint16_t)(h * 0xA54Fu);
+  h ^= h >> 9;
+  return h;
+}
+
+// FastLED's random8() LCG, kept local so the effects are reproducible.
+static uint16_t gRandomSeed = 1337;
+
+static uint8_t nextRandom8() {
+  gRandomSeed = (uint16_t)(gRandomSeed * 2053u + 13849u);
+  return (uint8_t)(gRandomSeed + (gRandomSeed >> 8));
+}
+
+static uint8_t nextRandom8(uint8_t lim) {
+  return (uint8_t)(((uint16_t)nextRandom8() * lim) >> 8);
+}
+
+// Quadratic ease in/out, so value noise has no visible kinks at cells.
+static uint8_t ease8(uint8_t i) {
+  uint8_t j = (i & 0x80) ? (uint8_t)(255 - i) : i;
+  uint8_t jj = (uint8_t)(scale8(j, j) << 1);
+  return (i & 0x80) ? (uint8_t)(255 - jj) : jj;
+}
+
+// ── wave ──
+static void waveRebuild(float waveLengthScale) {
+  RequestVirtualLedsRebuild(waveLengthScale);
+}
+
+static void waveRender(long frame, int resolution, float waveLengthScale) {
+  FillLEDsFromPaletteColors(frame, resolution, waveLengthScale);
+}
+
+// ── noise ──
+// Value noise over (position, time) on a lattice of 8.8 fixed-point cells:
+// random values at the corners, eased bilinear interpolation in between.
+// The corners are looked up once per cell, so a pixel costs a lerp, an
+// ease and a palette read.
+static constexpr uint16_t kNoiseCellsPerSection = 8;  // at wave length scale 1
+static constexpr uint16_t kNoiseTimePerStep = 4;      // 1/256 cell per step
+static uint16_t gNoiseStep = 1;  // cell units (1/256) per pixel
+static uint16_t gNoiseTime = 0;
+
+static void noiseRebuild(float waveLengthScale) {
+  if (waveLengthScale <= 0.0f) waveLengthScale = 1.0f;
+  float step = 256.0f * kNoiseCellsPerSection / ((float)kSectionLeds * waveLengthScale);
+  gNoiseStep = step < 1.0f ? 1 : step > 4096.0f ? 4096 : (uint16_t)(step + 0.5f);
+}
+
+static void noiseSection(CRGB* dst, int step, long count) {
+  // Rows wrap with the time: row 255 blends into row 0.
+  const uint8_t cellY = gNoiseTime >> 8;
+  const uint8_t nextY = (uint8_t)(cellY + 1);
+  const uint8_t fy = ease8((uint8_t)gNoiseTime);
+  uint32_t x = 0;
+  uint16_t cellX = 0xFFFF;
+  uint8_t left = 0;
+  uint8_t right = 0;
+  for (long i = 0; i < count; ++i) {
+    uint16_t cell = (uint16_t)(x >> 8);
+    if (cell != cellX) {
+      cellX = cell;
+      left = lerp8by8((uint8_t)hash16(cell, cellY), (uint8_t)hash16(cell, nextY), fy);
+      right = lerp8by8((uint8_t)hash16(cell + 1, cellY), (uint8_t)hash16(cell + 1, nextY), fy);
+    }
+    *dst = paletteSample(currentPalette, lerp8by8(left, right, ease8((uint8_t)x)));
+    dst += step;
+    x += gNoiseStep;
+  }
+}
+
+static void noiseRender(long frame, int resolution, float waveLengthScale) {
+  gNoiseTime = (uint16_t)stepTime(frame, resolution, kNoiseTimePerStep);
+  FillLEDsFromSection(noiseSection);
+}
+
+// ── fire ──
+// Fire2012 (Mark Kriegsman): every step the cells cool a little, heat
+// drifts away from canonical pixel 0, and random sparks ignite near it.
+// Skipped frames are caught up with a few steps; going back in time (a
+// restart of the frame counter) takes a single step.
+static long gFireStep = -1;
+
+static void fireInit() {
+  memset(gState.fireHeat, 0, sizeof(gState.fireHeat));
+  gFireStep = -1;
+  gRandomSeed = 1337;  // same flames after every selection
+}
+
+static void fireStep() {
+  uint8_t* heat = gState.fireHeat;
+  const long n = kSectionLeds;
+  const long cooling = (EFFECT_FIRE_COOLING * 10L) / n + 2;
+  const uint8_t coolingMax = cooling > 255 ? 255 : (uint8_t)cooling;
+  for (long i = 0; i < n; ++i) {
+    heat[i] = qsub8(heat[i], nextRandom8(coolingMax));
+  }
+  for (long k = n - 1; k >= 2; --k) {
+    heat[k] = (uint8_t)(((uint16_t)heat[k - 1] + heat[k - 2] + heat[k - 2]) / 3);
+  }
+  if (nextRandom8() < EFFECT_FIRE_SPARKING) {
+    uint8_t y = nextRandom8(n < 7 ? (uint8_t)n : 7);
+    heat[y] = qadd8(heat[y], (uint8_t)(160 + nextRandom8(95)));
+  }
+}
+
+// FastLED's HeatColor(): black, red, yellow, white.
+static CRGB heatColor(uint8_t temperature) {
+  uint8_t t192 = scale8_video(temperature, 191);
+  uint8_t ramp = (uint8_t)((t192 & 0x3F) << 2);
+  if (t192 & 0x80) return CRGB(255, 255, ramp);
+  if (t192 & 0x40) return CRGB(255, ramp, 0);
+  return CRGB(ramp, 0, 0);
+}
+
+static void fireSection(CRGB* dst, int step, long count) {
+  const uint8_t* heat = gState.fireHeat;
+  for (long i = 0; i < count; ++i) {
+    *dst = heatColor(heat[i]);
+    dst += step;
+  }
+}
+
+static void fireRender(long frame, int resolution, float waveLengthScale) {
+  long step = (long)stepTime(frame, resolution, 1);
+  long steps = gFireStep < 0 ? 1 : step - gFireStep;
+  if (steps < 0 || steps > 8) steps = steps < 0 ? 1 : 8;
+  for (long i = 0; i < steps; ++i) fireStep();
+  gFireStep = step;
+  FillLEDsFromSection(fireSection);
+}
+
+// ── twinkle ──
+// Each pixel runs its own clock (speed and offset from a hash of its
+// index). A cycle of 256 ticks is lit with probability
+// EFFECT_TWINKLE_DENSITY / 8: it fades in and out over the first two
+// thirds in a colour picked per cycle, then stays dark.
+static constexpr uint16_t kTwinkleTicksPerStep = 4;
+static uint32_t gTwinkleTime = 0;
+
+static void twinkleSection(CRGB* dst, int step, long count) {
+  for (long i = 0; i < count; ++i) {
+    uint16_t h = hash16((uint16_t)i, 0x5EED);
+    uint32_t clock = gTwinkleTime * (1 + (h & 3)) + (h >> 2);
+    uint8_t phase = (uint8_t)clock;
+    uint16_t cycle = hash16((uint16_t)i, (uint16_t)(clock >> 8));
+    CRGB c = CRGB::Black;
+    if ((cycle & 7) < EFFECT_TWINKLE_DENSITY && phase < 172) {
+      uint8_t level = phase < 86 ? (uint8_t)(phase * 3) : (uint8_t)((171 - phase) * 3);
+      c = paletteSample(currentPalette, (uint8_t)(cycle >> 8));
+      c.nscale8_video(level);
+    }
+    *dst = c;
+    dst += step;
+  }
+}
+
+static void twinkleRender(long frame, int resolution, float waveLengthScale) {
+  gTwinkleTime = stepTime(frame, resolution, kTwinkleTicksPerStep);
+  FillLEDsFromSection(twinkleSection);
+}
+
+// ── Registry ──
+struct EffectEntry {
+  Effect effect;
+  EffectClock clock;
+};
+
+static const EffectEntry kEffects[] = {
+  { { "wave", 0, nullptr, waveRebuild, waveRender }, EffectClock::Pattern },
+  { { "noise", 0, nullptr, noiseRebuild, noiseRender }, EffectClock::Frame },
+  { { "fire", sizeof(gState.fireHeat), fireInit, nullptr, fireRender }, EffectClock::Step },
+  { { "twinkle", 0, nullptr, nullptr, twinkleRender }, EffectClock::Frame },
+#ifdef ANIMATION_ZONES
+  { { "zones", gZoneRamBytes, zonesInit, nullptr, zonesRender }, EffectClock::Frame },
+#endif
+};
+
+static constexpr uint8_t kEffectCount = sizeof(kEffects) / sizeof(kEffects[0]);
+
+static uint8_t gEffect = 0;
+static uint16_t gEffectGeneration = 0;  // bumped on every selection
+static uint16_t gEffectMicros[kEffectCount];
+
+uint8_t effectCount() {
+  return kEffectCount;
+}
+
+uint8_t effectIndex() {
+  return gEffect;
+}
+
+const char* effectName(uint8_t index) {
+  return index < kEffectCount ? kEffects[index].effect.name : "";
+}
+
+uint16_t effectRamBytes(uint8_t index) {
+  return index < kEffectCount ? kEffects[index].effect.ramBytes : 0;
+}
+
+uint16_t effectFrameMicros(uint8_t index) {
+  return index < kEffectCount ? gEffectMicros[index] : 0;
+}
+
+bool effectSelect(uint8_t index, float waveLengthScale) {
+  if (index >= kEffectCount) {
+    return false;
+  }
+  gEffect = index;
+  ++gEffectGeneration;
+  const Effect& effect = kEffects[index].effect;
+  if (effect.init) effect.init();
+  if (effect.rebuild) effect.rebuild(waveLengthScale);
+  return true;
+}
+
+void effectRebuild(float waveLengthScale) {
+  const Effect& effect = kEffects[gEffect].effect;
+  if (effect.rebuild) effect.rebuild(waveLengthScale);
+}
+
+void effectRender(long frame, int resolution, float waveLengthScale) {
+  unsigned long start = micros();
+  kEffects[gEffect].effect.render(frame, resolution, waveLengthScale);
+  unsigned long elapsed = micros() - start;
+  if (elapsed > 0xFFFF) elapsed = 0xFFFF;
+  // Moving average over about 8 frames.
+  uint16_t& average = gEffectMicros[gEffect];
+  average = average == 0 ? (uint16_t)elapsed : (uint16_t)(((uint32_t)average * 7 + elapsed) / 8);
+}
+
+bool effectScalesBrightness() {
+  return RENDER_HIGH_PRECISION && kEffects[gEffect].clock == EffectClock::Pattern;
+}
+
+bool effectFrameLoad(long frame, int resolution, float waveLengthScale, uint32_t& load) {
+  return kEffects[gEffect].clock == EffectClock::Pattern && FrameLoad(frame, resolution, waveLengthScale, load);
+}
+
+RenderKey effectRenderKey(long frame, int resolution, float waveLengthScale) {
+  const EffectClock clock = kEffects[gEffect].clock;
+  if (clock == EffectClock::Pattern) {
+    return FrameRenderKey(frame, resolution, waveLengthScale);
+  }
+  RenderKey key;
+  key.patternVersion = gEffectGeneration;
+  key.patternLen = -1 - gEffect;  // never equal to a wave key
+  key.baseShift = clock == EffectClock::Step ? (long)stepTime(frame, resolution, 1) : frame;
+  key.blendFactor = 0;
+  return key;
+}
@@ -0,0 +1,83 @@
+// Effect engine for Digital_RGB_LED
+//
+// An effect fills leds[] for one animation frame. The registry is a
+// constant table built at compile time (effects.cpp); selecting an effect
+// only changes an index, nothing is allocated. Every effect except the
+// palette wave renders through FillLEDsFromSection() (animation.h), so it
+// draws the independent section once and ANIMATION_PARTS, the fold type,
+// ANIMATION_REVERSED and the EXTRA_LED_STRIPS apply to it unchanged.
+//
+// Effects:
+//   0 wave     the scrolling palette wave (virtual pattern, RESOLUTION
+//              interpolation, RENDER_DIRECT_PALETTE / RENDER_HIGH_PRECISION)
+//   1 noise    palette colours along smooth value noise drifting in time;
+//              WAVE_LENGTH_SCALE stretches it
+//   2 fire     Fire2012-style heat simulation, one step per frame at
+//              RESOLUTION 1 (EFFECT_FIRE_COOLING / EFFECT_FIRE_SPARKING)
+//   3 twinkle  pixels fading in and out in palette colours; stateless, each
+//              pixel's timing and colour come from a hash of its index
+//   4 zones    each ANIMATION_ZONES zone scrolling its own palette at its
+//              own speed (zones.h); only when ANIMATION_ZONES is defined
+//
+// ──────────────────────────────────────────────────────────────
+// RAM AND COST:
+//   Effect state lives in one static union, so RAM is the largest state,
+//   not the sum: fire keeps one heat byte per section LED, the others
+//   none (effectRamBytes()); the zones keep their own pattern arena. The
+//   render time of the last frames of each effect is measured with
+//   micros() and kept as a moving average (effectFrameMicros()); the
+//   host benchmark (--table effects) reports ns per frame for every
+//   configuration.
+//
+// USAGE:
+//   effectSelect(EFFECT_INDEX, waveLengthScale);      // in setup()
+//   outputMarkFrame(effectRenderKey(looper, resolution, waveLengthScale));
+//   effectRender(looper, resolution, waveLengthScale);  // render callback
+//   effectRebuild(waveLengthScale);                   // wave length changed
+//
+// ADDING AN EFFECT:
+//   Write a SectionRenderFn that fills the independent section, a render
+//   function that updates the effect's time and calls FillLEDsFromSection()
+//   with it, put any state into the EffectState union and append an entry
+//   to kEffects[] in effects.cpp.
+//
+#ifndef EFFECTS_H
+#define EFFECTS_H
+
+#include <FastLED.h>
+#include "animation.h"
+
+struct Effect {
+  const char* name;
+  uint16_t ramBytes;  // state it keeps in the shared effect state
+  // Called when the effect is selected: resets its state.
+  void (*init)();
+  // Called on selection and whenever the wave length scale changes.
+  void (*rebuild)(float waveLengthScale);
+  // Fills leds[] (and the extra strips) for a frame.
+  void (*render)(long frame, int resolution, float waveLengthScale);
+};
+
+uint8_t effectCount();
+uint8_t effectIndex();
+const char* effectName(uint8_t index);
+uint16_t effectRamBytes(uint8_t index);
+// Microseconds the effect's render took, averaged over its last frames
+// (0 until it has rendered).
+uint16_t effectFrameMicros(uint8_t index);
+
+// Switches to effect `index` from the next frame on; false if out of range.
+bool effectSelect(uint8_t index, float waveLengthScale);
+void effectRebuild(float waveLengthScale);
+void effectRender(long frame, int resolution, float waveLengthScale);
+// True when the current effect applies the brightness in its render (the
+// palette wave with RENDER_HIGH_PRECISION, see outputRenderScalesBrightness()).
+bool effectScalesBrightness();
+// Identifies the frame effectRender() would produce, like FrameRenderKey().
+RenderKey effectRenderKey(long frame, int resolution, float waveLengthScale);
+// Load (power.h) of the frame effectRender() would produce, when it can be
+// known before rendering: FrameLoad() for the palette wave; false for the
+// other effects.
+bool effectFrameLoad(long frame, int resolution, float waveLengthScale, uint32_t& load);
+
+#endif  // EFFECTS_H
@@ -0,0 +1,95 @@
+#include "frame_timer.h"
+#include "config.h"
+
+// µs per minute times the milliBPM scale: period = kPeriodNumerator / rateDivisor.
+static const uint64_t kPeriodNumerator = 60ULL * 1000000ULL * 1000ULL;
+
+uint32_t bpmToMilliBpm(float bpm) {
+  if (bpm <= 0.0f) {
+    return 0;
+  }
+  return (uint32_t)(bpm * 1000.0f + 0.5f);
+}
+
+static uint32_t rateDivisorFor(float bpm, int resolution) {
+  if (resolution < 1) {
+    resolution = 1;
+  }
+  uint64_t divisor = (uint64_t)bpmToMilliBpm(bpm) * (uint64_t)NUM_LEDS * (uint64_t)resolution;
+  if (divisor > 0xFFFFFFFFULL) {
+    divisor = 0xFFFFFFFFULL;
+  }
+  return (uint32_t)divisor;
+}
+
+static void applyDivisor(FrameTimer& timer, uint32_t divisor) {
+  timer.rateDivisor = divisor;
+  timer.carry = 0;
+  if (divisor == 0) {
+    timer.periodMicros = 0;
+    timer.periodRemainder = 0;
+    return;
+  }
+  timer.periodMicros = (uint32_t)(kPeriodNumerator / divisor);
+  timer.periodRemainder = (uint32_t)(kPeriodNumerator % divisor);
+}
+
+// Moves nextDue forward by one exact period: the whole µs plus the
+// fractional remainder, carrying a µs once it adds up to the divisor
+// (written so the carry cannot overflow 32 bits).
+static void advanceBoundary(FrameTimer& timer) {
+  timer.nextDue += timer.periodMicros;
+  uint32_t headroom = timer.rateDivisor - timer.periodRemainder;
+  if (timer.carry >= headroom) {
+    timer.carry -= headroom;
+    timer.nextDue += 1;
+  } else {
+    timer.carry += timer.periodRemainder;
+  }
+}
+
+void frameTimerStart(FrameTimer& timer, float bpm, int resolution, unsigned long now) {
+  applyDivisor(timer, rateDivisorFor(bpm, resolution));
+  timer.nextDue = now;
+  if (timer.rateDivisor != 0) {
+    advanceBoundary(timer);
+  }
+}
+
+void frameTimerSetRate(FrameTimer& timer, float bpm, int resolution, unsigned long now) {
+  uint32_t oldDivisor = timer.rateDivisor;
+  uint32_t newDivisor = rateDivisorFor(bpm, resolution);
+  if (newDivisor == oldDivisor) {
+    return;
+  }
+  if (oldDivisor == 0 || newDivisor == 0) {
+    // Starting from (or going to) a standstill: no phase to preserve.
+    applyDivisor(timer, newDivisor);
+    timer.nextDue = now;
+    if (timer.rateDivisor != 0) {
+      advanceBoundary(timer);
+    }
+    return;
+  }
+
+  // Keep the fraction of the current frame that is still to go: the time
+  // left scales with the period, i.e. inversely with the divisor.
+  long remaining = (long)(timer.nextDue - now);
+  if (remaining < 0) {
+    remaining = 0;
+  }
+  applyDivisor(timer, newDivisor);
+  timer.nextDue = now + (unsigned long)(((uint64_t)remaining * oldDivisor) / newDivisor);
+}
+
+long frameTimerAdvance(FrameTimer& timer, unsigned long now) {
+  if (timer.rateDivisor == 0) {
+    return 0;
+  }
+  long frames = 0;
+  while ((long)(now - timer.nextDue) >= 0) {
+    advanceBoundary(timer);
+    ++frames;
+  }
+  return frames;
+}
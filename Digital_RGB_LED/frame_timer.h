@@ -0,0 +1,45 @@
+// Fixed-point frame timer for Digital_RGB_LED
+//
+// Decides when the animation advances by one frame. The frame rate is
+//   bpm * NUM_LEDS * resolution / 60   frames per second
+// (one beat = NUM_LEDS start indices, RESOLUTION sub-frames each).
+//
+// The frame period 60e9 / (milliBPM * NUM_LEDS * resolution) µs is kept as an
+// exact rational: a whole-µs part plus a remainder that is carried from frame
+// to frame (Bresenham style). Frame boundaries therefore never drift, periods
+// below 1 ms are fine, and the per-frame work is two 32-bit additions; the
+// 64-bit division only runs when the rate changes.
+//
+// ──────────────────────────────────────────────────────────────
+// USAGE:
+//   FrameTimer timer;
+//   frameTimerStart(timer, bpm, resolution, micros());      // in setup()
+//   long frames = frameTimerAdvance(timer, micros());       // every loop()
+//   frameTimerSetRate(timer, newBpm, resolution, micros()); // on BPM change
+//
+//   frameTimerAdvance() returns how many frame boundaries passed since the
+//   previous call (0 = nothing to do, >1 = frames were skipped).
+//   frameTimerSetRate() keeps the phase inside the current frame, so a BPM
+//   change does not make the animation jump.
+//
+#ifndef FRAME_TIMER_H
+#define FRAME_TIMER_H
+
+#include <Arduino.h>
+
+struct FrameTimer {
+  unsigned long nextDue;   // micros() timestamp of the next frame boundary
+  uint32_t periodMicros;   // whole µs part of the frame period
+  uint32_t periodRemainder;  // fractional part, in units of 1/rateDivisor µs
+  uint32_t rateDivisor;    // milliBPM * NUM_LEDS * resolution (0 = stopped)
+  uint32_t carry;          // accumulated fractional µs, < rateDivisor
+};
+
+// BPM as an integer number of thousandths (the timer's BPM resolution).
+uint32_t bpmToMilliBpm(float bpm);
+
+void frameTimerStart(FrameTimer& timer, float bpm, int resolution, unsigned long now);
+void frameTimerSetRate(FrameTimer& timer, float bpm, int resolution, unsigned long now);
+long frameTimerAdvance(FrameTimer& timer, unsigned long now);
+
+#endif  // FRAME_TIMER_H
@@ -37,6 +37,10 @@
 //
 //   This function does not mutate any global state.
 //
+//   calculateKnobValueForPinFixed<T>() and mapKnobReading<T>() (below) do the
+//   same with integer math; the sketch maps filtered readings from
+//   knob_adc.h with mapKnobReading<T>().
+//
 
 #ifndef KNOB_H
 #define KNOB_H
@@ -57,4 +61,37 @@ T calculateKnobValueForPin(uint8_t knobPin, T varMin, T varMax, int knobMin = 0,
   return (T)(varMin + normalized * (varMax - varMin));
 }
 
+// ── Fixed-point variants ──
+// Same mapping without floating point in the knob path. `reading` is in
+// 1/64 ADC steps (analogRead() << 6, or a filtered value from knob_adc.h);
+// knobMin/knobMax stay in analogRead() units. The position is computed as
+// a 0..65536 fraction with integer math; only the final scaling to T uses
+// T's arithmetic (integer for integer T). Integer spans must stay below
+// 32768.
+inline long scaleKnobSpan(long span, uint32_t fraction) {
+  return (span * (long)fraction) >> 16;
+}
+inline long scaleKnobSpan(int span, uint32_t fraction) {
+  return scaleKnobSpan((long)span, fraction);
+}
+inline float scaleKnobSpan(float span, uint32_t fraction) {
+  return span * (float)fraction * (1.0f / 65536.0f);
+}
+
+template<typename T>
+T mapKnobReading(uint16_t reading, T varMin, T varMax, int knobMin = 0, int knobMax = KNOB_5V) {
+  const uint32_t lo = (uint32_t)knobMin << 6;
+  const uint32_t hi = (uint32_t)knobMax << 6;
+  uint32_t x = reading;
+  if (x < lo) x = lo;
+  if (x > hi) x = hi;
+  uint32_t fraction = ((x - lo) << 10) / (uint32_t)(knobMax - knobMin);  // 0 .. 65536
+  return (T)(varMin + scaleKnobSpan(varMax - varMin, fraction));
+}
+
+template<typename T>
+T calculateKnobValueForPinFixed(uint8_t knobPin, T varMin, T varMax, int knobMin = 0, int knobMax = KNOB_5V) {
+  return mapKnobReading<T>((uint16_t)(analogRead(knobPin) << 6), varMin, varMax, knobMin, knobMax);
+}
+
 #endif  // KNOB_H
@@ -0,0 +1,164 @@
+#include "knob_adc.h"
+#include "audio.h"
+
+static_assert(KNOB_ADC_OVERSAMPLE >= 1 && KNOB_ADC_OVERSAMPLE <= 64
+                && (KNOB_ADC_OVERSAMPLE & (KNOB_ADC_OVERSAMPLE - 1)) == 0,
+              "KNOB_ADC_OVERSAMPLE must be a power of two between 1 and 64");
+
+// log2(KNOB_ADC_OVERSAMPLE): a block sum of 10-bit samples carries that
+// many fraction bits; it is shifted up to KNOB_ADC_FRACTION_BITS.
+static constexpr uint8_t oversampleBits(uint8_t n) {
+  return n <= 1 ? 0 : 1 + oversampleBits(n >> 1);
+}
+static constexpr uint8_t kBlockShift = KNOB_ADC_FRACTION_BITS - oversampleBits(KNOB_ADC_OVERSAMPLE);
+
+static uint8_t pins[KNOB_ADC_MAX_KNOBS];
+static uint8_t knobCount = 0;
+static volatile uint16_t filtered[KNOB_ADC_MAX_KNOBS];
+static volatile bool primed[KNOB_ADC_MAX_KNOBS];
+
+// Touched only by knobAdcSample() (the ISR on AVR).
+static uint8_t current = 0;
+static uint16_t blockSum = 0;
+static uint8_t blockSamples = 0;
+
+uint8_t knobAdcAdd(uint8_t pin) {
+  if (knobCount >= KNOB_ADC_MAX_KNOBS) {
+    return 0xFF;
+  }
+  pins[knobCount] = pin;
+  filtered[knobCount] = 0;
+  primed[knobCount] = false;
+  return knobCount++;
+}
+
+uint8_t knobAdcCurrentPin() {
+  return pins[current];
+}
+
+bool knobAdcSample(uint16_t raw) {
+  blockSum += raw;
+  if (++blockSamples < KNOB_ADC_OVERSAMPLE) {
+    return false;
+  }
+
+  uint16_t value = blockSum << kBlockShift;
+  if (!primed[current]) {
+    filtered[current] = value;  // start from the first reading, not from 0
+    primed[current] = true;
+  } else {
+    int32_t delta = (int32_t)value - (int32_t)filtered[current];
+    filtered[current] = (uint16_t)((int32_t)filtered[current] + delta / (1 << KNOB_ADC_EMA_SHIFT));
+  }
+
+  blockSum = 0;
+  blockSamples = 0;
+  if (++current >= knobCount) {
+    current = 0;
+  }
+  return true;
+}
+
+uint16_t knobAdcRead(uint8_t slot) {
+  if (slot >= knobCount) {
+    return 0;
+  }
+  noInterrupts();  // 16-bit value written by the ISR
+  uint16_t value = filtered[slot];
+  interrupts();
+  return value;
+}
+
+bool knobAdcReady(uint8_t slot) {
+  return slot < knobCount && primed[slot];
+}
+
+#if defined(__AVR__) && (KNOB_ADC_ENABLED || AUDIO_ENABLED)
+
+// ADC channel of an analog pin (A0 -> 0 ...).
+static uint8_t channelForPin(uint8_t pin) {
+#ifdef analogPinToChannel
+  return analogPinToChannel(pin >= A0 ? pin - A0 : pin);
+#else
+  return pin >= A0 ? pin - A0 : pin;
+#endif
+}
+
+// AVcc reference, right-adjusted result, channel select (MUX5 on the Mega).
+static void selectChannel(uint8_t channel) {
+#ifdef MUX5
+  ADCSRB = (ADCSRB & ~_BV(MUX5)) | (((channel >> 3) & 0x01) << MUX5);
+#endif
+  ADMUX = _BV(REFS0) | (channel & 0x07);
+}
+
+#if AUDIO_ENABLED
+
+// With a microphone, Timer1 starts the conversions (auto trigger on
+// compare match B) at a fixed rate, alternating between the microphone
+// and the current knob, so the microphone is sampled at AUDIO_SAMPLE_RATE.
+// A new channel applies from the conversion after the one running; if the
+// interrupt is held off past the next trigger (FastLED.show()) one sample
+// may be counted for the wrong input.
+static bool micConverting = true;
+
+ISR(ADC_vect) {
+  const uint16_t value = ADC;
+  const bool mic = micConverting;
+  micConverting = !mic || knobCount == 0;
+  if (!mic) knobAdcSample(value);  // may move on to the next knob
+  selectChannel(channelForPin(micConverting ? AUDIO_MIC_PIN : knobAdcCurrentPin()));
+  if (mic) audioPush(value);
+}
+
+// The compare match B flag has to be cleared for the next trigger.
+EMPTY_INTERRUPT(TIMER1_COMPB_vect);
+
+void knobAdcStart() {
+  micConverting = true;
+  selectChannel(channelForPin(AUDIO_MIC_PIN));
+  const uint32_t conversionsPerSecond = (uint32_t)AUDIO_SAMPLE_RATE * (knobCount == 0 ? 1 : 2);
+  TCCR1A = 0;
+  TCCR1B = _BV(WGM12) | _BV(CS10);  // CTC, no prescaler
+  OCR1A = (uint16_t)(F_CPU / conversionsPerSecond - 1);
+  OCR1B = OCR1A;
+  TIMSK1 = _BV(OCIE1B);
+  ADCSRB |= _BV(ADTS2) | _BV(ADTS0);  // trigger: Timer1 compare match B
+  ADCSRA = _BV(ADEN) | _BV(ADIE) | _BV(ADATE) | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);
+}
+
+#else  // no microphone: back-to-back conversions
+
+ISR(ADC_vect) {
+  if (knobAdcSample(ADC)) {
+    selectChannel(channelForPin(knobAdcCurrentPin()));
+  }
+  ADCSRA |= _BV(ADSC);  // next conversion (~104 µs at prescaler 128)
+}
+
+void knobAdcStart() {
+  if (knobCount == 0) {
+    return;
+  }
+  selectChannel(channelForPin(knobAdcCurrentPin()));
+  // Enable, interrupt on completion, 16 MHz / 128 = 125 kHz ADC clock,
+  // start the first conversion.
+  ADCSRA = _BV(ADEN) | _BV(ADIE) | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0) | _BV(ADSC);
+}
+
+#endif  // AUDIO_ENABLED
+
+void knobAdcPoll() {}
+
+#else  // no ADC interrupt: sample from loop()
+
+void knobAdcStart() {}
+
+void knobAdcPoll() {
+  if (knobCount == 0) {
+    return;
+  }
+  knobAdcSample((uint16_t)analogRead(knobAdcCurrentPin()));
+}
+
+#endif
@@ -0,0 +1,56 @@
+// Interrupt-driven knob sampling for Digital_RGB_LED
+//
+// Replaces the blocking analogRead() per knob per loop() (~112 µs each on
+// AVR) with a background pipeline:
+//   - On AVR the ADC converts continuously: its conversion-complete
+//     interrupt stores the result, starts the next conversion and moves to
+//     the next knob channel after KNOB_ADC_OVERSAMPLE samples.
+//   - Each knob's oversampled block is fed through a fixed-point
+//     exponential moving average (weight 1 / 2^KNOB_ADC_EMA_SHIFT).
+//   - loop() reads the filtered value of a knob in O(1), without waiting.
+// With a microphone (AUDIO_MIC_PIN, audio.h) Timer1 paces the conversions
+// instead, alternating between the microphone and the knobs.
+// Other boards have no ADC interrupt here; there knobAdcPoll() takes one
+// analogRead() sample per call through the same filter.
+//
+// Values are in 1/64 ADC steps: knobAdcRead() >> KNOB_ADC_FRACTION_BITS is
+// the analogRead() scale (0..1023). Map them with mapKnobReading() from
+// knob.h, which needs no floating point.
+//
+// While the pipeline runs it owns the ADC: do not call analogRead()
+// elsewhere in the sketch.
+//
+#ifndef KNOB_ADC_H
+#define KNOB_ADC_H
+
+#include <Arduino.h>
+#include "config.h"
+
+#if defined(BRIGHTNESS_KNOB_PIN) || defined(BPM_KNOB_PIN) || defined(WAVE_LENGTH_SCALE_KNOB_PIN)
+#define KNOB_ADC_ENABLED 1
+#else
+#define KNOB_ADC_ENABLED 0
+#endif
+
+constexpr uint8_t KNOB_ADC_MAX_KNOBS = 4;
+constexpr uint8_t KNOB_ADC_FRACTION_BITS = 6;
+
+// Registers an analog pin and returns its slot (or 0xFF when full).
+// Call for every knob before knobAdcStart().
+uint8_t knobAdcAdd(uint8_t pin);
+void knobAdcStart();
+// Non-AVR boards: takes one sample. On AVR the interrupt does the work and
+// this does nothing.
+void knobAdcPoll();
+// Filtered value of a slot, in 1/64 ADC steps.
+uint16_t knobAdcRead(uint8_t slot);
+// False until the slot's first oversampled block is in.
+bool knobAdcReady(uint8_t slot);
+
+// Filter core, shared by the interrupt and the polling path: accounts one
+// raw 10-bit sample of the current knob and returns true when the pipeline
+// moved on to the next knob (see knobAdcCurrentPin()).
+bool knobAdcSample(uint16_t raw);
+uint8_t knobAdcCurrentPin();
+
+#endif  // KNOB_ADC_H
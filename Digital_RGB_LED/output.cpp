@@ -0,0 +1,129 @@
+#include "output.h"
+#include "config.h"
+#include "power.h"
+#include "telemetry.h"
+#include <FastLED.h>
+
+static const uint8_t RENDER_FLAGS = OUTPUT_DIRTY_FRAME | OUTPUT_DIRTY_PATTERN;
+static const unsigned long MAX_LATENCY_US = (unsigned long)OUTPUT_MAX_LATENCY_MS * 1000UL;
+
+static OutputRenderFn renderFn = nullptr;
+static uint8_t dirty = 0;
+static bool renderStale = false;  // leds[] lags behind a frame dropped while dark
+static uint8_t brightness = 0;
+static bool renderScales = false;  // the render applies brightness, show at full scale
+static uint8_t shownBrightness = 0;
+static uint32_t load = 0;  // of the frame in leds[], see outputSetLoad()
+static bool shownOnce = false;
+static unsigned long lastShow = 0;
+static RenderKey lastKey;
+static bool haveKey = false;
+static OutputStats stats;
+
+void outputSetup(OutputRenderFn render, uint8_t initialBrightness) {
+  renderFn = render;
+  brightness = initialBrightness;
+  renderScales = false;
+  dirty = RENDER_FLAGS;
+  renderStale = false;
+  shownOnce = false;
+  haveKey = false;
+  load = 0;
+  stats = OutputStats();
+}
+
+void outputMarkDirty(uint8_t flags) {
+  if (dirty != 0) {
+    ++stats.coalesced;
+  }
+  dirty |= flags;
+}
+
+void outputSetBrightness(uint8_t newBrightness) {
+  if (newBrightness == brightness) {
+    return;
+  }
+  brightness = newBrightness;
+  outputMarkDirty(renderScales ? OUTPUT_DIRTY_PATTERN : OUTPUT_DIRTY_BRIGHTNESS);
+}
+
+void outputRenderScalesBrightness(bool scales) {
+  if (scales == renderScales) {
+    return;
+  }
+  renderScales = scales;
+  outputMarkDirty(OUTPUT_DIRTY_PATTERN);
+}
+
+uint8_t outputBrightness() {
+  return brightness;
+}
+
+void outputSetLoad(uint32_t frameLoad) {
+  load = frameLoad;
+}
+
+uint8_t outputShowBrightness() {
+  return powerLimitBrightness(load, brightness);
+}
+
+void outputMarkFrame(const RenderKey& key) {
+  if (haveKey && key == lastKey) {
+    ++stats.skipped;
+    return;
+  }
+  lastKey = key;
+  haveKey = true;
+  outputMarkDirty(OUTPUT_DIRTY_FRAME);
+}
+
+bool outputPending(unsigned long now) {
+  if (dirty == 0) {
+    return false;
+  }
+  // Brightness only: wait for the next frame to carry it, up to the latency.
+  return (dirty & RENDER_FLAGS) != 0 || !shownOnce || now - lastShow >= MAX_LATENCY_US;
+}
+
+bool outputUpdate(unsigned long now) {
+  if (!outputPending(now)) {
+    return false;
+  }
+
+  bool needsRender = (dirty & RENDER_FLAGS) != 0;
+
+  // Dark and already shown dark: the strip cannot change. Remember to
+  // render once brightness comes back.
+  if (brightness == 0 && shownOnce && shownBrightness == 0) {
+    renderStale = renderStale || needsRender;
+    dirty = 0;
+    ++stats.skipped;
+    return false;
+  }
+
+  if ((needsRender || renderStale) && renderFn) {
+    tel::Timer renderTimer;
+    renderFn();
+    renderTimer.stop(tel::Probe::Render);
+    renderStale = false;
+  }
+  const uint8_t limited = outputShowBrightness();
+  if (tel::enabled) {
+    tel::power(powerMilliamps(load, limited), limited < brightness);
+  }
+  tel::Timer showTimer;
+  FastLED.setBrightness(renderScales ? 255 : limited);
+  FastLED.show();
+  showTimer.stop(tel::Probe::Show);
+
+  shownBrightness = brightness;
+  shownOnce = true;
+  lastShow = now;
+  dirty = 0;
+  ++stats.shows;
+  return true;
+}
+
+const OutputStats& outputStats() {
+  return stats;
+}
@@ -0,0 +1,66 @@
+// Frame-coalescing output stage for Digital_RGB_LED
+//
+// Everything that changes what the strip shows (a new animation frame, a new
+// virtual pattern, a brightness change from a knob or the ultrasound sensor)
+// reports it here as a dirty flag instead of calling FastLED.show() itself.
+// outputUpdate(), run by the sketch's frame task (scheduler.h), then renders
+// and pushes at most one frame:
+//   - frame / pattern changes are rendered and shown right away (the frame
+//     timer already paces them),
+//   - brightness-only changes ride along with the next frame, or are shown
+//     on their own once OUTPUT_MAX_LATENCY_MS has passed since the last show,
+//   - nothing is shown when nothing visible changed: a frame whose RenderKey
+//     equals the last one, or any update while brightness stays at 0.
+//
+// Counters (outputStats()) record shows, requests merged into another show
+// (coalesced) and shows dropped because they would not change the strip
+// (skipped).
+//
+// With POWER_LIMIT_MA (power.h) the render callback reports the load of the
+// frame it renders through outputSetLoad(), and every show, brightness-only
+// ones included, uses the highest brightness within the budget.
+//
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <Arduino.h>
+#include "animation.h"
+
+enum : uint8_t {
+  OUTPUT_DIRTY_FRAME = 0x01,       // animation phase advanced (render + show)
+  OUTPUT_DIRTY_PATTERN = 0x02,     // virtual pattern or palette changed (render + show)
+  OUTPUT_DIRTY_BRIGHTNESS = 0x04,  // global brightness changed (show only)
+};
+
+struct OutputStats {
+  unsigned long shows;
+  unsigned long coalesced;
+  unsigned long skipped;
+};
+
+// Renders the current animation state into leds[] (no show).
+typedef void (*OutputRenderFn)();
+
+void outputSetup(OutputRenderFn render, uint8_t brightness);
+void outputMarkDirty(uint8_t flags);
+void outputSetBrightness(uint8_t brightness);
+// With true, the render callback applies the brightness itself (reading
+// outputBrightness()), FastLED shows at full brightness, and a brightness
+// change re-renders instead of only re-showing. Used by the high-precision
+// render (RENDER_HIGH_PRECISION), which folds brightness into its dither.
+void outputRenderScalesBrightness(bool scales);
+uint8_t outputBrightness();
+// Load (power.h) of the frame in leds[]; reported by the render callback,
+// before rendering when the render needs outputShowBrightness().
+void outputSetLoad(uint32_t load);
+// outputBrightness() limited to POWER_LIMIT_MA for the reported load.
+uint8_t outputShowBrightness();
+// Marks a new frame, unless it would look exactly like the last one.
+void outputMarkFrame(const RenderKey& key);
+// True when outputUpdate() has something to do now.
+bool outputPending(unsigned long nowMicros);
+// Renders and shows if something is due. Returns true when it showed.
+bool outputUpdate(unsigned long nowMicros);
+const OutputStats& outputStats();
+
+#endif  // OUTPUT_H
@@ -2,20 +2,91 @@
 #include "palette.h"
 #include <FastLED.h>
 
-extern CRGBPalette256 currentPalette;
-
-
-const TProgmemRGBPalette16* const PREDEFINED_PALETTES[] = {
-  &OceanColors_p,
-  &CloudColors_p,
-  &LavaColors_p,
-  &HeatColors_p,
-  &ForestColors_p,
-  &PartyColors_p,
-  &RainbowColors_p,
-  &RainbowStripeColors_p
+extern CRGBPalette16 currentPalette;
+
+// A valid gradient: whole (index, r, g, b) stops, at least two, indices
+// ascending from 0 to 255.
+static constexpr bool gradientValid(const uint8_t* gradient, size_t size, size_t at = 0) {
+  return size >= 8 && size % 4 == 0 && gradient[0] == 0 && gradient[size - 4] == 255 &&
+         (at + 8 > size || (gradient[at] <= gradient[at + 4] && gradientValid(gradient, size, at + 4)));
+}
+
+// One registry entry: a 16-entry palette or a gradient, both in PROGMEM.
+struct PaletteDef {
+  const TProgmemRGBPalette16* colors;
+  const uint8_t* gradient;
 };
 
+#ifdef CUSTOM_PALETTES
+#define GRADIENT_PALETTE(name, ...)                                              \
+  static constexpr uint8_t kGradient_##name[] PROGMEM = { __VA_ARGS__ };         \
+  static_assert(gradientValid(kGradient_##name, sizeof(kGradient_##name)),       \
+                "GRADIENT_PALETTE " #name ": stops must be (index, r, g, b) with indices ascending from 0 to 255");
+#define COLOR_PALETTE(name, ...) \
+  static const TProgmemRGBPalette16 kColors_##name PROGMEM = { __VA_ARGS__ };
+CUSTOM_PALETTES
+#undef GRADIENT_PALETTE
+#undef COLOR_PALETTE
+#define GRADIENT_PALETTE(name, ...) { nullptr, kGradient_##name },
+#define COLOR_PALETTE(name, ...) { &kColors_##name, nullptr },
+#else
+#define CUSTOM_PALETTES
+#endif  // CUSTOM_PALETTES
+
+static const PaletteDef kPalettes[] PROGMEM = {
+  { &OceanColors_p, nullptr },
+  { &CloudColors_p, nullptr },
+  { &LavaColors_p, nullptr },
+  { &HeatColors_p, nullptr },
+  { &ForestColors_p, nullptr },
+  { &PartyColors_p, nullptr },
+  { &RainbowColors_p, nullptr },
+  { &RainbowStripeColors_p, nullptr },
+  CUSTOM_PALETTES
+};
+
+#undef GRADIENT_PALETTE
+#undef COLOR_PALETTE
+
+const uint8_t gPaletteCount = sizeof(kPalettes) / sizeof(kPalettes[0]);
+
+void paletteLoad(uint8_t index, CRGBPalette16& out) {
+  if (index >= gPaletteCount) {
+    index = 0;
+  }
+  const uint8_t* gradient = (const uint8_t*)pgm_read_ptr(&kPalettes[index].gradient);
+  if (gradient != nullptr) {
+    paletteLoadGradient(gradient, out);
+  } else {
+    out = *(const TProgmemRGBPalette16*)pgm_read_ptr(&kPalettes[index].colors);
+  }
+}
+
+static CRGB gradientColor(const uint8_t* stop) {
+  return CRGB(pgm_read_byte(stop + 1), pgm_read_byte(stop + 2), pgm_read_byte(stop + 3));
+}
+
+void paletteLoadGradient(const uint8_t* gradient, CRGBPalette16& out) {
+  const uint8_t* stop = gradient;  // the last stop at or before the entry
+  for (uint8_t k = 0; k < 16; ++k) {
+    const uint8_t x = k * 17;
+    while (pgm_read_byte(stop) < 255 && pgm_read_byte(stop + 4) <= x) {
+      stop += 4;
+    }
+    const uint8_t from = pgm_read_byte(stop);
+    if (from == x || from == 255) {
+      out[k] = gradientColor(stop);
+      continue;
+    }
+    // from < x < to: the fraction of the way to the next stop in 1/256ths.
+    const uint8_t to = pgm_read_byte(stop + 4);
+    const uint8_t f = (uint8_t)(((uint16_t)(x - from) << 8) / (uint16_t)(to - from));
+    const CRGB a = gradientColor(stop);
+    const CRGB b = gradientColor(stop + 4);
+    out[k] = CRGB(lerp8by8(a.r, b.r, f), lerp8by8(a.g, b.g, f), lerp8by8(a.b, b.b, f));
+  }
+}
+
 void SetupBlackAndWhiteStripedPalette() {
   fill_solid(currentPalette, 16, CRGB::Black);
   currentPalette[0] = CRGB::White;
@@ -54,3 +125,63 @@ const TProgmemPalette16 myRedWhiteBluePalette_p PROGMEM = {
   CRGB::Black,
   CRGB::Black
 };
+
+// Fade state: the target, the next entry to move and whether the pass so
+// far has left anything short of the target.
+static CRGBPalette16 fadeTarget;
+static bool fadeActive = false;
+static uint8_t fadeCursor = 0;
+static bool fadeIncomplete = false;
+
+// Moves one channel toward its target by at most PALETTE_FADE_STEP.
+static uint8_t fadeChannel(uint8_t current, uint8_t target) {
+  if (current < target) {
+    return (target - current > PALETTE_FADE_STEP) ? current + PALETTE_FADE_STEP : target;
+  }
+  return (current - target > PALETTE_FADE_STEP) ? current - PALETTE_FADE_STEP : target;
+}
+
+void paletteFadeTo(const TProgmemRGBPalette16& target) {
+  paletteFadeTo(CRGBPalette16(target));
+}
+
+void paletteFadeTo(const CRGBPalette16& target) {
+  fadeTarget = target;
+  fadeActive = true;
+  fadeCursor = 0;
+  fadeIncomplete = false;
+}
+
+bool paletteFadeStep(uint16_t maxEntries) {
+  if (!fadeActive) {
+    return false;
+  }
+
+  uint16_t end = fadeCursor + maxEntries;
+  if (end > 16) {
+    end = 16;
+  }
+  for (uint8_t i = fadeCursor; i < end; ++i) {
+    const CRGB& target = fadeTarget.entries[i];
+    CRGB& entry = currentPalette.entries[i];
+    entry.r = fadeChannel(entry.r, target.r);
+    entry.g = fadeChannel(entry.g, target.g);
+    entry.b = fadeChannel(entry.b, target.b);
+    if (entry != target) {
+      fadeIncomplete = true;
+    }
+  }
+  fadeCursor = (uint8_t)end;
+
+  if (fadeCursor < 16) {
+    return false;
+  }
+  fadeActive = fadeIncomplete;
+  fadeCursor = 0;
+  fadeIncomplete = false;
+  return true;
+}
+
+bool paletteFadeActive() {
+  return fadeActive;
+}
@@ -1,3 +1,34 @@
+// Palettes for Digital_RGB_LED
+//
+// The palette in use (currentPalette, defined in the .ino) is a
+// CRGBPalette16: 16 entries, 48 bytes of SRAM. The renderer samples it with
+// paletteSample(currentPalette, index), which interpolates linearly
+// between neighbouring entries in 8-bit fixed point, so every palette index
+// 0-255 gives the colour a CRGBPalette256 expansion (768 bytes) would hold.
+// Only the pattern rebuild (in direct palette mode: of the 256-entry table
+// the direct renderer reads) and the bufferless effects (noise, twinkle)
+// sample it; the frame render reads the pattern.
+//
+// The selectable palettes stay in PROGMEM, in a registry of
+// gPaletteCount (config.h) entries: FastLED's 16-entry palettes first
+// (Ocean, Cloud, Lava, Heat, Forest, Party, Rainbow, RainbowStripe, as
+// before), then any CUSTOM_PALETTES (config.h). Each entry is either a
+// 16-entry palette or a gradient in FastLED's gradient format, a list of
+// (index, r, g, b) stops with ascending indices from 0 to 255. A gradient
+// is sampled into 16 entries when it is loaded: entry k takes the colour at
+// index 17 k (both end stops exactly), interpolated between the two stops
+// around it. That is an approximation: stops closer together than 17
+// indices are averaged away, and a hard edge (two stops at one index)
+// renders as a blend over the 16 indices between the entries either side
+// of it.
+//
+// ──────────────────────────────────────────────────────────────
+// USAGE:
+//   paletteLoad(gPaletteIndex, currentPalette);   // switch at once
+//   CRGBPalette16 target;
+//   paletteLoad(index, target);
+//   paletteFadeTo(target);                        // or crossfade
+//
 #ifndef PALETTE_H
 #define PALETTE_H
 
@@ -7,7 +38,41 @@ void SetupBlackAndWhiteStripedPalette();
 void SetupPurpleAndGreenPalette();
 extern const TProgmemPalette16 myRedWhiteBluePalette_p PROGMEM;
 
-extern const TProgmemRGBPalette16* const PREDEFINED_PALETTES[];
-constexpr uint8_t PREDEFINED_PALETTES_COUNT = 8;  // keep in sync!
+// ColorFromPalette(palette, index) with LINEARBLEND at full brightness,
+// inline for the renderers that sample once per pixel.
+inline CRGB paletteSample(const CRGBPalette16& palette, uint8_t index) {
+  const uint8_t hi4 = index >> 4;
+  const uint8_t lo4 = index & 0x0F;
+  const CRGB& a = palette.entries[hi4];
+  if (lo4 == 0) {
+    return a;
+  }
+  const CRGB& b = palette.entries[(hi4 + 1) & 0x0F];
+  const uint8_t f2 = lo4 << 4;
+  const uint8_t f1 = 255 - f2;
+  return CRGB(scale8(a.r, f1) + scale8(b.r, f2), scale8(a.g, f1) + scale8(b.g, f2),
+              scale8(a.b, f1) + scale8(b.b, f2));
+}
+
+// Registry palette `index` (< gPaletteCount) as 16 entries.
+void paletteLoad(uint8_t index, CRGBPalette16& out);
+
+// A PROGMEM gradient (see above) as 16 entries.
+void paletteLoadGradient(const uint8_t* gradient, CRGBPalette16& out);
+
+// ── Palette transitions ──
+// paletteFadeTo() starts moving currentPalette toward another palette.
+// paletteFadeStep() then does a bounded slice of the work per call: it
+// moves at most maxEntries palette entries, each colour channel by at most
+// PALETTE_FADE_STEP (config.h). It returns true when it has completed a
+// pass over all 16 entries, i.e. when the virtual pattern should be
+// rebuilt to show the new colours. The fade ends after the pass in which
+// every entry reaches the target; a new paletteFadeTo() simply retargets
+// from wherever the palette is. The CRGBPalette16 overload takes a palette
+// held in RAM (e.g. one received over Serial).
+void paletteFadeTo(const TProgmemRGBPalette16& target);
+void paletteFadeTo(const CRGBPalette16& target);
+bool paletteFadeStep(uint16_t maxEntries);
+bool paletteFadeActive();
 
 #endif  // PALETTE_H
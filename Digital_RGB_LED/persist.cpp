@@ -0,0 +1,167 @@
+#include "persist.h"
+
+#if PERSIST_STATE
+
+#include <EEPROM.h>
+
+static_assert(PERSIST_EEPROM_OFFSET + (long)kPersistSlots * kPersistRecordBytes <= E2END + 1L,
+              "PERSIST_EEPROM_OFFSET + PERSIST_EEPROM_BYTES beyond the EEPROM");
+
+// Record: sequence (2), layout version, config stamp (2), palette, effect,
+// brightness, BPM x 100 (2), wave length x 1000 (2), phase (4), CRC-8 of
+// the 16 bytes before it.
+constexpr uint8_t kCrcAt = kPersistRecordBytes - 1;
+constexpr uint16_t kNoSequence = 0xFFFF;  // erased EEPROM
+constexpr uint8_t kLayout = 1;            // bump when the record changes
+
+// Stamp of the config.h defaults the state overrides. A record saved by a
+// build with other defaults is ignored, so newly flashed defaults apply.
+constexpr uint16_t mixStamp(uint16_t stamp, uint32_t value) {
+  return (uint16_t)((((uint32_t)stamp << 8 | stamp >> 8) ^ value ^ (value >> 16)) * 40503u >> 8);
+}
+constexpr uint16_t kConfigStamp =
+    mixStamp(mixStamp(mixStamp(mixStamp(mixStamp(kLayout, PALETTE_INDEX), EFFECT_INDEX), BRIGHTNESS),
+                      (uint32_t)(BPM * 100 + 0.5)),
+             (uint32_t)(WAVE_LENGTH_SCALE * 1000 + 0.5));
+
+static uint16_t gSlot = kPersistSlots - 1;  // newest record
+static uint16_t gSequence = kNoSequence;
+
+static uint8_t gRecord[kPersistRecordBytes];  // being written
+static uint8_t gWriteAt = kPersistRecordBytes;  // next byte; done when past the end
+
+static PersistState gSaved = {};  // last saved or restored
+static PersistState gSeen = {};   // settings as last seen
+static unsigned long gSeenAt = 0;
+static unsigned long gSavedAt = 0;
+static uint16_t gSaves = 0;
+
+static uint16_t slotAddress(uint16_t slot) {
+  return PERSIST_EEPROM_OFFSET + slot * kPersistRecordBytes;
+}
+
+static uint8_t crc8(const uint8_t* data, uint8_t length) {
+  uint8_t crc = 0;
+  for (uint8_t i = 0; i < length; ++i) {
+    crc ^= data[i];
+    for (uint8_t bit = 0; bit < 8; ++bit) crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+  }
+  return crc;
+}
+
+static void encode(const PersistState& state, uint16_t sequence, uint8_t* out) {
+  out[0] = (uint8_t)sequence;
+  out[1] = (uint8_t)(sequence >> 8);
+  out[2] = kLayout;
+  out[3] = (uint8_t)kConfigStamp;
+  out[4] = (uint8_t)(kConfigStamp >> 8);
+  out[5] = state.palette;
+  out[6] = state.effect;
+  out[7] = state.brightness;
+  out[8] = (uint8_t)state.centiBpm;
+  out[9] = (uint8_t)(state.centiBpm >> 8);
+  out[10] = (uint8_t)state.milliWave;
+  out[11] = (uint8_t)(state.milliWave >> 8);
+  for (uint8_t i = 0; i < 4; ++i) out[12 + i] = (uint8_t)(state.phase >> (8 * i));
+  out[kCrcAt] = crc8(out, kCrcAt);
+}
+
+// True when the record was written by this layout and these defaults.
+static bool current(const uint8_t* in) {
+  return in[2] == kLayout && (uint16_t)(in[3] | in[4] << 8) == kConfigStamp;
+}
+
+static void decode(const uint8_t* in, PersistState& state) {
+  state.palette = in[5];
+  state.effect = in[6];
+  state.brightness = in[7];
+  state.centiBpm = (uint16_t)(in[8] | in[9] << 8);
+  state.milliWave = (uint16_t)(in[10] | in[11] << 8);
+  state.phase = 0;
+  for (uint8_t i = 0; i < 4; ++i) state.phase |= (uint32_t)in[12 + i] << (8 * i);
+}
+
+static bool sameSettings(const PersistState& a, const PersistState& b) {
+  return a.palette == b.palette && a.effect == b.effect && a.brightness == b.brightness && a.centiBpm == b.centiBpm &&
+         a.milliWave == b.milliWave;
+}
+
+bool persistSetup(PersistState& state) {
+  gWriteAt = kPersistRecordBytes;
+  gSlot = kPersistSlots - 1;
+  gSequence = kNoSequence;
+  gSaves = 0;
+
+  uint8_t record[kPersistRecordBytes];
+  for (uint16_t slot = 0; slot < kPersistSlots; ++slot) {
+    const uint16_t address = slotAddress(slot);
+    for (uint8_t i = 0; i < kPersistRecordBytes; ++i) record[i] = EEPROM.read(address + i);
+    const uint16_t sequence = (uint16_t)(record[0] | record[1] << 8);
+    if (sequence == kNoSequence || crc8(record, kCrcAt) != record[kCrcAt]) continue;
+    if (!current(record)) continue;  // other layout or defaults: not restored
+    // Newer by serial number arithmetic, so the sequence may wrap.
+    if (gSequence == kNoSequence || (int16_t)(sequence - gSequence) > 0) {
+      gSequence = sequence;
+      gSlot = slot;
+      decode(record, gSaved);
+    }
+  }
+
+  gSeen = gSaved;
+  gSeenAt = gSavedAt = millis();
+  if (gSequence == kNoSequence) return false;
+  state = gSaved;
+  return true;
+}
+
+void persistSave(const PersistState& state, unsigned long nowMs) {
+  if (persistBusy()) return;
+  gSequence = gSequence + 1 == kNoSequence ? 0 : gSequence + 1;
+  gSlot = (gSlot + 1) % kPersistSlots;
+  encode(state, gSequence, gRecord);
+  gWriteAt = 0;
+  gSaved = gSeen = state;
+  gSavedAt = gSeenAt = nowMs;
+}
+
+void persistUpdate(const PersistState& live, unsigned long nowMs) {
+  if (!persistBusy()) {
+    if (!sameSettings(live, gSeen)) {
+      gSeen = live;
+      gSeenAt = nowMs;  // still changing: wait for it to settle
+    }
+    const bool settingsDue = !sameSettings(live, gSaved) && nowMs - gSeenAt >= PERSIST_SAVE_MS;
+    const bool phaseDue = live.phase != gSaved.phase && nowMs - gSavedAt >= PERSIST_PHASE_MS;
+    if (!settingsDue && !phaseDue) return;
+    persistSave(live, nowMs);
+  }
+
+  // One byte per call, once the previous write has finished.
+  if (!eeprom_is_ready()) return;
+  EEPROM.update(slotAddress(gSlot) + gWriteAt, gRecord[gWriteAt]);
+  if (++gWriteAt == kPersistRecordBytes) ++gSaves;
+}
+
+bool persistBusy() {
+  return gWriteAt < kPersistRecordBytes;
+}
+
+uint16_t persistSaves() {
+  return gSaves;
+}
+
+#else  // PERSIST_STATE
+
+bool persistSetup(PersistState&) {
+  return false;
+}
+void persistUpdate(const PersistState&, unsigned long) {}
+void persistSave(const PersistState&, unsigned long) {}
+bool persistBusy() {
+  return false;
+}
+uint16_t persistSaves() {
+  return 0;
+}
+
+#endif  // PERSIST_STATE
@@ -0,0 +1,78 @@
+// Warm boot state for Digital_RGB_LED
+//
+// The live settings (palette, effect, brightness, BPM, wave length) and the
+// animation phase are kept in EEPROM, so after a power cycle the show
+// resumes where it left off instead of at the config.h defaults.
+//
+// Records: each save is a 17-byte record with a sequence number and a
+// CRC-8, written to the slot after the newest one in a ring of slots over
+// PERSIST_EEPROM_BYTES of EEPROM starting at PERSIST_EEPROM_OFFSET. Every
+// slot takes its turn, so each EEPROM cell sees one write per ring round
+// (4096 bytes: 240 slots). At boot the valid record with the highest
+// sequence number wins; a record torn by a power loss fails its CRC and
+// the one before it is used. The CRC is written last.
+//
+// Reflashing: a record also carries the record layout version and a stamp
+// of the config.h defaults it overrides (PALETTE_INDEX, EFFECT_INDEX,
+// BRIGHTNESS, BPM, WAVE_LENGTH_SCALE). A build with a different layout or
+// other defaults ignores it and starts from its own defaults.
+//
+// When: a changed setting is saved once it has held for PERSIST_SAVE_MS
+// (a knob being turned is saved once, where it stops); the phase alone is
+// saved every PERSIST_PHASE_MS, so it resumes at most that far behind.
+// With the defaults (the Mega's whole 4 KB EEPROM, a phase save every 2
+// minutes) a slot is rewritten every 8 hours of running, so the rated
+// 100,000 write cycles last about 90 years of continuous running. Every
+// settings save moves the ring on by one more slot. A smaller area wears
+// out proportionally sooner: 1024 bytes with a save a minute is about 11
+// years.
+//
+// Cost: an EEPROM write takes 3.3 ms on AVR and the EEPROM library's
+// update() waits for the previous one, so persistUpdate() writes at most
+// one byte per call and only when eeprom_is_ready(): a save is spread over
+// 17 calls and never holds loop(). Bytes that already hold the value are
+// not rewritten.
+//
+// With PERSIST_STATE false the functions are stubs and the EEPROM is not
+// touched.
+//
+// ──────────────────────────────────────────────────────────────
+// USAGE:
+//   PersistState state;
+//   if (persistSetup(state)) { ... }   // in setup(): apply the restored state
+//   persistUpdate(liveState, millis()); // persist task: saves when due
+//
+#ifndef PERSIST_H
+#define PERSIST_H
+
+#include <Arduino.h>
+#include "config.h"
+
+struct PersistState {
+  uint8_t palette;     // registry index (palette.h)
+  uint8_t effect;      // effects.h index
+  uint8_t brightness;
+  uint16_t centiBpm;   // BPM x 100
+  uint16_t milliWave;  // wave length scale x 1000
+  uint32_t phase;      // animation frame counter (looper)
+};
+
+// Bytes of one record in EEPROM, and the slots of the ring.
+constexpr uint8_t kPersistRecordBytes = 17;
+constexpr uint16_t kPersistSlots = PERSIST_EEPROM_BYTES / kPersistRecordBytes;
+static_assert(!PERSIST_STATE || kPersistSlots >= 2, "PERSIST_EEPROM_BYTES must hold at least two records");
+
+// Finds the newest valid record; false (state untouched) when there is
+// none, e.g. on a new board.
+bool persistSetup(PersistState& state);
+// Saves `live` when due (see above); writes at most one EEPROM byte.
+void persistUpdate(const PersistState& live, unsigned long nowMs);
+// Starts saving `state` now, unless a save is being written. Also resets
+// the PERSIST_SAVE_MS / PERSIST_PHASE_MS clocks.
+void persistSave(const PersistState& state, unsigned long nowMs);
+// True while a record is being written.
+bool persistBusy();
+// Records saved since boot.
+uint16_t persistSaves();
+
+#endif  // PERSIST_H
@@ -0,0 +1,54 @@
+#include "power.h"
+#include "strips.h"
+
+static_assert(POWER_LIMIT_MA >= 0, "POWER_LIMIT_MA must not be negative");
+
+long powerLedCount() {
+  long count = NUM_LEDS;
+  for (uint8_t s = 0; s < gExtraStripCount; ++s) {
+    count += gExtraStrips[s].length;
+  }
+  return count;
+}
+
+static uint32_t ledsLoad(const CRGB* pixels, long count) {
+  uint32_t load = 0;
+  for (long i = 0; i < count; ++i) {
+    load += powerPixelLoad(pixels[i].r, pixels[i].g, pixels[i].b);
+  }
+  return load;
+}
+
+uint32_t powerLedsLoad() {
+  uint32_t load = ledsLoad(leds, NUM_LEDS);
+  for (uint8_t s = 0; s < gExtraStripCount; ++s) {
+    load += ledsLoad(gExtraStrips[s].leds, gExtraStrips[s].length);
+  }
+  return load;
+}
+
+uint32_t powerMilliamps(uint32_t load, uint8_t brightness) {
+  // FastLED scales a level v by brightness b to (v * (b + 1)) >> 8.
+  // Dividing by 255 first keeps the product in 32 bits.
+  return (load / 255UL) * ((uint32_t)brightness + 1) / 256UL + (uint32_t)POWER_MA_IDLE * (uint32_t)powerLedCount();
+}
+
+uint8_t powerLimitBrightness(uint32_t load, uint8_t brightness) {
+  if (POWER_LIMIT_MA <= 0 || brightness == 0) {
+    return brightness;
+  }
+  const uint32_t limit = POWER_LIMIT_MA;
+  const uint32_t idle = (uint32_t)POWER_MA_IDLE * (uint32_t)powerLedCount();
+  if (idle >= limit) {
+    return 0;  // dark LEDs alone exceed the budget
+  }
+  const uint32_t budget = limit - idle;
+  // Largest b with (load / 255) * (b + 1) / 256 <= budget, the same
+  // rounding as powerMilliamps().
+  const uint32_t units = load / 255UL;
+  if (units * ((uint32_t)brightness + 1) / 256UL <= budget) {
+    return brightness;
+  }
+  uint32_t scale = ((budget + 1) * 256UL - 1) / units;  // b + 1, <= brightness here
+  return scale == 0 ? 0 : (uint8_t)(scale - 1);
+}
@@ -0,0 +1,65 @@
+// Power estimation and current limiting for Digital_RGB_LED
+//
+// Estimates the supply current of every frame and, with POWER_LIMIT_MA set,
+// lowers the brightness of frames that would draw more than that.
+//
+// The model is FastLED's: a lit channel draws current in proportion to its
+// level (POWER_MA_RED / _GREEN / _BLUE at 255) and every LED draws
+// POWER_MA_IDLE on top. A frame's "load" is the sum of
+//   r * POWER_MA_RED + g * POWER_MA_GREEN + b * POWER_MA_BLUE
+// over all LEDs of all strips at full brightness, so at brightness b it
+// draws about load * (b + 1) / 256 / 255 mA plus the idle current.
+//
+// For the palette wave the load is known before rendering, in constant
+// time: the strip is a window sliding over the virtual pattern, so
+// animation.cpp keeps prefix sums of the pattern's load and reads any
+// window from them, folds, tiles and extra strips included (FrameLoad() in
+// animation.h). Other effects, streamed frames and the direct palette
+// render are measured from leds[] after rendering (powerLedsLoad()).
+//
+// FastLED's own limiter (setMaxPowerInVoltsAndMilliamps) is not used: it
+// walks every LED on every show.
+//
+// ──────────────────────────────────────────────────────────────
+// CONFIGURATION (config.h):
+//   POWER_LIMIT_MA   budget in mA for all strips together (0 = no limit)
+//   POWER_MA_RED, POWER_MA_GREEN, POWER_MA_BLUE, POWER_MA_IDLE
+// The estimate runs when POWER_LIMIT_MA is set or with TELEMETRY, which
+// reports the estimated current per shown frame. Otherwise the prefix sums
+// are not allocated and nothing is computed.
+//
+// USAGE:
+//   outputSetLoad(load);                  // render callback, see output.h
+//   uint8_t shown = powerLimitBrightness(load, brightness);
+//
+#ifndef POWER_H
+#define POWER_H
+
+#include <FastLED.h>
+#include "config.h"
+
+#ifndef TELEMETRY
+#define TELEMETRY 0
+#endif
+
+constexpr bool kPowerEstimate = POWER_LIMIT_MA > 0 || TELEMETRY;
+
+// Load of one pixel at full brightness.
+inline uint16_t powerPixelLoad(uint8_t r, uint8_t g, uint8_t b) {
+  return (uint16_t)(r * POWER_MA_RED + g * POWER_MA_GREEN + b * POWER_MA_BLUE);
+}
+
+// LEDs on all strips (the idle current counts every one of them).
+long powerLedCount();
+
+// Load of what leds[] and the extra strips hold now, pixel by pixel.
+uint32_t powerLedsLoad();
+
+// Estimated current in mA of a frame with this load at this brightness.
+uint32_t powerMilliamps(uint32_t load, uint8_t brightness);
+
+// The highest brightness up to `brightness` at which the frame stays
+// within POWER_LIMIT_MA (`brightness` itself without a limit).
+uint8_t powerLimitBrightness(uint32_t load, uint8_t brightness);
+
+#endif  // POWER_H
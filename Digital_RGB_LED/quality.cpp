@@ -0,0 +1,93 @@
+#include "quality.h"
+
+static_assert(QUALITY_LOW_LOAD < QUALITY_HIGH_LOAD,
+              "QUALITY_LOW_LOAD must be below QUALITY_HIGH_LOAD, or a step up would be undone at once");
+
+static const uint8_t kCostShift = 2;     // cost smoothing: 1/4 of each new sample
+static const uint8_t kSettleFrames = 4;  // rendered frames between two steps down
+
+static int fullResolution = 1;
+static uint8_t level = 0;
+static uint8_t maxLevel = 0;
+static uint32_t costSum = 0;  // smoothed cost << kCostShift, 0 before the first frame
+static long skipped = 0;
+static uint16_t calm = 0;     // rendered frames in a row with room for a step up
+static uint8_t settle = 0;    // rendered frames since the last change, up to kSettleFrames
+
+void qualitySetup(int resolution) {
+  fullResolution = resolution < 1 ? 1 : resolution;
+  maxLevel = 0;
+  while ((1L << maxLevel) < fullResolution) {
+    ++maxLevel;
+  }
+  level = 0;
+  costSum = 0;
+  skipped = 0;
+  calm = 0;
+  settle = 0;
+}
+
+int qualityStep() {
+  const long step = 1L << level;
+  return step < fullResolution ? (int)step : fullResolution;
+}
+
+long qualityFrame(long frame) {
+  const int step = qualityStep();
+  return step == 1 ? frame : frame - frame % step;
+}
+
+void qualityNoteSkipped(long frames) {
+  if (frames > 0) skipped += frames;
+}
+
+// cost > percent of period * step. Once per rendered frame, so 64 bits
+// rather than limits on the period.
+static bool above(unsigned long cost, uint8_t percent, uint32_t periodMicros, int step) {
+  return (uint64_t)cost * 100 > (uint64_t)percent * periodMicros * (uint32_t)step;
+}
+
+bool qualityRecord(unsigned long costMicros, uint32_t periodMicros) {
+  if (!QUALITY_ADAPTIVE || maxLevel == 0 || periodMicros == 0) {
+    skipped = 0;
+    return false;
+  }
+
+  costSum = costSum == 0 ? (uint32_t)costMicros << kCostShift
+                         : costSum - (costSum >> kCostShift) + costMicros;
+  const unsigned long cost = costSum >> kCostShift;
+  const bool late = skipped > 0;
+  skipped = 0;
+  if (settle < kSettleFrames) ++settle;
+
+  if (level < maxLevel && settle >= kSettleFrames && (late || above(cost, QUALITY_HIGH_LOAD, periodMicros, qualityStep()))) {
+    ++level;
+    calm = 0;
+    settle = 0;
+    return true;
+  }
+
+  if (level > 0 && !late && !above(cost, QUALITY_LOW_LOAD, periodMicros, (int)(1L << (level - 1)))) {
+    if (++calm >= QUALITY_HOLD_FRAMES) {
+      --level;
+      calm = 0;
+      settle = 0;
+      return true;
+    }
+  } else {
+    calm = 0;
+  }
+  return false;
+}
+
+uint8_t qualityLevel() {
+  return level;
+}
+
+uint8_t qualityMaxLevel() {
+  return maxLevel;
+}
+
+unsigned long qualityCost() {
+  return costSum >> kCostShift;
+}
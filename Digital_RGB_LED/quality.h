@@ -0,0 +1,57 @@
+// Adaptive render quality for Digital_RGB_LED
+//
+// Holds the frame rate when rendering and showing a frame takes longer than
+// the frame period allows, instead of letting the frame timer skip frames.
+// The lever is the interpolation between pattern steps (RESOLUTION): at
+// level q only every step-th sub-frame is rendered, step = 2^q, and the
+// sub-frames in between round down to it, so their RenderKey repeats and
+// the output stage drops them without rendering. The last level renders
+// whole pattern steps only (step = RESOLUTION), i.e. the non-interpolating
+// kernel. The frame timer and looper keep running at
+//   bpm * NUM_LEDS * RESOLUTION / 60   frames per second
+// whatever the level, so the animation speed set by BPM never changes; only
+// the number of in-between phases drawn does.
+//
+// The controller smooths the cost of each rendered frame (frame task run
+// time: render plus show, µs) and compares it with the time it has until
+// the next rendered frame, the frame period times step:
+//   - above QUALITY_HIGH_LOAD percent, or when frames were skipped, it goes
+//     one level down (at most once per few rendered frames);
+//   - once the cost has stayed below QUALITY_LOW_LOAD percent of the time
+//     one level up would have for QUALITY_HOLD_FRAMES rendered frames in a
+//     row, it goes one level up.
+// The gap between the two thresholds keeps it from flapping. With
+// RESOLUTION 1 there is nothing to lower and the level stays 0; with
+// QUALITY_ADAPTIVE false it always does.
+//
+// ──────────────────────────────────────────────────────────────
+// USAGE:
+//   qualitySetup(RESOLUTION);                             // in setup()
+//   render(qualityFrame(looper), resolution, ...);       // frame to draw
+//   qualityNoteSkipped(missedFrames);                     // from the frame timer
+//   if (qualityRecord(micros() - start, period)) {...}   // after each show
+//
+#ifndef QUALITY_H
+#define QUALITY_H
+
+#include <Arduino.h>
+#include "config.h"
+
+void qualitySetup(int resolution);
+
+// The sub-frame rendered for `frame` at the current level.
+long qualityFrame(long frame);
+
+// Frames the frame timer skipped; counted against the next rendered frame.
+void qualityNoteSkipped(long frames);
+
+// Reports a rendered frame that cost `costMicros`, at a frame period of
+// `periodMicros`. Returns true when the level changed.
+bool qualityRecord(unsigned long costMicros, uint32_t periodMicros);
+
+uint8_t qualityLevel();     // 0 = full RESOLUTION
+uint8_t qualityMaxLevel();  // the non-interpolating level
+int qualityStep();          // sub-frames per rendered frame
+unsigned long qualityCost();  // smoothed frame cost, µs
+
+#endif  // QUALITY_H
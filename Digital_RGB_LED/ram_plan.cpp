@@ -0,0 +1,91 @@
+#include "ram_plan.h"
+#include <limits.h>
+
+// One enum per entry, so the compiler names each size when the check fails.
+namespace ram {
+#define RAM_PLAN(name, bytes) enum class name : long {};
+RAM_PLAN_ENTRIES
+#undef RAM_PLAN
+enum class sram : long {};
+}
+
+#define RAM_PLAN(name, bytes) ram::name name,
+template <RAM_PLAN_ENTRIES ram::sram sram>
+#undef RAM_PLAN
+struct RamPlanCheck {
+#define RAM_PLAN(name, bytes) +(long)name
+  static_assert(0 RAM_PLAN_ENTRIES <= (long)sram,
+                "RAM plan over the board's SRAM (bytes per entry above): lower NUM_LEDS, WAVE_LENGTH_SCALE_MAX or "
+                "VIRTUAL_LEDS_MAX, or disable features");
+#undef RAM_PLAN
+  static constexpr bool fits = true;
+};
+
+// Without a known SRAM anything fits.
+#define RAM_PLAN(name, bytes) (ram::name)(bytes),
+static_assert(RamPlanCheck<RAM_PLAN_ENTRIES(ram::sram)(kRamPlanSram > 0 ? kRamPlanSram : LONG_MAX)>::fits, "RAM plan");
+#undef RAM_PLAN
+
+#ifdef __AVR__
+
+extern uint8_t __data_start;
+extern uint8_t __bss_end;
+extern uint8_t __heap_start;
+extern uint8_t* __brkval;
+
+static const uint8_t kPaint = 0xA5;
+
+static uint8_t* heapEnd() {
+  return __brkval != nullptr ? __brkval : &__heap_start;
+}
+
+void ramPlanSetup() {
+  // Up to a little below this function's own frame.
+  uint8_t* const top = (uint8_t*)SP - 16;
+  for (uint8_t* p = heapEnd(); p < top; ++p) *p = kPaint;
+}
+
+uint16_t ramStaticBytes() {
+  return (uint16_t)(&__bss_end - &__data_start);
+}
+
+uint16_t ramFreeBytes() {
+  return (uint16_t)((uint8_t*)SP - heapEnd());
+}
+
+uint16_t ramStackHeadroom() {
+  const uint8_t* p = heapEnd();
+  const uint8_t* const top = (const uint8_t*)SP;
+  uint16_t untouched = 0;
+  while (p + untouched < top && p[untouched] == kPaint) ++untouched;
+  return untouched;
+}
+
+#else  // __AVR__
+
+void ramPlanSetup() {}
+uint16_t ramStaticBytes() { return 0; }
+uint16_t ramFreeBytes() { return 0; }
+uint16_t ramStackHeadroom() { return 0; }
+
+#endif  // __AVR__
+
+void ramPlanReport() {
+  Serial.print("[RAM] plan");
+#define RAM_PLAN(name, bytes) \
+  Serial.print(" " #name "=");  \
+  Serial.print((long)(bytes));
+  RAM_PLAN_ENTRIES
+#undef RAM_PLAN
+  Serial.print(" total=");
+  Serial.print(kRamPlanBytes);
+  Serial.print(" of ");
+  Serial.println(kRamPlanSram);
+
+  Serial.print("[RAM] static=");
+  Serial.print(ramStaticBytes());
+  Serial.print(" free=");
+  Serial.print(ramFreeBytes());
+  Serial.print(" headroom=");
+  Serial.println(ramStackHeadroom());
+}
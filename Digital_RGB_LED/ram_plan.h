@@ -0,0 +1,138 @@
+// Static RAM plan for Digital_RGB_LED
+//
+// Every buffer whose size follows from config.h is sized here, by the
+// compiler: leds[] from NUM_LEDS, the extra strips, the double-buffered
+// virtual pattern from NUM_LEDS / ANIMATION_PARTS * WAVE_LENGTH_SCALE_MAX
+// (capped by VIRTUAL_LEDS_MAX) or the direct mode's palette table, its
+// power prefix sums, the high-precision brightness table, the effects'
+// state, the zones' arena, and the audio and telemetry buffers when those
+// features are enabled. The modules
+// declare their buffers from these constants, so the plan is what the
+// linker places. RESOLUTION does not enter it: sub-frames are
+// interpolated between pattern pixels, not stored.
+//
+// What is not planned per buffer (the stack, Serial's and FastLED's
+// buffers, the fixed-size state of the modules) is covered by
+// RAM_PLAN_RESERVE_BYTES. When the plan does not fit the board's SRAM the
+// build stops in ram_plan.cpp with every entry listed, e.g.
+//
+//   In instantiation of 'struct RamPlanCheck<(ram::leds)3000, (ram::strips)0,
+//     (ram::pattern)3600, ..., (ram::reserve)2048, (ram::sram)8192>':
+//   error: static assertion failed: RAM plan over the board's SRAM ...
+//
+// The SRAM is the board's (RAMEND) unless RAM_PLAN_SRAM_BYTES is set; host
+// builds have no board and are only checked with RAM_PLAN_SRAM_BYTES.
+//
+// At runtime the plan can be checked against the board: ramPlanSetup()
+// paints the free RAM between the heap and the stack, and ramPlanReport()
+// (the 't' telemetry command) prints the plan next to the linked static
+// size, the free RAM now and the stack headroom, i.e. the free RAM the
+// deepest stack so far has left untouched. The readings are AVR only and
+// read 0 elsewhere.
+//
+// ──────────────────────────────────────────────────────────────
+// USAGE:
+//   static CRGB arena[2][kPlanPatternSlot];  // size buffers from the plan
+//   ramPlanSetup();                          // first thing in setup()
+//   ramPlanReport();                         // [RAM] plan ... / [RAM] static=...
+//
+// REPORT FORMAT:
+//   [RAM] plan leds=900 strips=0 pattern=3600 palette=3 loads=16 levels=2 effects=300 zones=0 audio=0 telemetry=0 reserve=2048 total=6869 of 8192
+//   [RAM] static=5420 free=2310 headroom=2016
+//
+#ifndef RAM_PLAN_H
+#define RAM_PLAN_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "animation.h"
+#include "audio.h"
+#include "power.h"
+#include "strips.h"
+#include "telemetry.h"
+#include "zones.h"
+
+// LEDs of one independent section: what a pattern or an effect covers.
+constexpr long kPlanSectionLeds = stripSectionLength(NUM_LEDS, ANIMATION_PARTS < 1 ? 1 : ANIMATION_PARTS);
+
+// Longest virtual pattern: the section at WAVE_LENGTH_SCALE_MAX, capped by
+// VIRTUAL_LEDS_MAX. The cap is in 8-bit pixels, so 16-bit pixels get the
+// same RAM (half as many).
+constexpr long kPlanPatternForMaxScale = (long)((float)kPlanSectionLeds * WAVE_LENGTH_SCALE_MAX + 0.5f);
+constexpr long kPlanPatternMax = (long)(VIRTUAL_LEDS_MAX * sizeof(CRGB) / sizeof(VirtualPixel));
+constexpr long kPlanPatternPixels = kPlanPatternForMaxScale < 1              ? 1
+                                    : kPlanPatternForMaxScale > kPlanPatternMax ? kPlanPatternMax
+                                                                                : kPlanPatternForMaxScale;
+// Wave length scale whose pattern still fits: WAVE_LENGTH_SCALE_MAX, or
+// less when VIRTUAL_LEDS_MAX caps the pattern. The wave length knob spans
+// up to it, so none of its travel is clamped away.
+constexpr float kPlanWaveLengthScaleMax = RENDER_DIRECT_PALETTE || kPlanPatternForMaxScale <= kPlanPatternMax
+                                              ? (float)WAVE_LENGTH_SCALE_MAX
+                                              : (float)kPlanPatternMax / kPlanSectionLeds;
+// Pixels of each of the two pattern slots; a placeholder when rendering
+// straight from the palette.
+constexpr long kPlanPatternSlot = RENDER_DIRECT_PALETTE ? 1 : kPlanPatternPixels;
+
+// Palette expanded to its 256 indices, the direct palette mode's lookup
+// table in place of the pattern slots.
+constexpr long kPlanPaletteTable = RENDER_DIRECT_PALETTE ? 256 : 1;
+
+// Power prefix sums of each slot (animation.cpp): one per block of pattern
+// pixels, when the current is estimated from the pattern.
+constexpr bool kPlanPatternLoad = kPowerEstimate && !RENDER_DIRECT_PALETTE;
+constexpr long kPlanLoadBlock = 8;
+constexpr long kPlanLoadSums = kPlanPatternLoad ? kPlanPatternPixels / kPlanLoadBlock + 1 : 1;
+
+// Gamma table scaled by the brightness (RENDER_HIGH_PRECISION).
+constexpr long kPlanLevels = RENDER_HIGH_PRECISION ? 257 : 1;
+
+// The effects' overlaid state: the fire's heat, a byte per section LED.
+constexpr long kPlanEffectBytes = kPlanSectionLeds;
+
+#ifdef EXTRA_LED_STRIPS
+#define LED_STRIP(pin, length, parts, type, reversed) +(length)
+constexpr long kPlanStripLeds = 0 EXTRA_LED_STRIPS;
+#undef LED_STRIP
+#else
+constexpr long kPlanStripLeds = 0;
+#endif
+
+// The plan, one RAM_PLAN(name, bytes) per entry.
+#define RAM_PLAN_ENTRIES                                                   \
+  RAM_PLAN(leds, NUM_LEDS * sizeof(CRGB))                                  \
+  RAM_PLAN(strips, kPlanStripLeds * sizeof(CRGB))                          \
+  RAM_PLAN(pattern, 2 * kPlanPatternSlot * sizeof(VirtualPixel))           \
+  RAM_PLAN(palette, kPlanPaletteTable * sizeof(CRGB))                      \
+  RAM_PLAN(loads, (2 * kPlanLoadSums + 2) * sizeof(uint32_t))              \
+  RAM_PLAN(levels, kPlanLevels * sizeof(uint16_t))                         \
+  RAM_PLAN(effects, kPlanEffectBytes)                                      \
+  RAM_PLAN(zones, kZoneArenaPixels * sizeof(CRGB))                         \
+  RAM_PLAN(audio, AUDIO_RAM_BYTES)                                         \
+  RAM_PLAN(telemetry, tel::kRamBytes)                                      \
+  RAM_PLAN(reserve, RAM_PLAN_RESERVE_BYTES)
+
+#define RAM_PLAN(name, bytes) +(long)(bytes)
+constexpr long kRamPlanBytes = 0 RAM_PLAN_ENTRIES;
+#undef RAM_PLAN
+
+// SRAM the plan must fit in; 0 where it is not known (not checked).
+#if RAM_PLAN_SRAM_BYTES > 0
+constexpr long kRamPlanSram = RAM_PLAN_SRAM_BYTES;
+#elif defined(RAMEND) && defined(RAMSTART)
+constexpr long kRamPlanSram = RAMEND - RAMSTART + 1;
+#else
+constexpr long kRamPlanSram = 0;
+#endif
+
+// Paints the RAM between the heap and the stack; first thing in setup().
+void ramPlanSetup();
+// .data + .bss as linked.
+uint16_t ramStaticBytes();
+// RAM between the heap and the stack now.
+uint16_t ramFreeBytes();
+// Free RAM the stack has not reached since ramPlanSetup().
+uint16_t ramStackHeadroom();
+// Prints the plan and the readings over Serial.
+void ramPlanReport();
+
+#endif  // RAM_PLAN_H
@@ -0,0 +1,143 @@
+#include "scheduler.h"
+#include <string.h>
+
+struct TaskState {
+  unsigned long release;  // periodic: next release; others: when released
+  bool pending;           // released and not run yet (ready() tasks)
+  unsigned long worst;    // longest run since setup, kept across resets
+};
+
+static const SchedTask* tasks = nullptr;
+static uint8_t taskCount = 0;
+static TaskState state[kSchedMaxTasks];
+static SchedStats stats[kSchedMaxTasks];
+
+void schedulerSetup(const SchedTask* table, uint8_t count) {
+  tasks = table;
+  taskCount = count < kSchedMaxTasks ? count : kSchedMaxTasks;
+  const unsigned long now = micros();
+  for (uint8_t i = 0; i < taskCount; ++i) {
+    state[i].release = now + table[i].periodMicros;
+    state[i].pending = false;
+    state[i].worst = 0;
+  }
+  schedulerResetStats();
+}
+
+// Updates the release of task i; true if it has work now. `due` is set to
+// its release, or to when it next has work if known (else left at `now`).
+static bool released(uint8_t i, unsigned long now, unsigned long& due) {
+  const SchedTask& task = tasks[i];
+  TaskState& s = state[i];
+  due = now;
+  if (!task.ready) {
+    due = s.release;
+    return (long)(now - due) >= 0;
+  }
+  const bool ready = task.ready(now, due);
+  if (ready && !s.pending) s.release = due;
+  s.pending = ready;
+  if (ready) due = s.release;
+  return ready;
+}
+
+static void runTask(uint8_t i) {
+  const SchedTask& task = tasks[i];
+  TaskState& s = state[i];
+  SchedStats& st = stats[i];
+
+  const unsigned long start = micros();
+  const unsigned long late = (long)(start - s.release) > 0 ? start - s.release : 0;
+  task.run();
+  const unsigned long took = micros() - start;
+
+  ++st.runs;
+  if (took > st.worstMicros) st.worstMicros = took;
+  if (took > s.worst) s.worst = took;
+  if (late > st.worstLate) st.worstLate = late;
+  if (late > task.deadlineMicros) ++st.missed;
+
+  if (task.ready) {
+    s.pending = false;
+  } else {
+    s.release += task.periodMicros;
+    if ((long)(start - s.release) >= 0) {
+      s.release = start + task.periodMicros;  // fell behind: no burst
+    }
+  }
+}
+
+uint8_t schedulerRun() {
+  uint8_t ran = 0;
+  uint8_t done = 0;  // one bit per task run in this pass
+  static_assert(kSchedMaxTasks <= 8, "done has one bit per task");
+
+  for (;;) {
+    const unsigned long now = micros();
+    unsigned long frameDue = 0;  // earliest frame boundary, run or not
+    bool frameKnown = false;
+    bool frameReady = false;      // a frame still to run in this pass
+    uint8_t ready = 0;
+    for (uint8_t i = 0; i < taskCount; ++i) {
+      unsigned long due;
+      const bool has = released(i, now, due);
+      if (tasks[i].priority == 0 && (has || due != now)) {
+        if (!frameKnown || (long)(due - frameDue) < 0) frameDue = due;
+        frameKnown = true;
+      }
+      if (!has || ((done >> i) & 1)) continue;
+      ready |= (uint8_t)(1 << i);
+      if (tasks[i].priority == 0) frameReady = true;
+    }
+
+    int8_t best = -1;
+    long bestSlack = 0;  // µs to the deadline of the best candidate
+    for (uint8_t i = 0; i < taskCount; ++i) {
+      if (!((ready >> i) & 1)) continue;
+      const SchedTask& task = tasks[i];
+      const long slack = (long)(state[i].release + task.deadlineMicros - now);
+      if (task.priority != 0) {
+        const bool fits = !frameKnown || (long)(frameDue - now) >= (long)state[i].worst;
+        if (frameReady || !(fits || slack < 0)) continue;
+      }
+      if (best < 0 || task.priority < tasks[best].priority || (task.priority == tasks[best].priority && slack < bestSlack)) {
+        best = (int8_t)i;
+        bestSlack = slack;
+      }
+    }
+    if (best < 0) return ran;
+
+    runTask((uint8_t)best);
+    done |= (uint8_t)(1 << best);
+    ++ran;
+  }
+}
+
+uint8_t schedulerTaskCount() {
+  return taskCount;
+}
+
+const SchedStats& schedulerStats(uint8_t task) {
+  return stats[task];
+}
+
+void schedulerReport() {
+  for (uint8_t i = 0; i < taskCount; ++i) {
+    const SchedStats& st = stats[i];
+    Serial.print("[SCHED] ");
+    Serial.print(tasks[i].name);
+    Serial.print(" n=");
+    Serial.print(st.runs);
+    Serial.print(" worst=");
+    Serial.print(st.worstMicros);
+    Serial.print(" late=");
+    Serial.print(st.worstLate);
+    Serial.print(" missed=");
+    Serial.print(st.missed);
+    Serial.println(" (us)");
+  }
+}
+
+void schedulerResetStats() {
+  memset(stats, 0, sizeof(stats));
+}
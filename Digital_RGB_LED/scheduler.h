@@ -0,0 +1,82 @@
+// Cooperative task scheduler for Digital_RGB_LED
+//
+// loop() is a single call to schedulerRun(), which runs the sketch's work
+// (render/show, knobs, ranging, serial, ...) as tasks from a static table.
+// Each task has a period or a ready() check, a deadline and a priority.
+// One pass runs every released task at most once, most urgent first:
+//   - priority 0 is the frame: it runs as soon as it is ready, ahead of
+//     everything else;
+//   - any other task starts only if its worst run time so far fits before
+//     the next frame boundary, so a slow knob read or sensor poll never
+//     pushes a frame back;
+//   - a task already past its deadline starts without that slack, but only
+//     once the pass has no frame left to run, so it cannot starve while
+//     frames alone fill the CPU.
+// Ties go to the earlier deadline. Tasks are never interrupted: each must
+// return quickly and split long work into steps (like the pattern rebuild).
+//
+// Per task it keeps the number of runs, the worst run time, the worst
+// lateness (start minus release) and the runs that started past their
+// deadline. All times come from micros(), so the host build drives it from
+// the virtual clock unchanged.
+//
+// ──────────────────────────────────────────────────────────────
+// USAGE:
+//   static const SchedTask kTasks[] = {
+//     // name     run       ready       period  deadline  priority (µs)
+//     { "frame",  runFrame, frameReady,      0,     1000,  0 },
+//     { "knobs",  runKnobs, nullptr,      1000,    10000,  2 },
+//   };
+//   schedulerSetup(kTasks, 2);  // in setup(); periods start from here
+//   schedulerRun();             // every loop()
+//
+//   Periodic tasks (ready == nullptr) are released every `period` µs, the
+//   first time one period after setup; one that falls a whole period behind
+//   skips the missed releases rather than running in a burst. Other tasks
+//   are released while ready() returns true. ready() may set `due` to when
+//   its work was or next will be due; left at `now` the release is the pass
+//   that first saw it ready. A priority 0 task that is not ready reports its
+//   next frame boundary this way, and the slack of the others is measured
+//   against it.
+//
+// REPORT FORMAT (schedulerReport(), one line per task):
+//   [SCHED] knobs n=1000 worst=212 late=3480 missed=0 (us)
+//
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <Arduino.h>
+
+constexpr uint8_t kSchedMaxTasks = 8;
+
+struct SchedTask {
+  const char* name;
+  void (*run)();
+  bool (*ready)(unsigned long now, unsigned long& due);  // nullptr: periodic
+  uint32_t periodMicros;    // periodic tasks only
+  uint32_t deadlineMicros;  // latest start after the release, else missed
+  uint8_t priority;         // 0 = frame, then lower runs first
+};
+
+struct SchedStats {
+  unsigned long runs;
+  unsigned long worstMicros;  // longest run
+  unsigned long worstLate;    // latest start after the release, µs
+  unsigned long missed;       // runs started past their deadline
+};
+
+// `tasks` must outlive the scheduler; at most kSchedMaxTasks are used.
+void schedulerSetup(const SchedTask* tasks, uint8_t count);
+
+// One pass; returns the number of tasks run.
+uint8_t schedulerRun();
+
+uint8_t schedulerTaskCount();
+const SchedStats& schedulerStats(uint8_t task);
+
+// Prints the report over Serial / clears the statistics. Tasks keep their
+// release times, and the worst run time that decides whether they fit.
+void schedulerReport();
+void schedulerResetStats();
+
+#endif  // SCHEDULER_H
@@ -0,0 +1,238 @@
+#include "stream.h"
+#include "animation.h"
+
+static constexpr uint8_t kPacketStart = 0xC9;
+static constexpr uint8_t kPacketEnd = 0x36;
+static constexpr uint8_t kTypeFrame = 0xDA;
+static constexpr uint8_t kTypePattern = 0xDB;
+static constexpr uint8_t kTypeCommand = 0xC0;
+
+enum class StreamState : uint8_t {
+  Idle,
+  AdaD,      // 'A' seen
+  AdaA,      // 'Ad' seen
+  AdaHi,
+  AdaLo,
+  AdaCheck,
+  Type,
+  SizeHi,
+  SizeLo,
+  Payload,
+  Sum2,
+  Sum1,
+  End,
+};
+
+static CRGB* ledsOut = nullptr;
+static uint16_t ledBytes = 0;
+
+static StreamState state = StreamState::Idle;
+static bool adalight = false;   // current payload belongs to an Adalight frame
+static bool rejected = false;   // bad size or type: payload is skipped, then Error
+static bool ledsIntact = true;
+static uint8_t type = 0;
+static uint16_t size = 0;       // payload bytes announced
+static uint16_t received = 0;   // payload bytes seen so far
+static uint8_t* dest = nullptr; // where the payload goes (nullptr: dropped)
+static uint16_t destBytes = 0;  // bytes of the payload that fit into dest
+static uint16_t sum1 = 0;
+static uint16_t sum2 = 0;
+static uint8_t sentSum2 = 0;
+static uint8_t sentSum1 = 0;
+static unsigned long lastByteMillis = 0;
+
+static uint8_t command[STREAM_COMMAND_MAX];
+static uint8_t commandLength = 0;
+
+// Fletcher-16 over type, size and payload.
+static void checksum(uint8_t c) {
+  sum1 += c;
+  if (sum1 >= 255) sum1 -= 255;
+  sum2 += sum1;
+  if (sum2 >= 255) sum2 -= 255;
+}
+
+// Chooses the payload destination once the packet header is complete.
+static void beginPayload() {
+  received = 0;
+  dest = nullptr;
+  destBytes = 0;
+  rejected = false;
+  if (type == kTypeFrame && size > 0) {
+    dest = (uint8_t*)ledsOut;
+    destBytes = size < ledBytes ? size : ledBytes;
+    ledsIntact = false;
+  } else if (type == kTypePattern && size > 0 && size % 3 == 0) {
+    dest = (uint8_t*)BeginVirtualLedsUpload(size / 3);
+    destBytes = size;
+    rejected = (dest == nullptr);
+  } else if (type == kTypeCommand && size > 0 && size <= STREAM_COMMAND_MAX) {
+    dest = command;
+    destBytes = size;
+  } else {
+    rejected = true;
+  }
+}
+
+static StreamEvent endPacket() {
+  state = StreamState::Idle;
+  if (rejected || sentSum1 != sum1 || sentSum2 != sum2) {
+    return StreamEvent::Error;
+  }
+  if (type == kTypeFrame) {
+    ledsIntact = true;
+    return StreamEvent::Frame;
+  }
+  if (type == kTypePattern) {
+    return CommitVirtualLedsUpload() ? StreamEvent::Pattern : StreamEvent::Error;
+  }
+  commandLength = (uint8_t)size;
+  return StreamEvent::Command;
+}
+
+// Outside a packet: a header byte starts one, anything else is passed on.
+static void idleByte(uint8_t c, void (*other)(uint8_t c)) {
+  if (c == kPacketStart) {
+    state = StreamState::Type;
+    adalight = false;
+    sum1 = 0;
+    sum2 = 0;
+  } else if (c == 'A') {
+    state = StreamState::AdaD;
+  } else if (other) {
+    other(c);
+  }
+}
+
+static StreamEvent consume(uint8_t c, void (*other)(uint8_t c)) {
+  switch (state) {
+    case StreamState::Idle:
+      idleByte(c, other);
+      break;
+
+    case StreamState::AdaD:
+      state = StreamState::Idle;
+      if (c == 'd') state = StreamState::AdaA;
+      else idleByte(c, other);
+      break;
+    case StreamState::AdaA:
+      state = StreamState::Idle;
+      if (c == 'a') state = StreamState::AdaHi;
+      else idleByte(c, other);
+      break;
+    case StreamState::AdaHi:
+      size = (uint16_t)c << 8;
+      state = StreamState::AdaLo;
+      break;
+    case StreamState::AdaLo:
+      size |= c;
+      state = StreamState::AdaCheck;
+      break;
+    case StreamState::AdaCheck:
+      if (c != ((size >> 8) ^ (size & 0xFF) ^ 0x55) || size >= 0xFFFF / 3) {
+        state = StreamState::Idle;
+        return StreamEvent::Error;
+      }
+      // The count is one less than the number of LEDs.
+      size = (size + 1) * 3;
+      type = kTypeFrame;
+      adalight = true;
+      beginPayload();
+      state = StreamState::Payload;
+      break;
+
+    case StreamState::Type:
+      type = c;
+      checksum(c);
+      state = StreamState::SizeHi;
+      break;
+    case StreamState::SizeHi:
+      size = (uint16_t)c << 8;
+      checksum(c);
+      state = StreamState::SizeLo;
+      break;
+    case StreamState::SizeLo:
+      size |= c;
+      checksum(c);
+      beginPayload();
+      state = size > 0 ? StreamState::Payload : StreamState::Sum2;
+      break;
+    case StreamState::Payload:
+      if (type == kTypePattern && dest && !VirtualLedsUploadOpen()) {
+        // A rebuild request took the back slot: stop writing into it.
+        dest = nullptr;
+        rejected = true;
+      }
+      if (received < destBytes && dest) dest[received] = c;
+      ++received;
+      if (!adalight) checksum(c);
+      if (received == size) {
+        if (adalight) {
+          state = StreamState::Idle;
+          ledsIntact = true;
+          return StreamEvent::Frame;
+        }
+        state = StreamState::Sum2;
+      }
+      break;
+    case StreamState::Sum2:
+      sentSum2 = c;
+      state = StreamState::Sum1;
+      break;
+    case StreamState::Sum1:
+      sentSum1 = c;
+      state = StreamState::End;
+      break;
+    case StreamState::End:
+      if (c != kPacketEnd) rejected = true;
+      return endPacket();
+  }
+  return StreamEvent::None;
+}
+
+void streamSetup(CRGB* leds, uint16_t ledCount) {
+  ledsOut = leds;
+  ledBytes = ledCount * 3;
+}
+
+StreamEvent streamPoll(uint16_t maxBytes, unsigned long nowMillis, void (*other)(uint8_t c)) {
+  if (Serial.available() <= 0) {
+    // A packet that stalls is given up, so a lost byte cannot wedge the
+    // parser until the next packet happens to fill the gap.
+    if (state != StreamState::Idle && nowMillis - lastByteMillis > STREAM_PACKET_TIMEOUT_MS) {
+      state = StreamState::Idle;
+      return StreamEvent::Error;
+    }
+    return StreamEvent::None;
+  }
+  lastByteMillis = nowMillis;
+  while (maxBytes > 0 && Serial.available() > 0) {
+    --maxBytes;
+    StreamEvent event = consume((uint8_t)Serial.read(), other);
+    if (event != StreamEvent::None) {
+      return event;
+    }
+  }
+  return StreamEvent::None;
+}
+
+bool streamBusy() {
+  return state != StreamState::Idle;
+}
+
+bool streamLedsIntact() {
+  return ledsIntact;
+}
+
+const uint8_t* streamCommand(uint8_t& length) {
+  length = commandLength;
+  return command;
+}
+
+void streamAck() {
+  Serial.write(STREAM_ACK);
+}
+
+void streamNak() {
+  Serial.write(STREAM_NAK);
+}
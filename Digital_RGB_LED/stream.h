@@ -0,0 +1,76 @@
+// Binary serial streaming for Digital_RGB_LED
+//
+// Lets a host PC drive the strip over Serial: whole frames, a virtual
+// pattern for the animation, or parameter/palette commands. Two framings
+// are understood:
+//
+//   Adalight (what Prismatik, Hyperion etc. send), frames only:
+//     'A' 'd' 'a' countHi countLo (countHi ^ countLo ^ 0x55)
+//     then (count + 1) RGB triplets
+//
+//   Packets (TPM2-style, with a Fletcher-16 checksum):
+//     0xC9 type sizeHi sizeLo payload[size] sum2 sum1 0x36
+//     type 0xDA  frame: RGB triplets for leds[0..]
+//          0xDB  pattern: RGB triplets replacing the virtual pattern
+//          0xC0  command: a command byte and its arguments
+//     The checksum runs over type, size and payload; sum1 is the running
+//     byte sum mod 255 and sum2 the sum of sum1 mod 255.
+//
+// ──────────────────────────────────────────────────────────────
+// PARSING:
+//   streamPoll() is incremental: it consumes at most maxBytes of what
+//   Serial already holds and returns, so it never waits for a packet to
+//   complete. Frame and pattern payloads are written straight into leds[]
+//   and the back slot of the virtual pattern (BeginVirtualLedsUpload()) as
+//   they arrive; there is no receive buffer. Only command payloads (at most
+//   STREAM_COMMAND_MAX bytes) are buffered. A pattern whose back slot is
+//   taken by a rebuild request mid-packet stops being written and is
+//   rejected.
+//   A packet that stalls for STREAM_PACKET_TIMEOUT_MS, has a bad size, type
+//   or checksum ends as StreamEvent::Error; the parser then hunts for the
+//   next 0xC9 / 'Ada' header. Bytes outside packets are handed to `other`
+//   (the single-character commands) or dropped when it is nullptr.
+//
+// FLOW CONTROL:
+//   The receiver answers each packet with STREAM_ACK (0x06), or STREAM_NAK
+//   (0x15) when it was rejected. For frames the ACK is sent once the frame
+//   has been handed to FastLED.show(): on AVR show() runs with interrupts
+//   off and would drop serial bytes arriving meanwhile, so the sender waits
+//   for the ACK, then sends the next frame. The strip then refreshes at
+//   1 / (transfer time + show time), the most the shared wire allows.
+//   Adalight senders ignore the replies.
+//
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <Arduino.h>
+#include <FastLED.h>
+#include "config.h"
+
+constexpr uint8_t STREAM_ACK = 0x06;
+constexpr uint8_t STREAM_NAK = 0x15;
+constexpr uint8_t STREAM_COMMAND_MAX = 64;
+
+enum class StreamEvent : uint8_t {
+  None,     // nothing complete yet
+  Frame,    // a frame is in leds[]
+  Pattern,  // a virtual pattern was uploaded and committed
+  Command,  // a command is in streamCommand()
+  Error,    // a packet was rejected (reply with a NAK)
+};
+
+// leds[] and its length in pixels; frames beyond that are cut off.
+void streamSetup(CRGB* leds, uint16_t ledCount);
+// Consumes up to maxBytes from Serial; stops early at the first event.
+StreamEvent streamPoll(uint16_t maxBytes, unsigned long nowMillis, void (*other)(uint8_t c));
+// True while a packet is only partly received.
+bool streamBusy();
+// False from the first payload byte of a frame until a frame completes
+// intact: leds[] then holds a partial or rejected frame.
+bool streamLedsIntact();
+// Payload of the last StreamEvent::Command.
+const uint8_t* streamCommand(uint8_t& length);
+void streamAck();
+void streamNak();
+
+#endif  // STREAM_H
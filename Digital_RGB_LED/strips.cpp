@@ -0,0 +1,42 @@
+#include "strips.h"
+#include "config.h"
+#include "animation.h"
+
+#ifdef EXTRA_LED_STRIPS
+
+static constexpr long kMainSectionLength = stripSectionLength(NUM_LEDS, ANIMATION_PARTS);
+
+// One static buffer per strip, named after its pin.
+#define LED_STRIP(pin, length, parts, type, reversed)                                    \
+  static_assert((length) > 0, "LED_STRIP length must be positive");                      \
+  static_assert(parsePartsType(type) != PartsType::Unknown,                              \
+                "LED_STRIP type must be \"FOLDED\" or \"CUT\"");                         \
+  static_assert(stripSectionLength((length), (parts)) <= kMainSectionLength,             \
+                "LED_STRIP section (length / parts) longer than NUM_LEDS / ANIMATION_PARTS"); \
+  static CRGB gStripLeds_##pin[(length)];
+EXTRA_LED_STRIPS
+#undef LED_STRIP
+
+#define LED_STRIP(pin, length, parts, type, reversed) \
+  { gStripLeds_##pin, (length), ((parts) < 1 ? 1 : (parts)), parsePartsType(type) == PartsType::Folded, (reversed) },
+static const LedStrip kExtraStrips[] = { EXTRA_LED_STRIPS };
+#undef LED_STRIP
+
+const LedStrip* const gExtraStrips = kExtraStrips;
+const uint8_t gExtraStripCount = sizeof(kExtraStrips) / sizeof(kExtraStrips[0]);
+
+void stripsSetup() {
+#define LED_STRIP(pin, length, parts, type, reversed) \
+  FastLED.addLeds<LED_TYPE, pin, COLOR_ORDER>(gStripLeds_##pin, (length)).setCorrection(LED_STRIP_COLOR_CORRECTION);
+  EXTRA_LED_STRIPS
+#undef LED_STRIP
+}
+
+#else  // EXTRA_LED_STRIPS
+
+const LedStrip* const gExtraStrips = nullptr;
+const uint8_t gExtraStripCount = 0;
+
+void stripsSetup() {}
+
+#endif  // EXTRA_LED_STRIPS
@@ -0,0 +1,49 @@
+// Additional LED strips for Digital_RGB_LED
+//
+// Besides the main strip (LED_PIN, NUM_LEDS) the sketch can drive further
+// strips on their own data pins, listed in EXTRA_LED_STRIPS (config.h) as
+// a sequence of
+//
+//   LED_STRIP(pin, length, parts, partsType, reversed)
+//
+// entries, e.g. LED_STRIP(32, 300, 1, "CUT", false) LED_STRIP(33, 150, 2,
+// "FOLDED", true).
+//
+// Each strip has its own length, number of sections, fold type and
+// direction, and shows the same animation as the main strip. Pixels are
+// not rendered again: every strip is filled with block copies of the
+// canonical section rendered for the main strip (see animation.cpp), so a
+// strip's section (length / parts) must not be longer than the main one
+// (NUM_LEDS / ANIMATION_PARTS). This is checked at compile time.
+//
+// Splitting a long installation over several pins shortens each strip's
+// wire time (~30 µs per LED). FastLED sends the pins in parallel on
+// platforms with parallel output (ESP32, Teensy); on AVR they are sent one
+// after another, so there only the render work is shared.
+//
+#ifndef STRIPS_H
+#define STRIPS_H
+
+#include <FastLED.h>
+
+struct LedStrip {
+  CRGB* leds;
+  long length;
+  long parts;  // sections, at least 1
+  bool folded;
+  bool reversed;
+};
+
+// Section length of a strip split into `parts`; ceil division keeps all
+// LEDs covered.
+constexpr long stripSectionLength(long length, long parts) {
+  return parts < 1 ? length : (length + parts - 1) / parts;
+}
+
+extern const LedStrip* const gExtraStrips;
+extern const uint8_t gExtraStripCount;
+
+// Registers the extra strips with FastLED. Call after the main addLeds().
+void stripsSetup();
+
+#endif  // STRIPS_H
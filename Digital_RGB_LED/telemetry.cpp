@@ -0,0 +1,132 @@
+#include "telemetry.h"
+
+#if TELEMETRY
+
+namespace tel {
+
+static Histogram histograms[(uint8_t)Probe::Count];
+static unsigned long lateFrames = 0;    // loop() passes that found frames overdue
+static unsigned long droppedFrames = 0;  // frames skipped in total
+static unsigned long since = 0;         // millis() at the last reset
+
+// Estimated current of the shown frames (power.h), in mA.
+struct PowerStats {
+  unsigned long count;
+  unsigned long total;
+  unsigned long max;
+  unsigned long limited;  // frames dimmed for POWER_LIMIT_MA
+};
+
+static PowerStats powerStats;
+
+// Render quality level (quality.h). The level is state, not a counter: a
+// reset keeps it.
+struct QualityStats {
+  uint8_t level;
+  int step;
+  uint8_t max;            // lowest quality since the reset
+  unsigned long changes;
+};
+
+static QualityStats qualityStats = { 0, 1, 0, 0 };
+
+static const char* const kProbeNames[] = { "sensor", "knobs", "audio", "render", "show", "frame", "idle" };
+static_assert(sizeof(kProbeNames) / sizeof(kProbeNames[0]) == (uint8_t)Probe::Count, "one name per probe");
+
+// Bit length of the duration, capped to the last bucket.
+static uint8_t bucketFor(unsigned long micros) {
+  uint8_t bucket = 0;
+  while (micros != 0 && bucket < kBuckets - 1) {
+    micros >>= 1;
+    ++bucket;
+  }
+  return bucket;
+}
+
+void recordSample(Probe probe, unsigned long micros) {
+  Histogram& h = histograms[(uint8_t)probe];
+  uint16_t& bucket = h.buckets[bucketFor(micros)];
+  if (bucket != 0xFFFF) ++bucket;
+  ++h.count;
+  h.total += micros;
+  if (micros > h.max) h.max = micros;
+}
+
+void recordMissed(long frames) {
+  ++lateFrames;
+  droppedFrames += (unsigned long)frames;
+}
+
+void recordPower(unsigned long milliamps, bool limited) {
+  ++powerStats.count;
+  powerStats.total += milliamps;
+  if (milliamps > powerStats.max) powerStats.max = milliamps;
+  if (limited) ++powerStats.limited;
+}
+
+void recordQuality(uint8_t level, int step) {
+  if (level != qualityStats.level) ++qualityStats.changes;
+  qualityStats.level = level;
+  qualityStats.step = step;
+  if (level > qualityStats.max) qualityStats.max = level;
+}
+
+void printReport() {
+  Serial.print("[TEL] since ");
+  Serial.print(millis() - since);
+  Serial.print(" ms, late ");
+  Serial.print(lateFrames);
+  Serial.print(", skipped frames ");
+  Serial.println(droppedFrames);
+
+  for (uint8_t p = 0; p < (uint8_t)Probe::Count; ++p) {
+    const Histogram& h = histograms[p];
+    Serial.print("[TEL] ");
+    Serial.print(kProbeNames[p]);
+    Serial.print(" n=");
+    Serial.print(h.count);
+    Serial.print(" avg=");
+    Serial.print(h.count ? h.total / h.count : 0UL);
+    Serial.print(" max=");
+    Serial.print(h.max);
+    Serial.print(" hist=");
+    for (uint8_t b = 0; b < kBuckets; ++b) {
+      if (b) Serial.print(' ');
+      Serial.print((unsigned int)h.buckets[b]);
+    }
+    Serial.println();
+  }
+
+  Serial.print("[TEL] power n=");
+  Serial.print(powerStats.count);
+  Serial.print(" avg=");
+  Serial.print(powerStats.count ? powerStats.total / powerStats.count : 0UL);
+  Serial.print(" max=");
+  Serial.print(powerStats.max);
+  Serial.print(" limited=");
+  Serial.print(powerStats.limited);
+  Serial.println(" (mA)");
+
+  Serial.print("[TEL] quality level=");
+  Serial.print(qualityStats.level);
+  Serial.print(" step=");
+  Serial.print(qualityStats.step);
+  Serial.print(" max=");
+  Serial.print(qualityStats.max);
+  Serial.print(" changes=");
+  Serial.println(qualityStats.changes);
+}
+
+void clearAll() {
+  memset(histograms, 0, sizeof(histograms));
+  memset(&powerStats, 0, sizeof(powerStats));
+  qualityStats.max = qualityStats.level;
+  qualityStats.changes = 0;
+  lateFrames = 0;
+  droppedFrames = 0;
+  since = millis();
+}
+
+}  // namespace tel
+
+#endif  // TELEMETRY
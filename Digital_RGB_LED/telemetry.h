@@ -0,0 +1,115 @@
+// Frame-time telemetry for Digital_RGB_LED
+//
+// Times the stages of loop() (sensor, knobs, audio, render, show) and the loop
+// itself, split into iterations that put a frame on the strip and idle
+// ones. Each stage keeps a histogram with power-of-two buckets, plus count,
+// total and maximum, in static RAM; late frames are counted separately.
+// Nothing is printed while running: send 't' over Serial for a summary,
+// 'T' to clear the counters.
+//
+// ──────────────────────────────────────────────────────────────
+// CONFIGURATION:
+//   - Set TELEMETRY to 1 in config_override.h to enable it.
+//   - With TELEMETRY 0 (default) every call below compiles to nothing and
+//     the counters are not allocated, the same way dbg::print works with
+//     DEBUG 0.
+//
+// USAGE:
+//   tel::Timer timer;               // starts timing
+//   renderSomething();
+//   timer.stop(tel::Probe::Render); // records the elapsed microseconds
+//   tel::missedFrames(n);           // n frames fell behind their deadline
+//
+// REPORT FORMAT (one line per probe):
+//   [TEL] render n=1200 avg=640 max=812 hist=0 0 0 0 0 0 0 0 0 0 1200 0 0 0 0 0
+//   Bucket 0 counts 0 µs, bucket b (1..14) counts [2^(b-1), 2^b) µs, and
+//   bucket 15 everything from 16384 µs up. Counts saturate at 65535.
+// and the estimated supply current of the shown frames (power.h), with the
+// number of them dimmed by POWER_LIMIT_MA:
+//   [TEL] power n=1200 avg=2140 max=3480 limited=35 (mA)
+// and the render quality level (quality.h) with the sub-frames per rendered
+// frame, the lowest quality reached and the number of level changes:
+//   [TEL] quality level=1 step=2 max=2 changes=3
+//
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <Arduino.h>
+#include "config.h"
+
+#ifndef TELEMETRY
+#define TELEMETRY 0
+#endif
+
+namespace tel {
+constexpr bool enabled = TELEMETRY;
+
+enum class Probe : uint8_t {
+  Sensor,  // handleUltrasound()
+  Knobs,   // knob reads and the palette button
+  Audio,   // audioProcess(), per hop
+  Render,  // FillLEDsFromPaletteColors()
+  Show,    // FastLED.show()
+  Frame,   // whole loop() iterations that showed a frame
+  Idle,    // whole loop() iterations that showed nothing
+  Count
+};
+
+constexpr uint8_t kBuckets = 16;
+
+struct Histogram {
+  uint16_t buckets[kBuckets];
+  unsigned long count;
+  unsigned long total;
+  unsigned long max;
+};
+
+// RAM of the histograms, for the RAM plan (ram_plan.h).
+constexpr uint16_t kRamBytes = enabled ? (uint8_t)Probe::Count * sizeof(Histogram) : 0;
+
+// Defined in telemetry.cpp only when enabled; the wrappers below never
+// reference them otherwise.
+void recordSample(Probe probe, unsigned long micros);
+void recordMissed(long frames);
+void recordPower(unsigned long milliamps, bool limited);
+void recordQuality(uint8_t level, int step);
+void printReport();
+void clearAll();
+
+class Timer {
+public:
+  [[gnu::always_inline]] Timer() {
+    if constexpr (enabled) start = micros();
+  }
+  [[gnu::always_inline]] void stop(Probe probe) {
+    if constexpr (enabled) recordSample(probe, micros() - start);
+  }
+
+private:
+  unsigned long start = 0;
+};
+
+[[gnu::always_inline]] inline void missedFrames(long frames) {
+  if constexpr (enabled) recordMissed(frames);
+}
+
+// Estimated current of a shown frame; `limited` if it was dimmed for it.
+[[gnu::always_inline]] inline void power(unsigned long milliamps, bool limited) {
+  if constexpr (enabled) recordPower(milliamps, limited);
+}
+
+// Current render quality level (quality.h); call when it changes.
+[[gnu::always_inline]] inline void quality(uint8_t level, int step) {
+  if constexpr (enabled) recordQuality(level, step);
+}
+
+[[gnu::always_inline]] inline void report() {
+  if constexpr (enabled) printReport();
+}
+
+[[gnu::always_inline]] inline void reset() {
+  if constexpr (enabled) clearAll();
+}
+}
+
+#endif  // TELEMETRY_H
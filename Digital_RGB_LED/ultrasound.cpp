@@ -1,42 +1,140 @@
-#include "debug.h"
 #include "ultrasound.h"
-#include <NewPing.h>
+#include "debug.h"
 #include "config.h"
+#include "echo_timer.h"
+#include <limits.h>
+
+#ifdef US_SENSORS
 
-#if defined(US_TRIG_PIN) && defined(US_ECHO_PIN)
+#define US_SENSOR(trigPin, echoPin, first, count)                 \
+  static_assert(digitalPinToInterrupt(echoPin) != NOT_AN_INTERRUPT, \
+                "US_SENSOR echo pins must be external interrupt pins (Mega: 2, 3, 18, 19, 20, 21)");
+US_SENSORS
+#undef US_SENSOR
+static_assert(US_MEDIAN_READINGS % 2 == 1 && US_MEDIAN_READINGS <= 7,
+              "US_MEDIAN_READINGS must be odd and at most 7");
 
-// MAX_CM determines blocking time. See: Configuration -> "Sensor config"
+// MAX_CM only limits the accepted range; it no longer blocks the loop.
 constexpr uint8_t MAX_CM = US_MAX_DISTANCE_CM + 5;  // working range
-constexpr unsigned long LOOP_DELAY = 60;            // ms between pings
+constexpr unsigned long MAX_ECHO_US = (unsigned long)MAX_CM * US_ROUNDTRIP_CM;
+constexpr unsigned long LOOP_DELAY = 60;            // ms between pings of one sensor
+
+struct Sensor {
+  uint8_t trig;
+  uint8_t echo;
+  long first;
+  long count;
+};
+
+#define US_SENSOR(trigPin, echoPin, first, count) { trigPin, echoPin, first, count },
+static const Sensor kSensors[US_SENSOR_COUNT] = { US_SENSORS };
+#undef US_SENSOR
+
+// One timer for all sensors: only one ping is ever out.
+static EchoTimer echo;
+static volatile uint8_t active = 0;  // sensor pinged last / next
 
-static NewPing sonar(US_TRIG_PIN, US_ECHO_PIN, MAX_CM);
+static unsigned long guardUntil = 0;                // µs; no ping before
+static unsigned long nextPing[US_SENSOR_COUNT];     // ms; per sensor
+static unsigned int results[US_SENSOR_COUNT][US_MEDIAN_READINGS];  // cm; 0 = no echo
+static uint8_t resultAt[US_SENSOR_COUNT];
+static float last_cm[US_SENSOR_COUNT];
+static bool fresh[US_SENSOR_COUNT];
+
+// Edges of a sensor that is not the one pinged (a late echo, or the tail of
+// a no-echo pulse) never reach the timer.
+template <uint8_t pin>
+static void echoIsr() {
+  if (kSensors[active].echo == pin) {
+    echoTimerEdge(echo, digitalRead(pin) == HIGH, micros());
+  }
+}
+
+// Median of the sensor's last results, misses sorting as farthest; 0 when
+// most of them missed.
+static unsigned int medianCm(uint8_t s) {
+  unsigned int sorted[US_MEDIAN_READINGS];
+  for (uint8_t i = 0; i < US_MEDIAN_READINGS; ++i) {
+    const unsigned int cm = results[s][i] ? results[s][i] : UINT_MAX;
+    uint8_t j = i;
+    for (; j > 0 && sorted[j - 1] > cm; --j) sorted[j] = sorted[j - 1];
+    sorted[j] = cm;
+  }
+  const unsigned int median = sorted[US_MEDIAN_READINGS / 2];
+  return median == UINT_MAX ? 0 : median;
+}
 
-static unsigned long nextPing = 0;
-static float last_cm = 0;
-static bool fresh = false;
+static void record(uint8_t s, unsigned int cm) {
+  results[s][resultAt[s]] = cm;
+  resultAt[s] = (uint8_t)((resultAt[s] + 1) % US_MEDIAN_READINGS);
+  const unsigned int median = medianCm(s);
+  if (median) {
+    last_cm[s] = median;
+    fresh[s] = true;
+  }
+}
 
 void ultrasoundSetup() {
-  dbg::println("Initializing ultrasound device");
-  nextPing = millis();
+  dbg::print("Initializing ultrasound devices: ");
+  dbg::println(US_SENSOR_COUNT);
+  echoTimerReset(echo);
+  for (uint8_t s = 0; s < US_SENSOR_COUNT; ++s) {
+    pinMode(kSensors[s].trig, OUTPUT);
+    digitalWrite(kSensors[s].trig, LOW);
+    pinMode(kSensors[s].echo, INPUT);
+    nextPing[s] = millis();
+  }
+#define US_SENSOR(trigPin, echoPin, first, count) \
+  attachInterrupt(digitalPinToInterrupt(echoPin), echoIsr<echoPin>, CHANGE);
+  US_SENSORS
+#undef US_SENSOR
+  guardUntil = micros();
 }
 
 void ultrasoundUpdate() {
-  if ((long)(millis() - nextPing) >= 0) {
-    nextPing += LOOP_DELAY;
-    unsigned int cm = sonar.ping_cm();  // blocking call
-    if (cm) {                           // 0 means out-of-range
-      last_cm = cm;
-      fresh = true;
-    }
+  unsigned int cm = 0;
+  const EchoResult result = echoTimerPoll(echo, micros(), MAX_ECHO_US, &cm);
+  if (result != EchoResult::Busy) {
+    // Done with this sensor: let the ping die down, then the next one.
+    record(active, result == EchoResult::Ready ? cm : 0);
+    guardUntil = micros() + US_GUARD_MS * 1000UL;
+    active = (uint8_t)((active + 1) % US_SENSOR_COUNT);
+  }
+
+  const uint8_t s = active;
+  if (!echoTimerIdle(echo) || (long)(micros() - guardUntil) < 0 || (long)(millis() - nextPing[s]) < 0) {
+    return;
   }
+  // A sensor that saw no echo keeps ECHO high for its own timeout (~38 ms
+  // on the HC-SR04); wait for it to drop rather than re-triggering.
+  if (digitalRead(kSensors[s].echo) == HIGH) {
+    return;
+  }
+  nextPing[s] += LOOP_DELAY;
+  if ((long)(millis() - nextPing[s]) >= 0) {
+    nextPing[s] = millis() + LOOP_DELAY;  // fell behind: do not burst pings
+  }
+
+  // 10 µs trigger pulse; the only time this driver holds up loop(), and
+  // at most once per call.
+  digitalWrite(kSensors[s].trig, HIGH);
+  delayMicroseconds(10);
+  digitalWrite(kSensors[s].trig, LOW);
+  echoTimerArm(echo, micros());
 }
 
-bool ultrasoundHasReading() {
-  return fresh;
+bool ultrasoundHasReading(uint8_t sensor) {
+  return sensor < US_SENSOR_COUNT && fresh[sensor];
 }
-float ultrasoundRead_cm() {
-  fresh = false;
-  return last_cm;
+float ultrasoundRead_cm(uint8_t sensor) {
+  if (sensor >= US_SENSOR_COUNT) return 0.0f;
+  fresh[sensor] = false;
+  return last_cm[sensor];
+}
+
+void ultrasoundSpan(uint8_t sensor, long& first, long& count) {
+  first = sensor < US_SENSOR_COUNT ? kSensors[sensor].first : 0;
+  count = sensor < US_SENSOR_COUNT ? kSensors[sensor].count : 0;
 }
 
 #endif
@@ -1,20 +1,42 @@
 // Ultrasound distance sensor driver for Digital_RGB_LED
 //
-// This module provides a simple interface for using an HC-SR04 (or compatible) ultrasonic distance sensor.
+// This module drives one or more HC-SR04 (or compatible) ultrasonic distance sensors.
+// Ranging is non-blocking: ultrasoundUpdate() sends the 10 µs trigger pulse and
+// returns; the echo is timed by a pin change interrupt (see echo_timer.h) and
+// published on a later ultrasoundUpdate() call.
+//
+// Several sensors are pinged round-robin, one at a time: the next sensor is
+// only triggered once the previous one has its echo (or gave up on it) and
+// US_GUARD_MS have passed, so the tail of one ping cannot reach another
+// sensor as a false echo. A sensor is pinged at most every 60 ms, as the
+// HC-SR04 needs. Each call sends at most one trigger pulse, so loop() is
+// held for 10 µs per call however many sensors there are.
+//
+// Each sensor keeps its last US_MEDIAN_READINGS results, misses included, and
+// publishes their median: a single stray echo or a single miss does not
+// move the value, and a target that leaves stops the readings once most of
+// the window has missed.
 //
 // ──────────────────────────────────────────────────────────────
 // CONFIGURATION:
 //   All configuration is done in the config.h (or config_override.h) file.
-//   You must define the following macros to enable the driver:
+//   One sensor:
 //     #define US_TRIG_PIN <pin>   // Arduino digital pin connected to sensor TRIG
 //     #define US_ECHO_PIN <pin>   // Arduino digital pin connected to sensor ECHO
+//   sits over the whole strip. Several sensors are listed instead as
+//     #define US_SENSORS US_SENSOR(trigPin, echoPin, firstLed, ledCount) ...
+//   each over LEDs [firstLed, firstLed + ledCount) of the main strip.
+//   Echo pins must support attachInterrupt() (Mega: 2, 3, 18, 19, 20, 21);
+//   the build fails otherwise.
 //   Example:
 //     #define US_TRIG_PIN 7
-//     #define US_ECHO_PIN 8
+//     #define US_ECHO_PIN 2
 //
 //   Additional parameters (see config.h):
-//     US_MAX_DISTANCE_CM   // Maximum distance to measure (affects blocking time)
+//     US_MAX_DISTANCE_CM   // Maximum distance to measure (longer echoes are dropped)
 //     US_MIN_DISTANCE_CM   // Minimum distance to consider valid
+//     US_GUARD_MS          // Quiet time between two sensors' pings
+//     US_MEDIAN_READINGS   // Results per sensor the median is taken over
 //
 // ──────────────────────────────────────────────────────────────
 // WIRING:
@@ -22,7 +44,7 @@
 //     VCC  -> 5V
 //     GND  -> GND
 //     TRIG -> Arduino digital pin (US_TRIG_PIN)
-//     ECHO -> Arduino digital pin (US_ECHO_PIN)
+//     ECHO -> Arduino external interrupt pin (US_ECHO_PIN)
 //
 //   Note: ECHO pin outputs 5V. If using a 3.3V microcontroller, use a voltage divider or level shifter.
 //
@@ -30,36 +52,54 @@
 // USAGE:
 //   Call ultrasoundSetup() in setup().
 //   Call ultrasoundUpdate() in loop().
-//   Use ultrasoundHasReading() to check for a new value.
-//   Use ultrasoundRead_cm() to get the last measured distance in centimeters.
+//   For each sensor s < US_SENSOR_COUNT:
+//     Use ultrasoundHasReading(s) to check for a new value.
+//     Use ultrasoundRead_cm(s) to get the last measured distance in centimeters.
+//     Use ultrasoundSpan(s, first, count) for the LEDs it sits over.
 //
-//   If the pins are not defined, all functions are stubbed and do nothing.
+//   If no sensor is defined, all functions are stubbed and do nothing.
 //
 #ifndef ULTRASOUND_H
 #define ULTRASOUND_H
 
 #include <Arduino.h>
+#include "config.h"
+
+#if !defined(US_SENSORS) && defined(US_TRIG_PIN) && defined(US_ECHO_PIN)
+#define US_SENSORS US_SENSOR(US_TRIG_PIN, US_ECHO_PIN, 0, NUM_LEDS)
+#endif
 
-/* ─── Only build the real driver when both pins are defined ─── */
-#if defined(US_TRIG_PIN) && defined(US_ECHO_PIN)
+/* ─── Only build the real driver when sensors are defined ─── */
+#ifdef US_SENSORS
 
+#define US_SENSOR(trig, echo, first, count) +1
+constexpr uint8_t US_SENSOR_COUNT = 0 US_SENSORS;
+#undef US_SENSOR
 
-void ultrasoundSetup();       // call in setup()
-void ultrasoundUpdate();      // call every loop()
-bool ultrasoundHasReading();  // true when a fresh value is ready
-float ultrasoundRead_cm();    // last distance in centimeters (cm)
+void ultrasoundSetup();                       // call in setup()
+void ultrasoundUpdate();                      // call every loop()
+bool ultrasoundHasReading(uint8_t sensor = 0);  // true when a fresh value is ready
+float ultrasoundRead_cm(uint8_t sensor = 0);    // last distance in centimeters (cm)
+// LEDs [first, first + count) of leds[] the sensor sits over.
+void ultrasoundSpan(uint8_t sensor, long& first, long& count);
 
 
 #else
 /* ─── Stubs: generate *no* code, keep the sketch compiling ─── */
+constexpr uint8_t US_SENSOR_COUNT = 0;
+
 inline void ultrasoundSetup() {}
 inline void ultrasoundUpdate() {}
-inline bool ultrasoundHasReading() {
+inline bool ultrasoundHasReading(uint8_t = 0) {
   return false;
 }
-inline float ultrasoundRead_cm() {
+inline float ultrasoundRead_cm(uint8_t = 0) {
   return 0.0f;
 }
+inline void ultrasoundSpan(uint8_t, long& first, long& count) {
+  first = 0;
+  count = 0;
+}
 
 #endif
 #endif  //ULTRASOUND_H
@@ -0,0 +1,145 @@
+#include "zones.h"
+#include "config.h"
+#include "animation.h"
+#include "palette.h"
+
+#ifdef ANIMATION_ZONES
+
+// Zones z.. are valid, the previous one ending before LED `end`. Like the
+// layout in zones.h, single-return constexpr for the AVR core's gnu++11.
+static constexpr bool zonesValidFrom(uint8_t z, long end) {
+  return z >= kZoneCount ||
+         (kZones[z].length >= 1 && kZones[z].first >= end && kZones[z].first + kZones[z].length <= NUM_LEDS &&
+          kZones[z].type != PartsType::Unknown && zonesValidFrom((uint8_t)(z + 1), kZones[z].first + kZones[z].length));
+}
+static_assert(zonesValidFrom(0, 0), "ANIMATION_ZONES: each ZONE needs a length of at least 1, a type of \"FOLDED\" or \"CUT\", "
+                                    "and must lie within NUM_LEDS after the previous one");
+
+// Distinct patterns among zones z..
+static constexpr uint8_t countPatternsFrom(uint8_t z) {
+  return z >= kZoneCount ? 0 : (zonePatternOwner(z) == z ? 1 : 0) + countPatternsFrom((uint8_t)(z + 1));
+}
+
+// Where each zone's pattern lives and how fast the zone moves against the
+// sketch's frame counter (rate / kClockRate steps per frame).
+struct ZonePattern {
+  long offset;
+  long length;
+  uint32_t rate;  // milliBPM * length
+};
+
+static constexpr uint32_t milliBpm(float bpm) {
+  return bpm <= 0.0f ? 0 : (uint32_t)(bpm * 1000.0f + 0.5f);
+}
+
+struct ZoneTable {
+  ZonePattern pattern[kZoneCount];
+};
+
+static constexpr ZonePattern zonePatternEntry(uint8_t z) {
+  return { zoneArenaPixelsBefore(zonePatternOwner(z)), zonePatternLength(kZones[z]),
+           milliBpm(kZones[z].bpm) * (uint32_t)kZones[z].length };
+}
+
+// The zone indices 0..N-1 as a parameter pack, so the table is one
+// initializer list (std::make_index_sequence is C++14).
+template <uint8_t... Z>
+struct ZoneIndices {};
+template <uint8_t N, uint8_t... Z>
+struct MakeZoneIndices : MakeZoneIndices<N - 1, N - 1, Z...> {};
+template <uint8_t... Z>
+struct MakeZoneIndices<0, Z...> {
+  typedef ZoneIndices<Z...> type;
+};
+
+template <uint8_t... Z>
+static constexpr ZoneTable makeZoneTable(ZoneIndices<Z...>) {
+  return { { zonePatternEntry(Z)... } };
+}
+
+static constexpr ZoneTable kZoneTable = makeZoneTable(MakeZoneIndices<kZoneCount>::type());
+static constexpr uint32_t kClockRate = milliBpm(BPM) * (uint32_t)NUM_LEDS;
+
+static CRGB gZoneArena[kZoneArenaPixels];
+
+#define ZONE(first, length, palette, bpm, scale, parts, type, reversed) \
+  { &leds[(first)], (length), ((parts) < 1 ? 1 : (parts)), parsePartsType(type) == PartsType::Folded, (reversed) },
+static const LedStrip kZoneStrips[] = { ANIMATION_ZONES };
+#undef ZONE
+
+const uint8_t gZoneCount = kZoneCount;
+const uint8_t gZonePatternCount = countPatternsFrom(0);
+const uint16_t gZoneRamBytes = sizeof(gZoneArena);
+
+const LedStrip& zoneStrip(uint8_t zone) {
+  return kZoneStrips[zone];
+}
+
+const CRGB* zonePattern(uint8_t zone, long& length) {
+  length = kZoneTable.pattern[zone].length;
+  return gZoneArena + kZoneTable.pattern[zone].offset;
+}
+
+long zoneFrame(uint8_t zone, long frame) {
+  if (kClockRate == 0) {
+    return frame;
+  }
+  return (long)((int64_t)frame * kZoneTable.pattern[zone].rate / kClockRate);
+}
+
+void zonesInit() {
+  CRGBPalette16 palette;
+  for (uint8_t z = 0; z < kZoneCount; ++z) {
+    if (zonePatternOwner(z) != z) {
+      continue;  // shares an earlier zone's pattern
+    }
+    paletteLoad(kZones[z].palette, palette);
+    CRGB* pattern = gZoneArena + kZoneTable.pattern[z].offset;
+    const long length = kZoneTable.pattern[z].length;
+    for (long i = 0; i < length; ++i) {
+      pattern[i] = paletteSample(palette, (uint8_t)((i * 256L) / length));
+    }
+  }
+}
+
+void zonesRender(long frame, int resolution, float) {
+  long end = 0;  // first LED after the previous zone
+  for (uint8_t z = 0; z < kZoneCount; ++z) {
+    const LedStrip& strip = kZoneStrips[z];
+    const long first = strip.leds - leds;
+    fill_solid(&leds[end], (int)(first - end), CRGB::Black);
+    FillStripFromPattern(strip, gZoneArena + kZoneTable.pattern[z].offset, kZoneTable.pattern[z].length,
+                         zoneFrame(z, frame), resolution);
+    end = first + strip.length;
+  }
+  fill_solid(&leds[end], (int)(NUM_LEDS - end), CRGB::Black);
+  for (uint8_t s = 0; s < gExtraStripCount; ++s) {
+    fill_solid(gExtraStrips[s].leds, (int)gExtraStrips[s].length, CRGB::Black);
+  }
+}
+
+#else  // ANIMATION_ZONES
+
+const uint8_t gZoneCount = 0;
+const uint8_t gZonePatternCount = 0;
+const uint16_t gZoneRamBytes = 0;
+
+const LedStrip& zoneStrip(uint8_t) {
+  static const LedStrip kNone = { nullptr, 0, 1, false, false };
+  return kNone;
+}
+
+const CRGB* zonePattern(uint8_t, long& length) {
+  length = 0;
+  return nullptr;
+}
+
+long zoneFrame(uint8_t, long frame) {
+  return frame;
+}
+
+void zonesInit() {}
+
+void zonesRender(long, int, float) {}
+
+#endif  // ANIMATION_ZONES
@@ -0,0 +1,126 @@
+// Independent zones for Digital_RGB_LED
+//
+// Splits the main strip into zones, e.g. a shelf, an arch and a sign on one
+// 300-LED run, each scrolling its own palette wave at its own speed and wave
+// length. The zones are listed in ANIMATION_ZONES (config.h) as a sequence of
+//
+//   ZONE(first, length, palette, bpm, scale, parts, partsType, reversed)
+//
+// entries: LEDs [first, first + length) of leds[], a palette registry index
+// (palette.h), the zone's BPM (a beat moves its wave by `length` LEDs, as BPM
+// does for NUM_LEDS), its wave length scale, and its own ANIMATION_PARTS,
+// ANIMATION_PARTS_TYPE and ANIMATION_REVERSED. Zones come in ascending order
+// and must not overlap (checked at compile time); LEDs outside every zone,
+// and the EXTRA_LED_STRIPS, stay dark.
+//
+// A zone's pattern is round(section length * scale) pixels of its palette.
+// All patterns are packed into one static arena sized at compile time, and
+// zones with the same palette and pattern length share one pattern instead
+// of each keeping a copy. The patterns are built when the effect is
+// selected and stay as they are; the palette commands, the crossfade and
+// the wave length knob act on the other effects.
+//
+// The zones are shown by the "zones" effect (effects.h), added to the
+// registry when ANIMATION_ZONES is defined. One render pass fills leds[]
+// zone by zone with FillStripFromPattern() (animation.h), at the sketch's
+// RESOLUTION. The zones follow the sketch's frame counter: zone z moves
+//   bpm_z * length_z / (BPM * NUM_LEDS)
+// pattern steps per step of the main wave, so at the configured BPM each
+// zone runs at its own BPM, and the BPM knob speeds them all up or down
+// together. A zone faster than BPM * NUM_LEDS / length moves more than one
+// step per frame.
+//
+// ──────────────────────────────────────────────────────────────
+// USAGE:
+//   #define ANIMATION_ZONES ZONE(0, 100, 0, 5.0, 1.0, 1, "CUT", false) ...
+//   #define EFFECT_INDEX 4    // config_override.h: start with the zones
+//   // or send 'e' over Serial until the zones show
+//
+#ifndef ZONES_H
+#define ZONES_H
+
+#include <FastLED.h>
+#include "config.h"
+#include "animation.h"
+#include "strips.h"
+
+#ifdef ANIMATION_ZONES
+
+// The zones and their arena layout, evaluated by the compiler; the RAM plan
+// (ram_plan.h) counts the arena from kZoneArenaPixels.
+struct ZoneDef {
+  long first;
+  long length;
+  uint8_t palette;
+  float bpm;
+  float scale;
+  long parts;
+  PartsType type;
+  bool reversed;
+};
+
+#define ZONE(first, length, palette, bpm, scale, parts, type, reversed) \
+  { (first), (length), (palette), (bpm), (scale), ((parts) < 1 ? 1 : (parts)), parsePartsType(type), (reversed) },
+static constexpr ZoneDef kZones[] = { ANIMATION_ZONES };
+#undef ZONE
+
+static constexpr uint8_t kZoneCount = sizeof(kZones) / sizeof(kZones[0]);
+
+// The layout is worked out by the compiler; the Arduino AVR core compiles
+// with -std=gnu++11, so each function is a single return, recursing over
+// the zones where a loop would do.
+static constexpr long zoneAtLeastOne(long length) {
+  return length < 1 ? 1 : length;
+}
+
+static constexpr long zonePatternLength(const ZoneDef& zone) {
+  return zoneAtLeastOne(
+      (long)((float)stripSectionLength(zone.length, zone.parts) * (zone.scale > 0.0f ? zone.scale : 1.0f) + 0.5f));
+}
+
+static constexpr bool zonesSharePattern(uint8_t a, uint8_t b) {
+  return kZones[a].palette == kZones[b].palette && zonePatternLength(kZones[a]) == zonePatternLength(kZones[b]);
+}
+
+// The first zone from `other` on, before z, with the same pattern as z.
+static constexpr uint8_t zonePatternOwnerFrom(uint8_t z, uint8_t other) {
+  return other >= z ? z : zonesSharePattern(other, z) ? other : zonePatternOwnerFrom(z, (uint8_t)(other + 1));
+}
+
+// The first zone with the same pattern (palette and length) as zone z,
+// which holds it in the arena; z itself when there is none.
+static constexpr uint8_t zonePatternOwner(uint8_t z) {
+  return zonePatternOwnerFrom(z, 0);
+}
+
+// Arena pixels before the patterns of zones [0, z), each stored once.
+static constexpr long zoneArenaPixelsBefore(uint8_t z) {
+  return z == 0 ? 0
+                : zoneArenaPixelsBefore((uint8_t)(z - 1)) +
+                      (zonePatternOwner((uint8_t)(z - 1)) == z - 1 ? zonePatternLength(kZones[z - 1]) : 0);
+}
+
+constexpr long kZoneArenaPixels = zoneArenaPixelsBefore(kZoneCount);
+
+#else  // ANIMATION_ZONES
+
+constexpr long kZoneArenaPixels = 0;
+
+#endif  // ANIMATION_ZONES
+
+extern const uint8_t gZoneCount;
+extern const uint8_t gZonePatternCount;  // distinct patterns in the arena
+extern const uint16_t gZoneRamBytes;     // the arena
+
+// LEDs of zone `zone` as a strip: its part of leds[], parts, fold, direction.
+const LedStrip& zoneStrip(uint8_t zone);
+// The zone's pattern in the arena; `length` receives its pixel count.
+const CRGB* zonePattern(uint8_t zone, long& length);
+// The zone's colorShift for the sketch frame counter `frame`.
+long zoneFrame(uint8_t zone, long frame);
+
+// Effect callbacks: build the patterns, render a frame.
+void zonesInit();
+void zonesRender(long frame, int resolution, float waveLengthScale);
+
+#endif  // ZONES_H
@@ -0,0 +1,294 @@
+// Render engine microbenchmark for the host build.
+//
+// Each binary is compiled for one (NUM_LEDS, ANIMATION_PARTS,
+// ANIMATION_PARTS_TYPE, ANIMATION_REVERSED) combination and sweeps the
+// runtime parameters RESOLUTION and WAVE_LENGTH_SCALE. For every case it
+// reports the cost of one FillLEDsFromPaletteColors() frame (ns/frame,
+// ns/pixel, render-only frames/s), of one RebuildVirtualLeds() call, and of
+// one bufferless FillLEDsFromPaletteDirect() frame for comparison. The
+// RENDER_HIGH_PRECISION builds ("hp") show the cost of the 16-bit pattern,
+// level table and dither against the same configuration without it.
+//
+// A second table (--table kernels) compares the compile-time specialized
+// kernels behind FillLEDsFromPaletteColors() with the generic kernel that
+// reads the layout flags at run time.
+//
+// A third table (--table fade) runs palette crossfades the way loop() does
+// (fade slice, rebuild step, render per frame) and reports the mean and
+// worst frame time during the transition against a steady frame. The worst
+// case is the smallest per-transition maximum over several runs, which
+// filters out OS preemption while keeping the deterministic peak.
+//
+// A fourth table (--table effects) renders every effect of effects.h
+// through effectRender() and reports its cost next to the state it keeps.
+//
+// A fifth table (--table palette) reports what the 16-entry currentPalette
+// saves in SRAM against a CRGBPalette256 and what it costs: one pattern's
+// worth of palette samples interpolated from 16 entries against lookups in
+// the 256-entry expansion, next to the whole pattern rebuild, and the time
+// to load a gradient palette.
+//
+// Options:
+//   --table render|kernels|fade|effects|palette  which table to print (default: render)
+//   --quick                 short timing windows (used by ctest as a smoke run)
+//   --no-header             omit the table header (used by the `bench` target)
+//   --header-only           print the table header and exit
+
+#include <Arduino.h>
+#include <FastLED.h>
+#include "config.h"
+#include "animation.h"
+#include "effects.h"
+#include "strips.h"
+#include "palette.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Timing {
+  double nsPerCall;
+  long calls;
+};
+
+// Calls fn repeatedly until at least minNs have elapsed; returns mean ns/call.
+template<typename Fn>
+Timing timeIt(double minNs, Fn&& fn) {
+  long calls = 0;
+  long batch = 1;
+  auto start = Clock::now();
+  double elapsed = 0.0;
+  while (elapsed < minNs) {
+    for (long i = 0; i < batch; ++i) fn(calls + i);
+    calls += batch;
+    elapsed = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    if (batch < (1L << 20)) batch *= 2;
+  }
+  return { elapsed / (double)calls, calls };
+}
+
+enum class Table { Render, Kernels, Fade, Effects, Palette };
+
+void printHeader(Table table) {
+  if (table == Table::Render) {
+    printf("%-24s %4s %6s %8s %12s %10s %10s %12s %14s\n",
+           "config", "res", "scale", "pattern", "fill ns/frm", "ns/pixel", "fps", "rebuild us", "direct ns/frm");
+  } else if (table == Table::Kernels) {
+    printf("%-24s %4s %6s %14s %14s %8s\n",
+           "config", "res", "scale", "special ns/frm", "generic ns/frm", "speedup");
+  } else if (table == Table::Effects) {
+    printf("%-24s %4s %6s %-8s %12s %10s %10s\n",
+           "config", "res", "scale", "effect", "ns/frame", "ns/pixel", "ram bytes");
+  } else if (table == Table::Palette) {
+    printf("%-24s %6s %8s %10s %10s %8s %12s %11s %10s\n",
+           "config", "scale", "pattern", "sample us", "lookup us", "cost", "rebuild us", "gradient ns", "sram saved");
+  } else {
+    printf("%-24s %4s %6s %8s %12s %12s %13s %8s\n",
+           "config", "res", "scale", "pattern", "steady ns", "fade mean ns", "fade worst ns", "frames");
+  }
+}
+
+struct FadeTiming {
+  double meanNs;
+  double worstNs;
+  long frames;
+};
+
+// One palette crossfade, stepped like loop() with a frame rendered every
+// iteration; times every frame individually.
+FadeTiming timeFade(const TProgmemRGBPalette16& target, int res, float scale) {
+  paletteFadeTo(target);
+  FadeTiming timing = { 0.0, 0.0, 0 };
+  double total = 0.0;
+  while (paletteFadeActive() || VirtualLedsRebuildPending()) {
+    auto start = Clock::now();
+    if (!VirtualLedsRebuildPending() && paletteFadeStep(PALETTE_FADE_ENTRIES_PER_STEP)) {
+      RequestVirtualLedsRebuild(scale);
+    }
+    StepVirtualLedsRebuild(VIRTUAL_LEDS_REBUILD_STEP);
+    FillLEDsFromPaletteColors(timing.frames, res, scale);
+    double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    total += ns;
+    if (ns > timing.worstNs) timing.worstNs = ns;
+    ++timing.frames;
+  }
+  timing.meanNs = timing.frames > 0 ? total / (double)timing.frames : 0.0;
+  return timing;
+}
+
+// A gradient with a stop between every pair of palette entries, the
+// slowest case for the loader.
+const uint8_t kBenchGradient[] PROGMEM = {
+  0, 255, 0, 0,     20, 255, 128, 0,  45, 255, 255, 0,  70, 128, 255, 0,
+  95, 0, 255, 0,    120, 0, 255, 128, 145, 0, 255, 255, 170, 0, 128, 255,
+  195, 0, 0, 255,   220, 128, 0, 255, 240, 255, 0, 255, 255, 255, 0, 0,
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool quick = false;
+  bool header = true;
+  bool headerOnly = false;
+  Table table = Table::Render;
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "--quick")) quick = true;
+    else if (!strcmp(argv[i], "--no-header")) header = false;
+    else if (!strcmp(argv[i], "--header-only")) headerOnly = true;
+    else if (!strcmp(argv[i], "--table") && i + 1 < argc && !strcmp(argv[i + 1], "render")) {
+      table = Table::Render;
+      ++i;
+    } else if (!strcmp(argv[i], "--table") && i + 1 < argc && !strcmp(argv[i + 1], "kernels")) {
+      table = Table::Kernels;
+      ++i;
+    } else if (!strcmp(argv[i], "--table") && i + 1 < argc && !strcmp(argv[i + 1], "fade")) {
+      table = Table::Fade;
+      ++i;
+    } else if (!strcmp(argv[i], "--table") && i + 1 < argc && !strcmp(argv[i + 1], "effects")) {
+      table = Table::Effects;
+      ++i;
+    } else if (!strcmp(argv[i], "--table") && i + 1 < argc && !strcmp(argv[i + 1], "palette")) {
+      table = Table::Palette;
+      ++i;
+    } else {
+      fprintf(stderr, "usage: %s [--table render|kernels|fade|effects|palette] [--quick] [--no-header | --header-only]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (headerOnly) {
+    printHeader(table);
+    return 0;
+  }
+
+  host::serialEcho(false);
+  currentPalette = RainbowColors_p;
+
+  const double minNs = quick ? 2e6 : 200e6;
+  const int resolutions[] = { 1, 2, 4, 8 };
+  const float scales[] = { 0.25f, 1.0f, 4.0f, WAVE_LENGTH_SCALE_MAX };
+
+  // Extra strips are filled from the same render; ns/pixel counts them too.
+  long totalLeds = NUM_LEDS;
+  for (uint8_t s = 0; s < gExtraStripCount; ++s) {
+    totalLeds += gExtraStrips[s].length;
+  }
+  char strips[16] = "";
+  if (gExtraStripCount > 0) {
+    snprintf(strips, sizeof(strips), " +%d strips", gExtraStripCount);
+  }
+
+  char config[48];
+  snprintf(config, sizeof(config), "n%d p%d %s%s%s%s%s", NUM_LEDS, ANIMATION_PARTS,
+           ANIMATION_PARTS > 1 ? ANIMATION_PARTS_TYPE : "-", ANIMATION_REVERSED ? " rev" : "",
+           RENDER_DIRECT_PALETTE ? " direct" : "", RENDER_HIGH_PRECISION ? " hp" : "", strips);
+
+  if (header) printHeader(table);
+
+  if (table == Table::Kernels) {
+    const bool folded = parsePartsType(ANIMATION_PARTS_TYPE) == PartsType::Folded;
+    for (int res : resolutions) {
+      const float scale = 1.0f;
+      RebuildVirtualLeds(scale, res);
+      Timing special = timeIt(minNs, [&](long frame) { FillLEDsFromPaletteColors(frame, res, scale); });
+      Timing generic = timeIt(minNs, [&](long frame) {
+        FillLEDsFromPaletteColorsGeneric(frame, res, scale, folded, ANIMATION_REVERSED);
+      });
+      printf("%-24s %4d %6.2f %14.0f %14.0f %7.2fx\n",
+             config, res, scale, special.nsPerCall, generic.nsPerCall, generic.nsPerCall / special.nsPerCall);
+    }
+    return 0;
+  }
+
+  if (table == Table::Fade) {
+    const int runs = quick ? 2 : 20;
+    const float fadeScales[] = { 1.0f, WAVE_LENGTH_SCALE_MAX };
+    const int fadeResolutions[] = { 1, 4 };
+    for (float scale : fadeScales) {
+      for (int res : fadeResolutions) {
+        currentPalette = LavaColors_p;
+        RebuildVirtualLeds(scale, res);
+        Timing steady = timeIt(minNs, [&](long frame) { FillLEDsFromPaletteColors(frame, res, scale); });
+        FadeTiming fade = { 0.0, 0.0, 0 };
+        double meanSum = 0.0;
+        for (int run = 0; run < runs; ++run) {
+          FadeTiming t = timeFade(run % 2 == 0 ? OceanColors_p : LavaColors_p, res, scale);
+          meanSum += t.meanNs;
+          if (run == 0 || t.worstNs < fade.worstNs) fade.worstNs = t.worstNs;
+          fade.frames = t.frames;
+        }
+        fade.meanNs = meanSum / runs;
+        printf("%-24s %4d %6.2f %8ld %12.0f %12.0f %13.0f %8ld\n",
+               config, res, scale, gVirtualLedCount, steady.nsPerCall, fade.meanNs, fade.worstNs, fade.frames);
+      }
+    }
+    return 0;
+  }
+
+  if (table == Table::Effects) {
+    const float effectScales[] = { 1.0f, 4.0f };
+    const int effectResolutions[] = { 1, 4 };
+    for (uint8_t e = 0; e < effectCount(); ++e) {
+      for (float scale : effectScales) {
+        for (int res : effectResolutions) {
+          effectSelect(e, scale);
+          RebuildVirtualLeds(scale, res);
+          Timing frame = timeIt(minNs, [&](long f) { effectRender(f, res, scale); });
+          printf("%-24s %4d %6.2f %-8s %12.0f %10.2f %10u\n",
+                 config, res, scale, effectName(e), frame.nsPerCall, frame.nsPerCall / totalLeds,
+                 (unsigned)effectRamBytes(e));
+        }
+      }
+    }
+    return 0;
+  }
+
+  if (table == Table::Palette) {
+    const CRGBPalette256 expanded = currentPalette;
+    const unsigned saved = (unsigned)(sizeof(CRGBPalette256) - sizeof(CRGBPalette16));
+    Timing gradient = timeIt(minNs, [&](long) {
+      CRGBPalette16 loaded;
+      paletteLoadGradient(kBenchGradient, loaded);
+      asm volatile("" : : "r"(&loaded) : "memory");
+    });
+    for (float scale : scales) {
+      RebuildVirtualLeds(scale, 1);
+      const long pattern = gVirtualLedCount;
+      std::vector<CRGB> out(pattern);
+      Timing sample = timeIt(minNs, [&](long) {
+        for (long i = 0; i < pattern; ++i) {
+          out[i] = paletteSample(currentPalette, (uint8_t)((i * 256L) / pattern));
+        }
+        asm volatile("" : : "r"(out.data()) : "memory");
+      });
+      Timing lookup = timeIt(minNs, [&](long) {
+        for (long i = 0; i < pattern; ++i) {
+          out[i] = expanded[(uint8_t)((i * 256L) / pattern)];
+        }
+        asm volatile("" : : "r"(out.data()) : "memory");
+      });
+      Timing rebuild = timeIt(minNs / 4, [&](long) { RebuildVirtualLeds(scale, 1); });
+      printf("%-24s %6.2f %8ld %10.2f %10.2f %7.2fx %12.2f %11.0f %10u\n",
+             config, scale, pattern, sample.nsPerCall / 1e3, lookup.nsPerCall / 1e3,
+             sample.nsPerCall / lookup.nsPerCall, rebuild.nsPerCall / 1e3, gradient.nsPerCall, saved);
+    }
+    return 0;
+  }
+
+  for (float scale : scales) {
+    for (int res : resolutions) {
+      Timing rebuild = timeIt(minNs / 4, [&](long) { RebuildVirtualLeds(scale, res); });
+      Timing fill = timeIt(minNs, [&](long frame) { FillLEDsFromPaletteColors(frame, res, scale); });
+      const long pattern = gVirtualLedCount;
+      Timing direct = timeIt(minNs, [&](long frame) { FillLEDsFromPaletteDirect(frame, res, scale); });
+      printf("%-24s %4d %6.2f %8ld %12.0f %10.2f %10.0f %12.2f %14.0f\n",
+             config, res, scale, pattern, fill.nsPerCall, fill.nsPerCall / totalLeds,
+             1e9 / fill.nsPerCall, rebuild.nsPerCall / 1e3, direct.nsPerCall);
+    }
+  }
+  return 0;
+}
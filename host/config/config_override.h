@@ -0,0 +1,155 @@
+// Host build configuration override for Digital_RGB_LED
+//
+// The host build puts this directory on the include path, so config.h picks
+// this file up through its `config_override.h` hook. Each HOST_* macro below
+// is set per build variant by host/CMakeLists.txt and replaces the matching
+// config.h default; anything not set keeps the config.h value.
+//
+// A local Digital_RGB_LED/config_override.h takes precedence over this file
+// (quoted includes search the sketch folder first). The host sources check
+// HOST_CONFIG_OVERRIDE and refuse to build in that case, so a benchmark can
+// never silently run the wrong configuration.
+
+#ifndef CONFIG_OVERRIDE_H
+#define CONFIG_OVERRIDE_H
+
+#define HOST_CONFIG_OVERRIDE 1
+
+#define HOST_STRINGIFY_(x) #x
+#define HOST_STRINGIFY(x) HOST_STRINGIFY_(x)
+
+#undef DEBUG
+#ifdef HOST_DEBUG
+#define DEBUG HOST_DEBUG
+#else
+#define DEBUG 0
+#endif
+
+#undef TELEMETRY
+#ifdef HOST_TELEMETRY
+#define TELEMETRY HOST_TELEMETRY
+#else
+#define TELEMETRY 0
+#endif
+
+#ifdef HOST_NUM_LEDS
+#undef NUM_LEDS
+#define NUM_LEDS HOST_NUM_LEDS
+#endif
+
+#ifdef HOST_RESOLUTION
+#undef RESOLUTION
+#define RESOLUTION HOST_RESOLUTION
+#endif
+
+#ifdef HOST_WAVE_LENGTH_SCALE
+#undef WAVE_LENGTH_SCALE
+#define WAVE_LENGTH_SCALE HOST_WAVE_LENGTH_SCALE
+#endif
+
+#ifdef HOST_ANIMATION_PARTS
+#undef ANIMATION_PARTS
+#define ANIMATION_PARTS HOST_ANIMATION_PARTS
+#endif
+
+// Passed as a bare token (FOLDED / CUT) to avoid quoting through CMake.
+#ifdef HOST_ANIMATION_PARTS_TYPE
+#undef ANIMATION_PARTS_TYPE
+#define ANIMATION_PARTS_TYPE HOST_STRINGIFY(HOST_ANIMATION_PARTS_TYPE)
+#endif
+
+#ifdef HOST_ANIMATION_REVERSED
+#undef ANIMATION_REVERSED
+#define ANIMATION_REVERSED HOST_ANIMATION_REVERSED
+#endif
+
+#ifdef HOST_RENDER_HIGH_PRECISION
+#undef RENDER_HIGH_PRECISION
+#define RENDER_HIGH_PRECISION HOST_RENDER_HIGH_PRECISION
+#endif
+
+#ifdef HOST_POWER_LIMIT_MA
+#undef POWER_LIMIT_MA
+#define POWER_LIMIT_MA HOST_POWER_LIMIT_MA
+#endif
+
+#ifdef HOST_RENDER_DIRECT_PALETTE
+#undef RENDER_DIRECT_PALETTE
+#define RENDER_DIRECT_PALETTE HOST_RENDER_DIRECT_PALETTE
+#endif
+
+// A fixed set of extra strips covering equal, shorter, reversed and folded
+// shapes; needs a main section of at least NUM_LEDS / 2.
+#if defined(HOST_EXTRA_LED_STRIPS) && HOST_EXTRA_LED_STRIPS
+#define EXTRA_LED_STRIPS                                      \
+  LED_STRIP(32, NUM_LEDS, 2, "CUT", true)                     \
+  LED_STRIP(33, NUM_LEDS / 2, 1, "CUT", !ANIMATION_REVERSED)  \
+  LED_STRIP(34, NUM_LEDS / 3, 3, "FOLDED", false)             \
+  LED_STRIP(35, 7, 2, "FOLDED", true)
+#endif
+
+// Two own palettes after the predefined ones: a gradient with a hard edge
+// (two stops at one index) and a 16-entry palette.
+#if defined(HOST_CUSTOM_PALETTES) && HOST_CUSTOM_PALETTES
+#define CUSTOM_PALETTES                                                          \
+  GRADIENT_PALETTE(edge, 0, 0, 0, 0, 128, 255, 0, 0, 128, 0, 0, 255, 255, 0, 255, 0) \
+  COLOR_PALETTE(halves, 0xFF0000, 0xFF0000, 0xFF0000, 0xFF0000, 0xFF0000, 0xFF0000,  \
+                0xFF0000, 0xFF0000, 0x0000FF, 0x0000FF, 0x0000FF, 0x0000FF,          \
+                0x0000FF, 0x0000FF, 0x0000FF, 0x0000FF)
+#endif
+
+// Four zones of a 300-LED strip: two with the same palette and pattern
+// length sharing one pattern (one reversed, at twice the speed), a folded
+// zone with a short wave and a zone with a long one, with dark gaps.
+#if defined(HOST_ZONES) && HOST_ZONES
+#define ANIMATION_ZONES                             \
+  ZONE(0, 100, 0, 5.0, 1.0, 1, "CUT", false)        \
+  ZONE(110, 100, 0, 10.0, 1.0, 1, "CUT", true)      \
+  ZONE(210, 60, 2, 12.0, 0.5, 2, "FOLDED", false)   \
+  ZONE(280, 20, 6, 2.5, 2.0, 1, "CUT", false)
+#endif
+
+#ifdef HOST_BRIGHTNESS_KNOB_PIN
+#define BRIGHTNESS_KNOB_PIN HOST_BRIGHTNESS_KNOB_PIN
+#endif
+
+#ifdef HOST_BPM_KNOB_PIN
+#define BPM_KNOB_PIN HOST_BPM_KNOB_PIN
+#endif
+
+#ifdef HOST_WAVE_LENGTH_SCALE_KNOB_PIN
+#define WAVE_LENGTH_SCALE_KNOB_PIN HOST_WAVE_LENGTH_SCALE_KNOB_PIN
+#endif
+
+#ifdef HOST_PALETTE_BUTTON_PIN
+#define PALETTE_BUTTON_PIN HOST_PALETTE_BUTTON_PIN
+#endif
+
+#ifdef HOST_US_TRIG_PIN
+#define US_TRIG_PIN HOST_US_TRIG_PIN
+#define US_ECHO_PIN HOST_US_ECHO_PIN
+#endif
+
+// Three ultrasound sensors, each over a third of a 300-LED strip.
+#if defined(HOST_US_SENSORS) && HOST_US_SENSORS
+#define US_SENSORS             \
+  US_SENSOR(7, 2, 0, 100)      \
+  US_SENSOR(8, 3, 100, 100)    \
+  US_SENSOR(9, 18, 200, 100)
+#endif
+
+#ifdef HOST_RAM_PLAN_SRAM_BYTES
+#undef RAM_PLAN_SRAM_BYTES
+#define RAM_PLAN_SRAM_BYTES HOST_RAM_PLAN_SRAM_BYTES
+#endif
+
+#ifdef HOST_AUDIO_MIC_PIN
+#define AUDIO_MIC_PIN HOST_AUDIO_MIC_PIN
+#endif
+
+#ifdef HOST_AUDIO_BRIGHTNESS_DEPTH
+#undef AUDIO_BRIGHTNESS_DEPTH
+#define AUDIO_BRIGHTNESS_DEPTH HOST_AUDIO_BRIGHTNESS_DEPTH
+#endif
+
+#endif  // CONFIG_OVERRIDE_H
@@ -0,0 +1,143 @@
+// Minimal Arduino core shim for the host (Linux) build of Digital_RGB_LED
+//
+// Only what the sketch actually uses is provided. Time is virtual: millis()
+// and micros() return a clock that only moves when the host code advances it
+// (or when the sketch calls delay()), so simulations are deterministic.
+//
+// ──────────────────────────────────────────────────────────────
+// HOST CONTROL API (namespace host):
+//   host::setMicros(t)       // jump the virtual clock to t µs
+//   host::advanceMicros(dt)  // move the virtual clock forward by dt µs
+//   host::setAnalog(pin, v)  // value returned by analogRead(pin)
+//   host::digitalLevel(pin)  // last level written with digitalWrite(pin)
+//   host::setDigitalInput(pin, level)  // drive an input; fires attached ISRs
+//   host::onDigitalWrite(fn) // observe digitalWrite() calls (simulated devices)
+//   host::serialFeed(data, n)          // bytes for Serial.read()
+//   host::serialCapture(on) / serialTakeOutput()  // collect Serial output
+//   host::serialAttachFd(fd)           // Serial reads/writes a device (pty)
+//
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+
+using std::abs;
+
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#define pgm_read_word(addr) (*(const uint16_t*)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t*)(addr))
+#define pgm_read_ptr(addr) (*(void* const*)(addr))
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+#define NOT_AN_INTERRUPT -1
+#define digitalPinToInterrupt(p) ((int)(p))
+
+#define LED_BUILTIN 13
+
+#define A0 54
+#define A1 55
+#define A2 56
+#define A3 57
+#define A4 58
+#define A5 59
+#define A6 60
+#define A7 61
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+// Interrupt numbers equal pin numbers on the host (see digitalPinToInterrupt).
+void attachInterrupt(uint8_t interruptNum, void (*isr)(void), int mode);
+void detachInterrupt(uint8_t interruptNum);
+
+template<typename T, typename L, typename H>
+inline T constrain(T amt, L low, H high) {
+  return (amt < (T)low) ? (T)low : ((amt > (T)high) ? (T)high : amt);
+}
+
+inline long map(long x, long in_min, long in_max, long out_min, long out_max) {
+  return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+// Serial: output goes to stdout, input is fed by the host through
+// host::serialFeed(). Only the subset used by the sketch is implemented.
+class HardwareSerial {
+public:
+  void begin(unsigned long) {}
+  void end() {}
+  int available();
+  int read();
+  int peek();
+  size_t write(uint8_t b);
+  size_t write(const uint8_t* buf, size_t len);
+  void flush();
+
+  size_t print(const char* s);
+  size_t print(char c);
+  size_t print(int v);
+  size_t print(unsigned int v);
+  size_t print(long v);
+  size_t print(unsigned long v);
+  size_t print(double v, int digits = 2);
+
+  template<typename T>
+  size_t println(const T& v) {
+    size_t n = print(v);
+    return n + println();
+  }
+  size_t println();
+
+  explicit operator bool() const { return true; }
+};
+
+extern HardwareSerial Serial;
+
+namespace host {
+void setMicros(unsigned long t);
+void advanceMicros(unsigned long dt);
+void setAnalog(uint8_t pin, int value);
+int digitalLevel(uint8_t pin);
+void setDigitalInput(uint8_t pin, int level);
+void onDigitalWrite(void (*hook)(uint8_t pin, uint8_t level));
+
+// Serial plumbing: bytes fed here are returned by Serial.read().
+void serialFeed(const uint8_t* data, size_t len);
+// When false, Serial output is swallowed (benchmarks keep stdout clean).
+void serialEcho(bool enabled);
+// When true, Serial output is also collected; serialTakeOutput() returns
+// and clears what was collected.
+void serialCapture(bool enabled);
+std::string serialTakeOutput();
+// Connects Serial to a non-blocking file descriptor (e.g. the master side of
+// a pty): received bytes are queued for Serial.read(), output is written to
+// it instead of stdout. -1 detaches.
+void serialAttachFd(int fd);
+}
@@ -0,0 +1,34 @@
+// Minimal EEPROM library shim for the host build of Digital_RGB_LED
+//
+// 4 KB (ATmega2560) of EEPROM, erased (0xFF) at start. A write takes 3.3 ms
+// of virtual time like on the AVR: eeprom_is_ready() is false until it has
+// passed, and a write issued before then waits for it, moving the clock.
+//
+// ──────────────────────────────────────────────────────────────
+// HOST CONTROL API (namespace host):
+//   host::eepromErase()           // every byte back to 0xFF
+//   host::eepromWrites(addr)      // writes to addr so far (wear)
+//   host::eepromWrites()          // writes to all bytes so far
+//
+#pragma once
+
+#include <Arduino.h>
+
+#define E2END 0xFFF
+
+struct EEPROMClass {
+  uint8_t read(int idx);
+  void write(int idx, uint8_t val);
+  void update(int idx, uint8_t val);  // writes only when the value differs
+  uint16_t length() { return E2END + 1; }
+};
+
+extern EEPROMClass EEPROM;
+
+bool eeprom_is_ready();
+
+namespace host {
+void eepromErase();
+unsigned long eepromWrites(int idx);
+unsigned long eepromWrites();
+}
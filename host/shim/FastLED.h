@@ -0,0 +1,297 @@
+// Minimal FastLED shim for the host (Linux) build of Digital_RGB_LED
+//
+// Implements the colour types and helpers the sketch relies on (CRGB, CHSV,
+// CRGBPalette16/256, blend, ColorFromPalette, fill_solid, the predefined
+// palettes) plus a FastLED controller object whose show() only counts frames
+// (and, if a test asks for it, spends a wire time on the virtual clock).
+// Arithmetic follows FastLED's 8-bit helpers closely enough that render
+// timings and output are representative of the real library.
+//
+#pragma once
+
+#include <Arduino.h>
+
+typedef uint8_t fract8;
+
+inline uint8_t scale8(uint8_t i, fract8 scale) {
+  return (uint8_t)(((uint16_t)i * (uint16_t)(1 + scale)) >> 8);
+}
+
+inline uint8_t scale8_video(uint8_t i, fract8 scale) {
+  return (uint8_t)((((uint16_t)i * (uint16_t)scale) >> 8) + ((i && scale) ? 1 : 0));
+}
+
+inline uint8_t qadd8(uint8_t i, uint8_t j) {
+  unsigned int t = i + j;
+  return (uint8_t)(t > 255 ? 255 : t);
+}
+
+inline uint8_t qsub8(uint8_t i, uint8_t j) {
+  int t = i - j;
+  return (uint8_t)(t < 0 ? 0 : t);
+}
+
+inline uint8_t blend8(uint8_t a, uint8_t b, uint8_t amountOfB) {
+  uint16_t partial = (uint16_t)((a << 8) | b);
+  partial += (uint16_t)(b * amountOfB);
+  partial -= (uint16_t)(a * amountOfB);
+  return (uint8_t)(partial >> 8);
+}
+
+inline uint8_t lerp8by8(uint8_t a, uint8_t b, fract8 frac) {
+  if (b > a) return (uint8_t)(a + scale8((uint8_t)(b - a), frac));
+  return (uint8_t)(a - scale8((uint8_t)(a - b), frac));
+}
+
+#define HUE_RED 0
+#define HUE_ORANGE 32
+#define HUE_YELLOW 64
+#define HUE_GREEN 96
+#define HUE_AQUA 128
+#define HUE_BLUE 160
+#define HUE_PURPLE 192
+#define HUE_PINK 224
+
+struct CHSV {
+  uint8_t h, s, v;
+  CHSV() : h(0), s(0), v(0) {}
+  CHSV(uint8_t ih, uint8_t is, uint8_t iv) : h(ih), s(is), v(iv) {}
+};
+
+struct CRGB;
+void hsv2rgb_rainbow(const CHSV& hsv, CRGB& rgb);
+
+struct CRGB {
+  union {
+    struct {
+      uint8_t r;
+      uint8_t g;
+      uint8_t b;
+    };
+    uint8_t raw[3];
+  };
+
+  CRGB() : r(0), g(0), b(0) {}
+  CRGB(uint8_t ir, uint8_t ig, uint8_t ib) : r(ir), g(ig), b(ib) {}
+  CRGB(uint32_t colorcode)
+    : r((uint8_t)(colorcode >> 16)), g((uint8_t)(colorcode >> 8)), b((uint8_t)colorcode) {}
+  CRGB(const CHSV& hsv) { hsv2rgb_rainbow(hsv, *this); }
+
+  uint8_t& operator[](uint8_t x) { return raw[x]; }
+  const uint8_t& operator[](uint8_t x) const { return raw[x]; }
+
+  CRGB& nscale8(uint8_t scale) {
+    r = scale8(r, scale);
+    g = scale8(g, scale);
+    b = scale8(b, scale);
+    return *this;
+  }
+
+  CRGB& nscale8_video(uint8_t scale) {
+    r = scale8_video(r, scale);
+    g = scale8_video(g, scale);
+    b = scale8_video(b, scale);
+    return *this;
+  }
+
+  CRGB& operator+=(const CRGB& o) {
+    r = qadd8(r, o.r);
+    g = qadd8(g, o.g);
+    b = qadd8(b, o.b);
+    return *this;
+  }
+
+  uint8_t getAverageLight() const { return (uint8_t)(((uint16_t)r + g + b) / 3); }
+
+  enum HTMLColorCode : uint32_t {
+    Aqua = 0x00FFFF,
+    Aquamarine = 0x7FFFD4,
+    Black = 0x000000,
+    Blue = 0x0000FF,
+    CadetBlue = 0x5F9EA0,
+    CornflowerBlue = 0x6495ED,
+    DarkBlue = 0x00008B,
+    DarkCyan = 0x008B8B,
+    DarkGreen = 0x006400,
+    DarkOliveGreen = 0x556B2F,
+    DarkRed = 0x8B0000,
+    ForestGreen = 0x228B22,
+    Gray = 0x808080,
+    Green = 0x008000,
+    LawnGreen = 0x7CFC00,
+    LightBlue = 0xADD8E6,
+    LightGreen = 0x90EE90,
+    LightSkyBlue = 0x87CEFA,
+    LimeGreen = 0x32CD32,
+    Maroon = 0x800000,
+    MediumAquamarine = 0x66CDAA,
+    MediumBlue = 0x0000CD,
+    MidnightBlue = 0x191970,
+    Navy = 0x000080,
+    OliveDrab = 0x6B8E23,
+    Orange = 0xFFA500,
+    Red = 0xFF0000,
+    SeaGreen = 0x2E8B57,
+    SkyBlue = 0x87CEEB,
+    Teal = 0x008080,
+    White = 0xFFFFFF,
+    YellowGreen = 0x9ACD32,
+  };
+};
+
+inline void nscale8_video(CRGB* leds, uint16_t num, uint8_t scale) {
+  for (uint16_t i = 0; i < num; ++i) leds[i].nscale8_video(scale);
+}
+
+inline bool operator==(const CRGB& a, const CRGB& b) {
+  return a.r == b.r && a.g == b.g && a.b == b.b;
+}
+inline bool operator!=(const CRGB& a, const CRGB& b) {
+  return !(a == b);
+}
+
+inline CRGB blend(const CRGB& p1, const CRGB& p2, fract8 amountOfP2) {
+  return CRGB(blend8(p1.r, p2.r, amountOfP2),
+              blend8(p1.g, p2.g, amountOfP2),
+              blend8(p1.b, p2.b, amountOfP2));
+}
+
+inline void fill_solid(CRGB* leds, int numToFill, const CRGB& color) {
+  for (int i = 0; i < numToFill; ++i) leds[i] = color;
+}
+
+/* ─────────── Palettes ─────────── */
+typedef uint32_t TProgmemRGBPalette16[16];
+typedef TProgmemRGBPalette16 TProgmemPalette16;
+
+enum TBlendType {
+  NOBLEND = 0,
+  LINEARBLEND = 1,
+  LINEARBLEND_NOWRAP = 2
+};
+
+struct CRGBPalette16 {
+  CRGB entries[16];
+
+  CRGBPalette16() {}
+  CRGBPalette16(const CRGB& c00, const CRGB& c01, const CRGB& c02, const CRGB& c03,
+                const CRGB& c04, const CRGB& c05, const CRGB& c06, const CRGB& c07,
+                const CRGB& c08, const CRGB& c09, const CRGB& c10, const CRGB& c11,
+                const CRGB& c12, const CRGB& c13, const CRGB& c14, const CRGB& c15) {
+    const CRGB* src[16] = { &c00, &c01, &c02, &c03, &c04, &c05, &c06, &c07,
+                            &c08, &c09, &c10, &c11, &c12, &c13, &c14, &c15 };
+    for (uint8_t i = 0; i < 16; ++i) entries[i] = *src[i];
+  }
+  CRGBPalette16(const TProgmemRGBPalette16& rhs) {
+    for (uint8_t i = 0; i < 16; ++i) entries[i] = CRGB(rhs[i]);
+  }
+
+  CRGB& operator[](uint8_t x) { return entries[x]; }
+  const CRGB& operator[](uint8_t x) const { return entries[x]; }
+  operator CRGB*() { return &entries[0]; }
+  operator const CRGB*() const { return &entries[0]; }
+};
+
+CRGB ColorFromPalette(const CRGBPalette16& pal, uint8_t index, uint8_t brightness = 255,
+                      TBlendType blendType = LINEARBLEND);
+
+struct CRGBPalette256 {
+  CRGB entries[256];
+
+  CRGBPalette256() {}
+  CRGBPalette256(const CRGBPalette16& rhs) { *this = rhs; }
+  CRGBPalette256(const TProgmemRGBPalette16& rhs) { *this = CRGBPalette16(rhs); }
+
+  CRGBPalette256& operator=(const CRGBPalette16& rhs) {
+    for (int i = 0; i < 256; ++i) entries[i] = ColorFromPalette(rhs, (uint8_t)i);
+    return *this;
+  }
+  CRGBPalette256& operator=(const TProgmemRGBPalette16& rhs) {
+    return *this = CRGBPalette16(rhs);
+  }
+
+  CRGB& operator[](uint8_t x) { return entries[x]; }
+  const CRGB& operator[](uint8_t x) const { return entries[x]; }
+  operator CRGB*() { return &entries[0]; }
+  operator const CRGB*() const { return &entries[0]; }
+};
+
+CRGB ColorFromPalette(const CRGBPalette256& pal, uint8_t index, uint8_t brightness = 255,
+                      TBlendType blendType = LINEARBLEND);
+
+extern const TProgmemRGBPalette16 CloudColors_p;
+extern const TProgmemRGBPalette16 LavaColors_p;
+extern const TProgmemRGBPalette16 OceanColors_p;
+extern const TProgmemRGBPalette16 ForestColors_p;
+extern const TProgmemRGBPalette16 RainbowColors_p;
+extern const TProgmemRGBPalette16 RainbowStripeColors_p;
+extern const TProgmemRGBPalette16 PartyColors_p;
+extern const TProgmemRGBPalette16 HeatColors_p;
+
+/* ─────────── Controller ─────────── */
+enum EOrder {
+  RGB = 0012,
+  RBG = 0021,
+  GRB = 0102,
+  GBR = 0120,
+  BRG = 0201,
+  BGR = 0210
+};
+
+enum LEDColorCorrection : uint32_t {
+  TypicalSMD5050 = 0xFFB0F0,
+  TypicalLEDStrip = 0xFFB0F0,
+  UncorrectedColor = 0xFFFFFF
+};
+
+template<uint8_t DATA_PIN, EOrder RGB_ORDER>
+class WS2812B {};
+template<uint8_t DATA_PIN, EOrder RGB_ORDER>
+class WS2812 {};
+template<uint8_t DATA_PIN, EOrder RGB_ORDER>
+class NEOPIXEL {};
+
+class CLEDController {
+public:
+  CLEDController& setCorrection(uint32_t) { return *this; }
+  CLEDController& setCorrection(const CRGB&) { return *this; }
+
+  CRGB* leds = nullptr;
+  int size = 0;
+  uint8_t pin = 0;
+};
+
+class CFastLED {
+public:
+  template<template<uint8_t, EOrder> class CHIPSET, uint8_t DATA_PIN, EOrder RGB_ORDER>
+  CLEDController& addLeds(CRGB* data, int nLedsOrOffset, int nLedsIfOffset = 0) {
+    return addController(DATA_PIN, nLedsIfOffset > 0 ? data + nLedsOrOffset : data,
+                         nLedsIfOffset > 0 ? nLedsIfOffset : nLedsOrOffset);
+  }
+
+  void setBrightness(uint8_t scale) { mBrightness = scale; }
+  uint8_t getBrightness() const { return mBrightness; }
+  void show();
+  void show(uint8_t scale);
+  void clear(bool writeData = false);
+
+  int count() const { return mCount; }
+  CLEDController& operator[](int x) { return mControllers[x]; }
+
+  // Host-only: number of show() calls since start.
+  unsigned long showCount() const { return mShows; }
+  // Host-only: virtual µs each show() takes (the wire time; 0 by default).
+  void setShowMicros(unsigned long us) { mShowMicros = us; }
+
+private:
+  CLEDController& addController(uint8_t pin, CRGB* data, int n);
+
+  static const int kMaxControllers = 8;
+  CLEDController mControllers[kMaxControllers];
+  int mCount = 0;
+  uint8_t mBrightness = 255;
+  unsigned long mShows = 0;
+  unsigned long mShowMicros = 0;
+};
+
+extern CFastLED FastLED;
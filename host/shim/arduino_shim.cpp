@@ -0,0 +1,270 @@
+// Host implementation of the Arduino core subset declared in shim/Arduino.h
+// (and of the EEPROM library, shim/EEPROM.h).
+
+#include <Arduino.h>
+#include <EEPROM.h>
+
+#include <cstdarg>
+#include <cstdio>
+#include <deque>
+#include <string>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+
+HardwareSerial Serial;
+
+namespace {
+unsigned long gMicros = 0;
+int gAnalog[256] = {};
+uint8_t gDigital[256] = {};
+std::deque<uint8_t> gSerialIn;
+bool gSerialEcho = true;
+bool gSerialCapture = false;
+std::string gSerialOut;
+int gSerialFd = -1;
+
+// All Serial output goes through here: written to the attached device, or
+// echoed to stdout, and/or captured.
+void serialOut(const char* data, size_t len) {
+  if (gSerialFd >= 0) {
+    while (len > 0) {
+      ssize_t n = ::write(gSerialFd, data, len);
+      if (n < 0 && errno == EAGAIN) {
+        pollfd p = { gSerialFd, POLLOUT, 0 };
+        poll(&p, 1, 100);
+        continue;
+      }
+      if (n <= 0) break;
+      data += n;
+      len -= (size_t)n;
+    }
+  } else if (gSerialEcho) {
+    fwrite(data, 1, len, stdout);
+  }
+  if (gSerialCapture) gSerialOut.append(data, len);
+}
+
+// Moves whatever the attached device has received into the input queue.
+void serialPull() {
+  if (gSerialFd < 0) return;
+  uint8_t buf[256];
+  ssize_t n;
+  while ((n = ::read(gSerialFd, buf, sizeof(buf))) > 0) {
+    gSerialIn.insert(gSerialIn.end(), buf, buf + n);
+  }
+}
+
+struct Isr {
+  void (*fn)(void);
+  int mode;
+};
+Isr gIsr[256] = {};
+void (*gDigitalWriteHook)(uint8_t, uint8_t) = nullptr;
+}
+
+unsigned long millis() {
+  return gMicros / 1000UL;
+}
+
+unsigned long micros() {
+  return gMicros;
+}
+
+void delay(unsigned long ms) {
+  gMicros += ms * 1000UL;
+}
+
+void delayMicroseconds(unsigned int us) {
+  gMicros += us;
+}
+
+// The pull-up makes an unconnected input read HIGH.
+void pinMode(uint8_t pin, uint8_t mode) {
+  if (mode == INPUT_PULLUP) gDigital[pin] = HIGH;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  gDigital[pin] = val ? HIGH : LOW;
+  if (gDigitalWriteHook) gDigitalWriteHook(pin, gDigital[pin]);
+}
+
+void attachInterrupt(uint8_t interruptNum, void (*isr)(void), int mode) {
+  gIsr[interruptNum].fn = isr;
+  gIsr[interruptNum].mode = mode;
+}
+
+void detachInterrupt(uint8_t interruptNum) {
+  gIsr[interruptNum].fn = nullptr;
+}
+
+int digitalRead(uint8_t pin) {
+  return gDigital[pin];
+}
+
+int analogRead(uint8_t pin) {
+  return gAnalog[pin];
+}
+
+int HardwareSerial::available() {
+  serialPull();
+  return (int)gSerialIn.size();
+}
+
+int HardwareSerial::read() {
+  if (gSerialIn.empty()) serialPull();
+  if (gSerialIn.empty()) return -1;
+  uint8_t b = gSerialIn.front();
+  gSerialIn.pop_front();
+  return b;
+}
+
+int HardwareSerial::peek() {
+  return gSerialIn.empty() ? -1 : gSerialIn.front();
+}
+
+size_t HardwareSerial::write(uint8_t b) {
+  serialOut((const char*)&b, 1);
+  return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t* buf, size_t len) {
+  serialOut((const char*)buf, len);
+  return len;
+}
+
+void HardwareSerial::flush() {
+  if (gSerialEcho) fflush(stdout);
+}
+
+static size_t emit(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+static size_t emit(const char* fmt, ...) {
+  char buf[64];
+  va_list args;
+  va_start(args, fmt);
+  int n = vsnprintf(buf, sizeof(buf), fmt, args);
+  va_end(args);
+  if (n < 0) return 0;
+  serialOut(buf, strlen(buf));
+  return strlen(buf);
+}
+
+size_t HardwareSerial::print(const char* s) {
+  serialOut(s, strlen(s));
+  return strlen(s);
+}
+size_t HardwareSerial::print(char c) {
+  return write((uint8_t)c);
+}
+size_t HardwareSerial::print(int v) {
+  return emit("%d", v);
+}
+size_t HardwareSerial::print(unsigned int v) {
+  return emit("%u", v);
+}
+size_t HardwareSerial::print(long v) {
+  return emit("%ld", v);
+}
+size_t HardwareSerial::print(unsigned long v) {
+  return emit("%lu", v);
+}
+size_t HardwareSerial::print(double v, int digits) {
+  return emit("%.*f", digits, v);
+}
+size_t HardwareSerial::println() {
+  return print("\r\n");
+}
+
+namespace host {
+void setMicros(unsigned long t) {
+  gMicros = t;
+}
+void advanceMicros(unsigned long dt) {
+  gMicros += dt;
+}
+void setAnalog(uint8_t pin, int value) {
+  gAnalog[pin] = value;
+}
+int digitalLevel(uint8_t pin) {
+  return gDigital[pin];
+}
+void setDigitalInput(uint8_t pin, int level) {
+  uint8_t previous = gDigital[pin];
+  gDigital[pin] = level ? HIGH : LOW;
+  const Isr& isr = gIsr[pin];
+  if (!isr.fn || previous == gDigital[pin]) return;
+  if (isr.mode == CHANGE || (isr.mode == RISING && level) || (isr.mode == FALLING && !level)) isr.fn();
+}
+void onDigitalWrite(void (*hook)(uint8_t pin, uint8_t level)) {
+  gDigitalWriteHook = hook;
+}
+void serialFeed(const uint8_t* data, size_t len) {
+  gSerialIn.insert(gSerialIn.end(), data, data + len);
+}
+void serialEcho(bool enabled) {
+  gSerialEcho = enabled;
+}
+void serialAttachFd(int fd) {
+  gSerialFd = fd;
+}
+void serialCapture(bool enabled) {
+  gSerialCapture = enabled;
+}
+std::string serialTakeOutput() {
+  std::string out;
+  out.swap(gSerialOut);
+  return out;
+}
+}
+
+
+// EEPROM (shim/EEPROM.h)
+
+EEPROMClass EEPROM;
+
+namespace {
+constexpr unsigned long kEepromWriteMicros = 3300;
+uint8_t gEeprom[E2END + 1];
+unsigned long gEepromWrites[E2END + 1] = {};
+unsigned long gEepromReadyAt = 0;
+bool gEepromErased = false;
+
+uint8_t* eeprom() {
+  if (!gEepromErased) host::eepromErase();
+  return gEeprom;
+}
+}
+
+bool eeprom_is_ready() {
+  return (long)(gMicros - gEepromReadyAt) >= 0;
+}
+
+uint8_t EEPROMClass::read(int idx) {
+  return eeprom()[idx & E2END];
+}
+
+void EEPROMClass::write(int idx, uint8_t val) {
+  if (!eeprom_is_ready()) gMicros = gEepromReadyAt;  // the AVR waits for the previous write
+  eeprom()[idx & E2END] = val;
+  ++gEepromWrites[idx & E2END];
+  gEepromReadyAt = gMicros + kEepromWriteMicros;
+}
+
+void EEPROMClass::update(int idx, uint8_t val) {
+  if (read(idx) != val) write(idx, val);
+}
+
+namespace host {
+void eepromErase() {
+  for (uint8_t& b : gEeprom) b = 0xFF;
+  gEepromErased = true;
+}
+unsigned long eepromWrites(int idx) {
+  return gEepromWrites[idx & E2END];
+}
+unsigned long eepromWrites() {
+  unsigned long total = 0;
+  for (unsigned long n : gEepromWrites) total += n;
+  return total;
+}
+}
@@ -0,0 +1,125 @@
+// Host implementation of the FastLED subset declared in shim/FastLED.h.
+
+#include <FastLED.h>
+
+CFastLED FastLED;
+
+void hsv2rgb_rainbow(const CHSV& hsv, CRGB& rgb) {
+  // Piecewise-linear hue wheel; close enough to FastLED's rainbow mapping
+  // for palette setup on the host.
+  uint8_t region = hsv.h / 43;
+  uint8_t rem = (uint8_t)((hsv.h - region * 43) * 6);
+  uint8_t p = scale8(hsv.v, (uint8_t)(255 - hsv.s));
+  uint8_t q = scale8(hsv.v, (uint8_t)(255 - scale8(hsv.s, rem)));
+  uint8_t t = scale8(hsv.v, (uint8_t)(255 - scale8(hsv.s, (uint8_t)(255 - rem))));
+  switch (region) {
+    case 0: rgb = CRGB(hsv.v, t, p); break;
+    case 1: rgb = CRGB(q, hsv.v, p); break;
+    case 2: rgb = CRGB(p, hsv.v, t); break;
+    case 3: rgb = CRGB(p, q, hsv.v); break;
+    case 4: rgb = CRGB(t, p, hsv.v); break;
+    default: rgb = CRGB(hsv.v, p, q); break;
+  }
+}
+
+CRGB ColorFromPalette(const CRGBPalette16& pal, uint8_t index, uint8_t brightness, TBlendType blendType) {
+  uint8_t hi4 = index >> 4;
+  uint8_t lo4 = index & 0x0F;
+  CRGB color = pal[hi4];
+  if (lo4 && blendType != NOBLEND) {
+    const CRGB& next = (hi4 == 15) ? pal[0] : pal[hi4 + 1];
+    uint8_t f2 = (uint8_t)(lo4 << 4);
+    uint8_t f1 = (uint8_t)(255 - f2);
+    color.r = (uint8_t)(scale8(color.r, f1) + scale8(next.r, f2));
+    color.g = (uint8_t)(scale8(color.g, f1) + scale8(next.g, f2));
+    color.b = (uint8_t)(scale8(color.b, f1) + scale8(next.b, f2));
+  }
+  if (brightness != 255) color.nscale8_video(brightness);
+  return color;
+}
+
+CRGB ColorFromPalette(const CRGBPalette256& pal, uint8_t index, uint8_t brightness, TBlendType) {
+  CRGB color = pal[index];
+  if (brightness != 255) color.nscale8_video(brightness);
+  return color;
+}
+
+void CFastLED::show() {
+  ++mShows;
+  if (mShowMicros) host::advanceMicros(mShowMicros);
+}
+
+void CFastLED::show(uint8_t scale) {
+  mBrightness = scale;
+  show();
+}
+
+void CFastLED::clear(bool writeData) {
+  for (int i = 0; i < mCount; ++i) fill_solid(mControllers[i].leds, mControllers[i].size, CRGB::Black);
+  if (writeData) show();
+}
+
+CLEDController& CFastLED::addController(uint8_t pin, CRGB* data, int n) {
+  CLEDController& c = mControllers[mCount < kMaxControllers ? mCount++ : kMaxControllers - 1];
+  c.leds = data;
+  c.size = n;
+  c.pin = pin;
+  return c;
+}
+
+/* ─────────── Predefined palettes (values as in FastLED colorpalettes.cpp) ─────────── */
+const TProgmemRGBPalette16 CloudColors_p = {
+  CRGB::Blue, CRGB::DarkBlue, CRGB::DarkBlue, CRGB::DarkBlue,
+  CRGB::DarkBlue, CRGB::DarkBlue, CRGB::DarkBlue, CRGB::DarkBlue,
+  CRGB::Blue, CRGB::DarkBlue, CRGB::SkyBlue, CRGB::SkyBlue,
+  CRGB::LightBlue, CRGB::White, CRGB::LightBlue, CRGB::SkyBlue
+};
+
+const TProgmemRGBPalette16 LavaColors_p = {
+  CRGB::Black, CRGB::Maroon, CRGB::Black, CRGB::Maroon,
+  CRGB::DarkRed, CRGB::DarkRed, CRGB::Maroon, CRGB::DarkRed,
+  CRGB::DarkRed, CRGB::DarkRed, CRGB::Red, CRGB::Orange,
+  CRGB::White, CRGB::Orange, CRGB::Red, CRGB::DarkRed
+};
+
+const TProgmemRGBPalette16 OceanColors_p = {
+  CRGB::MidnightBlue, CRGB::DarkBlue, CRGB::MidnightBlue, CRGB::Navy,
+  CRGB::DarkBlue, CRGB::MediumBlue, CRGB::SeaGreen, CRGB::Teal,
+  CRGB::CadetBlue, CRGB::Blue, CRGB::DarkCyan, CRGB::CornflowerBlue,
+  CRGB::Aquamarine, CRGB::SeaGreen, CRGB::Aqua, CRGB::LightSkyBlue
+};
+
+const TProgmemRGBPalette16 ForestColors_p = {
+  CRGB::DarkGreen, CRGB::DarkGreen, CRGB::DarkOliveGreen, CRGB::DarkGreen,
+  CRGB::Green, CRGB::ForestGreen, CRGB::OliveDrab, CRGB::Green,
+  CRGB::SeaGreen, CRGB::MediumAquamarine, CRGB::LimeGreen, CRGB::YellowGreen,
+  CRGB::LightGreen, CRGB::LawnGreen, CRGB::MediumAquamarine, CRGB::ForestGreen
+};
+
+const TProgmemRGBPalette16 RainbowColors_p = {
+  0xFF0000, 0xD52A00, 0xAB5500, 0xAB7F00,
+  0xABAB00, 0x56D500, 0x00FF00, 0x00D52A,
+  0x00AB55, 0x0056AA, 0x0000FF, 0x2A00D5,
+  0x5500AB, 0x7F0081, 0xAB0055, 0xD5002B
+};
+
+const TProgmemRGBPalette16 RainbowStripeColors_p = {
+  0xFF0000, 0x000000, 0xAB5500, 0x000000,
+  0xABAB00, 0x000000, 0x00FF00, 0x000000,
+  0x00AB55, 0x000000, 0x0000FF, 0x000000,
+  0x5500AB, 0x000000, 0xAB0055, 0x000000
+};
+
+const TProgmemRGBPalette16 PartyColors_p = {
+  0x5500AB, 0x84007C, 0xB5004B, 0xE5001B,
+  0xE81700, 0xB84700, 0xAB7700, 0xABAB00,
+  0xAB5500, 0xDD2200, 0xF2000E, 0xC2003E,
+  0x8F0071, 0x5F00A1, 0x2F00D0, 0x0007F9
+};
+
+const TProgmemRGBPalette16 HeatColors_p = {
+  0x000000, 0x330000, 0x660000, 0x990000,
+  0xCC0000, 0xFF0000, 0xFF3300, 0xFF6600,
+  0xFF9900, 0xFFCC00, 0xFFFF00, 0xFFFF33,
+  0xFFFF66, 0xFFFF99, 0xFFFFCC, 0xFFFFFF
+};
@@ -0,0 +1,12 @@
+// Compiles Digital_RGB_LED.ino as an ordinary C++ translation unit for the
+// host build. The Arduino builder does the same thing after generating
+// prototypes; the sketch declares its own, so no preprocessing is needed.
+
+#include <Arduino.h>
+#include "config.h"
+
+#ifndef HOST_CONFIG_OVERRIDE
+#error "Digital_RGB_LED/config_override.h shadows host/config/config_override.h; move it aside for host builds"
+#endif
+
+#include "Digital_RGB_LED.ino"
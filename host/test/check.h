@@ -0,0 +1,44 @@
+// Tiny assertion helpers for the host tests (no external framework needed).
+//
+//   CHECK(cond)            // records a failure and continues
+//   CHECK_EQ(a, b)         // same, prints both values (must be printable as long)
+//   return checkSummary(); // at the end of main(): 0 if everything passed
+#pragma once
+
+#include <cstdio>
+
+namespace check {
+inline int& failures() {
+  static int count = 0;
+  return count;
+}
+}
+
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      ++check::failures();                                                     \
+      if (check::failures() <= 20)                                             \
+        fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+    }                                                                          \
+  } while (0)
+
+#define CHECK_EQ(a, b)                                                         \
+  do {                                                                         \
+    long check_a_ = (long)(a);                                                 \
+    long check_b_ = (long)(b);                                                 \
+    if (check_a_ != check_b_) {                                                \
+      ++check::failures();                                                     \
+      if (check::failures() <= 20)                                             \
+        fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed: %ld != %ld\n",        \
+                __FILE__, __LINE__, #a, #b, check_a_, check_b_);               \
+    }                                                                          \
+  } while (0)
+
+inline int checkSummary() {
+  if (check::failures()) {
+    fprintf(stderr, "%d check(s) failed\n", check::failures());
+    return 1;
+  }
+  return 0;
+}
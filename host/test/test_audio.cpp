@@ -0,0 +1,253 @@
+// Audio beat tracking: the fixed-point FFT against a floating-point DFT,
+// and the tracker fed from WAV files of synthetic music (kick on the beat,
+// hats off the beat, a pad and noise), written and read back through
+// wav.h: tempo, beat phase, the bass level, the ring dropping hops, losing
+// the beat in silence, never finding one in noise, and samples missing
+// while FastLED.show() keeps interrupts off. Then the sketch following the
+// music: the frame rate at the tempo over AUDIO_BEATS_PER_WAVE, the wave
+// on the beat and the brightness following the bass.
+// Built for the HOST_AUDIO_MIC_PIN variant; leaves audio_120bpm.wav behind
+// for the audio_wav tool test.
+
+#include <Arduino.h>
+#include <FastLED.h>
+#include "config.h"
+#include "animation.h"
+#include "audio.h"
+#include "frame_timer.h"
+#include "output.h"
+#include "check.h"
+#include "wav.h"
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+void setup();
+void loop();
+extern FrameTimer frameTimer;
+extern float waveLengthScale;
+
+namespace {
+
+const unsigned long kSampleMicros = 1000000UL / AUDIO_SAMPLE_RATE;
+const double kPi = 3.14159265358979323846;
+
+uint32_t noiseState = 1;
+float noise() {
+  noiseState = noiseState * 1664525u + 1013904223u;
+  return (int32_t)noiseState / 2147483648.0f;
+}
+
+// `seconds` of music at 44.1 kHz with a beat at 0 and every 60 / bpm s.
+wav::Audio music(double bpm, double seconds) {
+  wav::Audio audio;
+  audio.rate = 44100;
+  const double beat = 60.0 / bpm;
+  for (long i = 0; i < (long)(seconds * audio.rate); ++i) {
+    const double t = (double)i / audio.rate;
+    const double kick = std::fmod(t, beat);
+    const double hat = std::fmod(t + beat / 2, beat);
+    double s = 0.6 * std::exp(-kick / 0.06) * std::sin(2 * kPi * (55 * kick + 1.2 * (1 - std::exp(-kick / 0.03))));
+    s += 0.15 * std::exp(-hat / 0.015) * noise();
+    s += 0.08 * std::sin(2 * kPi * 330 * t) + 0.02 * noise();
+    audio.samples.push_back((float)s);
+  }
+  return audio;
+}
+
+// Written to disk and read back, at the microphone rate.
+std::vector<float> throughWav(const wav::Audio& audio, const char* path) {
+  wav::Audio read;
+  CHECK(wav::write(path, audio));
+  CHECK(wav::read(path, read));
+  CHECK_EQ((long)read.rate, 44100L);
+  CHECK_EQ((long)read.samples.size(), (long)audio.samples.size());
+  return wav::resample(read, AUDIO_SAMPLE_RATE);
+}
+
+struct Hop {
+  unsigned long end;
+  uint8_t bass;
+};
+
+// Pushes the samples at their times from `start` on the virtual clock and
+// processes each hop once complete. With a gap, `gapMicros` of every
+// `gapEvery` µs are not sampled, as while show() keeps interrupts off.
+std::vector<Hop> feed(const std::vector<float>& mic, unsigned long start, unsigned long gapEvery = 0,
+                      unsigned long gapMicros = 0) {
+  std::vector<Hop> hops;
+  for (size_t i = 0; i < mic.size(); ++i) {
+    const unsigned long t = i * kSampleMicros;
+    if (gapEvery != 0 && t % gapEvery < gapMicros) continue;
+    host::setMicros(start + t);
+    audioPush(wav::toAdc(mic[i]));
+    while (audioProcess()) hops.push_back({ micros(), audioBandLevel(0) });
+  }
+  return hops;
+}
+
+// Distance of a phase (1/65536 beat) from the beat, in beats.
+double offBeat(uint16_t phase) {
+  return std::fabs((int16_t)phase / 65536.0);
+}
+
+// The frame whose render is in leds[] (the pattern repeats every
+// NUM_LEDS frames at scale 1); -1 if none. leds[] is left as it was.
+long shownFrame() {
+  CRGB shown[NUM_LEDS];
+  memcpy(shown, leds, sizeof(shown));
+  long found = -1;
+  for (long frame = 0; frame < NUM_LEDS && found < 0; ++frame) {
+    FillLEDsFromPaletteColors(frame, RESOLUTION, waveLengthScale);
+    if (!memcmp(shown, leds, sizeof(shown))) found = frame;
+  }
+  memcpy(leds, shown, sizeof(shown));
+  return found;
+}
+
+void checkFft() {
+  // A sine on bin 5 of amplitude 8000: |X5| = 8000 / 2, nothing elsewhere.
+  int16_t re[AUDIO_FFT_SIZE];
+  int16_t im[AUDIO_FFT_SIZE];
+  for (int n = 0; n < AUDIO_FFT_SIZE; ++n) {
+    re[n] = (int16_t)std::lround(8000 * std::sin(2 * kPi * 5 * n / AUDIO_FFT_SIZE));
+    im[n] = 0;
+  }
+  audioFft(re, im);
+  CHECK(std::abs(std::hypot(re[5], im[5]) - 4000) < 40);
+  for (int k = 0; k < AUDIO_FFT_SIZE; ++k) {
+    if (k != 5 && k != AUDIO_FFT_SIZE - 5) CHECK(std::hypot(re[k], im[k]) < 8);
+  }
+
+  // Noise against a floating-point DFT (scaled by 1/64 like the FFT).
+  int16_t input[AUDIO_FFT_SIZE];
+  for (int n = 0; n < AUDIO_FFT_SIZE; ++n) {
+    input[n] = (int16_t)(noise() * 16000);
+    re[n] = input[n];
+    im[n] = 0;
+  }
+  audioFft(re, im);
+  double worst = 0;
+  for (int k = 0; k < AUDIO_FFT_SIZE; ++k) {
+    double dr = 0, di = 0;
+    for (int n = 0; n < AUDIO_FFT_SIZE; ++n) {
+      dr += input[n] * std::cos(2 * kPi * k * n / AUDIO_FFT_SIZE) / AUDIO_FFT_SIZE;
+      di -= input[n] * std::sin(2 * kPi * k * n / AUDIO_FFT_SIZE) / AUDIO_FFT_SIZE;
+    }
+    worst = std::fmax(worst, std::hypot(re[k] - dr, im[k] - di));
+  }
+  CHECK(worst < 8);  // a few LSB of rounding per stage
+}
+
+}  // namespace
+
+int main() {
+  host::serialEcho(false);
+  checkFft();
+
+  // Tempo and phase at 120 BPM, and the bass level peaking on the kicks.
+  const std::vector<float> at120 = throughWav(music(120, 12), "audio_120bpm.wav");
+  audioSetup();
+  std::vector<Hop> hops = feed(at120, 1000000);
+  CHECK(std::abs((long)audioMilliBpm() - 120000) < 2400);
+  for (int beat = 20; beat < 24; ++beat) {
+    CHECK(offBeat(audioBeatPhase(1000000 + beat * 500000UL)) < 0.06);
+    CHECK(offBeat(audioBeatPhase(1000000 + beat * 500000UL + 250000)) > 0.44);
+  }
+  // Per beat after the first seconds: the loudest hop up to 50 ms after
+  // the kick, the loudest between 200 and 400 ms.
+  uint8_t kick[24] = {}, between[24] = {};
+  for (const Hop& hop : hops) {
+    const unsigned long beat = (hop.end - 1000000) / 500000;
+    const unsigned long sinceBeat = (hop.end - 1000000) % 500000;
+    if (beat < 6 || beat >= 24) continue;
+    if (sinceBeat < 50000) kick[beat] = std::max(kick[beat], hop.bass);
+    if (sinceBeat > 200000 && sinceBeat < 400000) between[beat] = std::max(between[beat], hop.bass);
+  }
+  for (int beat = 6; beat < 24; ++beat) {
+    CHECK(kick[beat] >= 200);
+    CHECK(between[beat] <= 100);
+  }
+  CHECK_EQ(audioDroppedHops(), 0);
+
+  // Silence: the beat is lost within a couple of seconds.
+  feed(std::vector<float>(3 * AUDIO_SAMPLE_RATE, 0.0f), 13000000);
+  CHECK_EQ(audioMilliBpm(), 0UL);
+
+  // Another tempo, from a fresh start.
+  audioSetup();
+  feed(throughWav(music(97, 12), "audio_97bpm.wav"), 20000000);
+  CHECK(std::abs((long)audioMilliBpm() - 97000) < 1940);
+
+  // Noise alone never gives a beat.
+  audioSetup();
+  wav::Audio hiss;
+  hiss.rate = 44100;
+  for (int i = 0; i < 10 * 44100; ++i) hiss.samples.push_back(0.3f * noise());
+  const std::vector<float> mic = wav::resample(hiss, AUDIO_SAMPLE_RATE);
+  bool tracked = false;
+  for (size_t i = 0; i < mic.size(); ++i) {
+    host::setMicros(40000000 + i * kSampleMicros);
+    audioPush(wav::toAdc(mic[i]));
+    while (audioProcess()) tracked = tracked || audioMilliBpm() != 0;
+  }
+  CHECK(!tracked);
+
+  // A third of the samples lost to 9 ms shows every 27 ms: the hops
+  // stretch and are timed as they come.
+  audioSetup();
+  feed(at120, 60000000, 27000, 9000);
+  CHECK(std::abs((long)audioMilliBpm() - 120000) < 3600);
+
+  // The ring holds three waiting hops; more drop the oldest.
+  audioSetup();
+  for (int i = 0; i < 5 * AUDIO_FFT_SIZE; ++i) audioPush(512);
+  CHECK_EQ(audioDroppedHops(), 2);
+  int processed = 0;
+  while (audioProcess()) ++processed;
+  CHECK_EQ(processed, 3);
+
+  // The sketch: 120 BPM music, sampled every 250 µs except while a 9 ms
+  // show() blocks. The wave follows at 120 / AUDIO_BEATS_PER_WAVE BPM
+  // and stays on the beat; the brightness follows the bass.
+  setup();
+  currentPalette = RainbowColors_p;
+  RebuildVirtualLeds(waveLengthScale, RESOLUTION);
+  FastLED.setShowMicros(9000);
+  const unsigned long start = micros();
+  const std::vector<float> song = throughWav(music(120, 20), "audio_120bpm_long.wav");
+  size_t next = 0;
+  int onBeat = 0;
+  uint8_t loudest = 0, quietest = 255;
+  while (next < song.size()) {
+    host::advanceMicros(1000);
+    for (; next < song.size() && start + next * kSampleMicros <= micros(); ++next) {
+      audioPush(wav::toAdc(song[next]));
+    }
+    const unsigned long loopStart = micros();
+    const unsigned long shows = FastLED.showCount();
+    loop();
+    while (next < song.size() && start + next * kSampleMicros <= micros()) ++next;  // missed while showing
+
+    const double seconds = (loopStart - start) / 1e6;
+    if (seconds < 14 || FastLED.showCount() == shows) continue;
+    const double musicPhase = std::fmod(seconds, 0.5) / 0.5;
+    const long frame = shownFrame();
+    CHECK(frame >= 0);
+    const double wavePhase = (double)(frame * AUDIO_BEATS_PER_WAVE % NUM_LEDS) / NUM_LEDS;
+    double error = std::fabs(wavePhase - musicPhase);
+    error = std::fmin(error, 1 - error);
+    CHECK(error < 0.12);
+    if (error < 0.12) ++onBeat;
+    if (musicPhase < 0.04) loudest = std::max(loudest, outputShowBrightness());
+    if (musicPhase > 0.4 && musicPhase < 0.8) quietest = std::min(quietest, outputShowBrightness());
+  }
+  CHECK(onBeat > 100);
+  const uint32_t expected = bpmToMilliBpm(120.0f / AUDIO_BEATS_PER_WAVE) * NUM_LEDS * RESOLUTION;
+  CHECK(frameTimer.rateDivisor > expected * 97 / 100 && frameTimer.rateDivisor < expected * 103 / 100);
+  CHECK(loudest >= 200);
+  CHECK(quietest <= 150);
+
+  return checkSummary();
+}
@@ -0,0 +1,230 @@
+// Effect engine: the registry, FillLEDsFromSection() against a per-pixel
+// reference of the fold / cut / reverse mapping on the main strip and any
+// EXTRA_LED_STRIPS, and the behaviour of each effect (reproducible output,
+// fire evolving, twinkles lit and dark, smooth noise). Built once per
+// configuration variant; the sketch's 'e' command is checked on top.
+
+#include <Arduino.h>
+#include <FastLED.h>
+#include "config.h"
+#include "animation.h"
+#include "effects.h"
+#include "strips.h"
+#include "check.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+void setup();
+void loop();
+extern CRGB leds[];
+
+namespace {
+
+bool referenceFolded() {
+  return !strcasecmp(ANIMATION_PARTS_TYPE, "FOLDED");
+}
+
+// Index in the independent section that a physical pixel shows.
+long referenceCanonical(const LedStrip& strip, long physicalIndex) {
+  const long folds = strip.parts < 1 ? 1 : strip.parts;
+  const long unique = (strip.length + folds - 1) / folds;
+  long logical = strip.reversed ? (strip.length - physicalIndex - 1) : physicalIndex;
+  long canonical = logical;
+  if (folds > 1) {
+    long section = logical / unique;
+    long offset = logical % unique;
+    canonical = (strip.folded && section % 2 == 1) ? unique - 1 - offset : offset;
+    if (strip.folded && !strip.reversed) canonical = unique - 1 - canonical;
+  }
+  return canonical;
+}
+
+std::vector<LedStrip> allStrips() {
+  const LedStrip mainStrip = { leds, NUM_LEDS, ANIMATION_PARTS, referenceFolded(), ANIMATION_REVERSED };
+  std::vector<LedStrip> strips(1, mainStrip);
+  strips.insert(strips.end(), gExtraStrips, gExtraStrips + gExtraStripCount);
+  return strips;
+}
+
+// Section renderer that writes each pixel's canonical index into it.
+void indexSection(CRGB* dst, int step, long count) {
+  for (long i = 0; i < count; ++i) {
+    *dst = CRGB((uint8_t)i, (uint8_t)(i >> 8), 0x5A);
+    dst += step;
+  }
+}
+
+// Every pixel of every strip equals canonical pixel `canonical` of the
+// rendered section, which sits at the same place as in indexSection.
+bool followsMapping(const std::vector<LedStrip>& strips, const std::vector<CRGB>& section) {
+  for (const LedStrip& strip : strips) {
+    for (long p = 0; p < strip.length; ++p) {
+      if (!(strip.leds[p] == section[referenceCanonical(strip, p)])) return false;
+    }
+  }
+  return true;
+}
+
+// Canonical section of the last frame, read back through the main strip.
+std::vector<CRGB> sectionOf(const LedStrip& mainStrip) {
+  std::vector<CRGB> section(SectionLedCount());
+  for (long p = 0; p < mainStrip.length; ++p) section[referenceCanonical(mainStrip, p)] = mainStrip.leds[p];
+  return section;
+}
+
+std::vector<CRGB> snapshot() {
+  return std::vector<CRGB>(leds, leds + NUM_LEDS);
+}
+
+bool isLit(const CRGB& c) {
+  return c.r || c.g || c.b;
+}
+
+uint8_t effectNamed(const char* name) {
+  for (uint8_t e = 0; e < effectCount(); ++e) {
+    if (!strcmp(effectName(e), name)) return e;
+  }
+  return 0xFF;
+}
+
+}  // namespace
+
+int main() {
+  host::serialEcho(false);
+  currentPalette = RainbowColors_p;
+  const std::vector<LedStrip> strips = allStrips();
+  const long sectionLeds = SectionLedCount();
+
+  // Registry.
+  CHECK_EQ(effectCount(), 4);
+  const uint8_t wave = effectNamed("wave");
+  const uint8_t noise = effectNamed("noise");
+  const uint8_t fire = effectNamed("fire");
+  const uint8_t twinkle = effectNamed("twinkle");
+  CHECK_EQ(wave, 0);
+  CHECK(noise != 0xFF && fire != 0xFF && twinkle != 0xFF);
+  CHECK_EQ(effectRamBytes(fire), sectionLeds);
+  CHECK_EQ(effectRamBytes(twinkle), 0);
+  CHECK(!effectSelect(effectCount(), 1.0f));
+  CHECK(!strcmp(effectName(effectCount()), ""));
+  CHECK_EQ(sectionLeds, stripSectionLength(NUM_LEDS, ANIMATION_PARTS));
+
+  // The section mapping.
+  FillLEDsFromSection(indexSection);
+  {
+    std::vector<CRGB> expected(sectionLeds);
+    for (long i = 0; i < sectionLeds; ++i) expected[i] = CRGB((uint8_t)i, (uint8_t)(i >> 8), 0x5A);
+    CHECK(followsMapping(strips, expected));
+  }
+
+  // The wave through the engine is FillLEDsFromPaletteColors().
+  CHECK(effectSelect(wave, 1.0f));
+  RebuildVirtualLeds(1.0f, 2);
+  effectRender(77, 2, 1.0f);
+  std::vector<CRGB> viaEngine = snapshot();
+  FillLEDsFromPaletteColors(77, 2, 1.0f);
+  CHECK(viaEngine == snapshot());
+  CHECK(effectRenderKey(77, 2, 1.0f) == FrameRenderKey(77, 2, 1.0f));
+
+  // Every effect: reproducible, mapped like the wave, keyed per effect.
+  const int resolutions[] = { 1, 4 };
+  for (uint8_t e = 1; e < effectCount(); ++e) {
+    for (int res : resolutions) {
+      std::vector<std::vector<CRGB>> first;
+      for (int pass = 0; pass < 2; ++pass) {
+        CHECK(effectSelect(e, 1.0f));
+        CHECK_EQ(effectIndex(), e);
+        for (long frame = 0; frame < 64; ++frame) {
+          effectRender(frame, res, 1.0f);
+          CHECK(followsMapping(strips, sectionOf(strips[0])));
+          if (pass == 0) first.push_back(snapshot());
+          else CHECK(first[frame] == snapshot());
+        }
+      }
+      CHECK(!(effectRenderKey(0, res, 1.0f) == effectRenderKey(res * 8L, res, 1.0f)));
+      CHECK(!(effectRenderKey(5, res, 1.0f) == FrameRenderKey(5, res, 1.0f)));
+    }
+    CHECK(effectFrameMicros(e) < 0xFFFF);
+  }
+
+  // Fire: starts dark, heats up and keeps moving; steps once per RESOLUTION
+  // frames, so the frames of a step render alike.
+  CHECK(effectSelect(fire, 1.0f));
+  std::vector<CRGB> previous = snapshot();
+  long changes = 0;
+  long lit = 0;
+  for (long frame = 0; frame < 200; ++frame) {
+    effectRender(frame, 1, 1.0f);
+    if (!(snapshot() == previous)) ++changes;
+    for (long p = 0; p < NUM_LEDS; ++p) lit += isLit(leds[p]) ? 1 : 0;
+    previous = snapshot();
+  }
+  CHECK(changes > 100);
+  CHECK(lit > 0);
+  CHECK(effectRenderKey(8, 4, 1.0f) == effectRenderKey(11, 4, 1.0f));
+  CHECK(!(effectRenderKey(11, 4, 1.0f) == effectRenderKey(12, 4, 1.0f)));
+
+  // Twinkle: over time some pixels light up while others are dark.
+  CHECK(effectSelect(twinkle, 1.0f));
+  long dark = 0;
+  lit = 0;
+  for (long frame = 0; frame < 256; frame += 8) {
+    effectRender(frame, 1, 1.0f);
+    for (long i = 0; i < sectionLeds; ++i) {
+      if (isLit(sectionOf(strips[0])[i])) ++lit;
+      else ++dark;
+    }
+  }
+  CHECK(lit > 0);
+  CHECK(dark > 0);
+
+  // Noise: neighbouring pixels and frames differ by small steps only.
+  CHECK(effectSelect(noise, 1.0f));
+  if (sectionLeds >= 100) {
+    effectRender(1000, 1, 1.0f);
+    std::vector<CRGB> now = sectionOf(strips[0]);
+    effectRender(1001, 1, 1.0f);
+    std::vector<CRGB> next = sectionOf(strips[0]);
+    int maxNeighbour = 0;
+    int maxTime = 0;
+    bool varies = false;
+    for (long i = 0; i < sectionLeds; ++i) {
+      for (int c = 0; c < 3; ++c) {
+        if (i > 0) maxNeighbour = std::max(maxNeighbour, std::abs(now[i].raw[c] - now[i - 1].raw[c]));
+        maxTime = std::max(maxTime, std::abs(now[i].raw[c] - next[i].raw[c]));
+      }
+      varies = varies || !(now[i] == now[0]);
+    }
+    CHECK(varies);
+    CHECK(maxNeighbour < 64);
+    CHECK(maxTime < 48);
+
+    // Also where the 16-bit noise time wraps (4 per frame): the last row
+    // blends into the first.
+    effectRender(16383, 1, 1.0f);
+    now = sectionOf(strips[0]);
+    effectRender(16384, 1, 1.0f);
+    next = sectionOf(strips[0]);
+    maxTime = 0;
+    for (long i = 0; i < sectionLeds; ++i) {
+      for (int c = 0; c < 3; ++c) maxTime = std::max(maxTime, std::abs(now[i].raw[c] - next[i].raw[c]));
+    }
+    CHECK(maxTime < 48);
+  }
+  CHECK(effectSelect(wave, 1.0f));
+
+  // The sketch: 'e' steps through the effects and wraps around.
+  setup();
+  CHECK_EQ(effectIndex(), EFFECT_INDEX);
+  for (uint8_t e = 1; e <= effectCount(); ++e) {
+    const uint8_t command = 'e';
+    host::serialFeed(&command, 1);
+    host::advanceMicros(1000);
+    loop();
+    CHECK_EQ(effectIndex(), e % effectCount());
+  }
+
+  return checkSummary();
+}
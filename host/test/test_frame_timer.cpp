@@ -0,0 +1,86 @@
+// Frame timer: exact frame counts (no drift) for any BPM, sub-millisecond
+// periods, and phase continuity across rate changes.
+
+#include <Arduino.h>
+#include "config.h"
+#include "frame_timer.h"
+#include "check.h"
+
+#include <cstdint>
+
+namespace {
+
+// Frames that must have elapsed after `us` microseconds at a fixed rate.
+uint64_t expectedFrames(uint64_t us, float bpm, int resolution) {
+  uint64_t divisor = (uint64_t)bpmToMilliBpm(bpm) * NUM_LEDS * resolution;
+  return us * divisor / 60000000000ULL;
+}
+
+void checkNoDrift(float bpm, int resolution, unsigned long step) {
+  FrameTimer timer;
+  const unsigned long start = 1000;
+  frameTimerStart(timer, bpm, resolution, start);
+  uint64_t frames = 0;
+  const uint64_t duration = 600ULL * 1000000ULL;  // ten minutes of wall time
+  for (uint64_t t = step; t < duration; t += step) {
+    frames += frameTimerAdvance(timer, start + t);
+  }
+  frames += frameTimerAdvance(timer, start + duration);
+  // The first boundary is one period after start, so frame k is due at k * period.
+  CHECK_EQ(frames, expectedFrames(duration, bpm, resolution));
+}
+
+}  // namespace
+
+int main() {
+  // Whole-run frame counts match the exact rational rate across the knob range.
+  const float bpms[] = { BPM_MIN, 0.37f, 1.0f, 5.0f, 12.345f, BPM_MAX };
+  const int resolutions[] = { 1, 3, 8 };
+  for (float bpm : bpms) {
+    for (int res : resolutions) {
+      checkNoDrift(bpm, res, 997);
+    }
+  }
+
+  // Periods below one millisecond are kept, not clamped.
+  {
+    FrameTimer timer;
+    frameTimerStart(timer, BPM_MAX, 8, 0);
+    CHECK(timer.periodMicros < 1000);
+    CHECK_EQ(frameTimerAdvance(timer, 1000000), (long)expectedFrames(1000000, BPM_MAX, 8));
+  }
+
+  // Nothing is due before the first period has passed.
+  {
+    FrameTimer timer;
+    frameTimerStart(timer, 5.0f, 1, 0);
+    CHECK_EQ(frameTimerAdvance(timer, timer.periodMicros - 1), 0);
+    CHECK_EQ(frameTimerAdvance(timer, timer.periodMicros), 1);
+  }
+
+  // A rate change keeps the fraction of the frame already elapsed: halfway
+  // through a frame at 5 BPM, doubling the BPM leaves half of the new period.
+  {
+    FrameTimer timer;
+    frameTimerStart(timer, 5.0f, 1, 0);
+    const unsigned long oldPeriod = timer.periodMicros;
+    const unsigned long half = oldPeriod / 2;
+    CHECK_EQ(frameTimerAdvance(timer, half), 0);
+    frameTimerSetRate(timer, 10.0f, 1, half);
+    const unsigned long newPeriod = timer.periodMicros;
+    CHECK(newPeriod * 2 <= oldPeriod + 1 && newPeriod * 2 + 1 >= oldPeriod);
+    CHECK_EQ(frameTimerAdvance(timer, half + newPeriod / 2 - 2), 0);
+    CHECK_EQ(frameTimerAdvance(timer, half + newPeriod / 2 + 2), 1);
+  }
+
+  // Zero BPM stops the clock; resuming starts a fresh period.
+  {
+    FrameTimer timer;
+    frameTimerStart(timer, 0.0f, 1, 0);
+    CHECK_EQ(frameTimerAdvance(timer, 100000000), 0);
+    frameTimerSetRate(timer, 5.0f, 1, 100000000);
+    CHECK_EQ(frameTimerAdvance(timer, 100000000 + timer.periodMicros), 1);
+  }
+
+  return checkSummary();
+}
@@ -0,0 +1,300 @@
+// Golden-frame regression and render timing for one configuration variant.
+//
+// Renders a fixed sequence of frames through FillLEDsFromPaletteColors()
+// for a set of palettes, WAVE_LENGTH_SCALEs and RESOLUTIONs and hashes the
+// main strip and any EXTRA_LED_STRIPS (FNV-1a). The hashes are compared
+// with test/golden/<variant>.txt, so any change to the section mapping,
+// fold / cut / reverse handling or interpolation shows up as a mismatch
+// even where the reference in test_render_mapping would change with it.
+//
+// The timing check measures the render cost relative to a naive per-pixel
+// renderer built into this file, interleaved in the same process so machine
+// speed and load mostly cancel out, and fails when the ratio grows by more
+// than the tolerance over the recorded one.
+//
+//   test_golden_<variant> --frames FILE      compare frame hashes
+//   test_golden_<variant> --timing FILE      compare relative render cost
+//   test_golden_<variant> --update FILE      rewrite FILE from this build
+//   [--tolerance X]                          timing slack factor (default 1.5)
+//   [--no-timing]                            --update: frame hashes only
+//
+// After an intended output or performance change, regenerate all files with
+// `cmake --build <build> --target golden-update` and commit them.
+
+#include <Arduino.h>
+#include <FastLED.h>
+#include "config.h"
+#include "animation.h"
+#include "strips.h"
+#include "check.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct FrameCase {
+  int palette;
+  float scale;
+  int resolution;
+};
+
+struct TimingCase {
+  float scale;
+  int resolution;
+};
+
+const TimingCase kTimingCases[] = { { 1.0f, 1 }, { 1.0f, 4 }, { 4.0f, 1 } };
+
+// The yardstick below reads the palette expanded to 256 entries.
+CRGBPalette256 gReferencePalette;
+
+void selectPalette(int palette) {
+  currentPalette = palette == 0 ? CRGBPalette16(RainbowColors_p) : CRGBPalette16(PartyColors_p);
+  gReferencePalette = currentPalette;
+}
+
+std::vector<FrameCase> frameCases() {
+  const float scales[] = { 0.01f, 0.25f, 1.0f, 1.3f, WAVE_LENGTH_SCALE_MAX };
+  const int resolutions[] = { 1, 2, 3, 8 };
+  std::vector<FrameCase> cases;
+  for (int palette = 0; palette < 2; ++palette) {
+    for (float scale : scales) {
+      for (int res : resolutions) cases.push_back({ palette, scale, res });
+    }
+  }
+  return cases;
+}
+
+uint32_t fnv1a(uint32_t hash, const void* data, size_t len) {
+  const uint8_t* bytes = (const uint8_t*)data;
+  for (size_t i = 0; i < len; ++i) {
+    hash = (hash ^ bytes[i]) * 16777619u;
+  }
+  return hash;
+}
+
+// Hash of every frame in the sequence: frames around the resolution step and
+// the pattern wrap, a far-away frame and a run of consecutive ones.
+uint32_t renderCase(const FrameCase& c) {
+  selectPalette(c.palette);
+  RebuildVirtualLeds(c.scale, c.resolution);
+  const long res = c.resolution;
+  const long span = gVirtualLedCount * res;
+  std::vector<long> frames = { 0, 1, 2, res - 1, res, span - 1, span, span + 1, 12345L * res + 1 };
+  for (long f = 100 * res; f < 100 * res + 16; ++f) frames.push_back(f);
+
+  uint32_t hash = 2166136261u;
+  for (long frame : frames) {
+    FillLEDsFromPaletteColors(frame, c.resolution, c.scale);
+    hash = fnv1a(hash, leds, sizeof(CRGB) * NUM_LEDS);
+    for (uint8_t s = 0; s < gExtraStripCount; ++s) {
+      hash = fnv1a(hash, gExtraStrips[s].leds, sizeof(CRGB) * gExtraStrips[s].length);
+    }
+  }
+  return hash;
+}
+
+// The cost yardstick: every pixel of the strip computed on its own from the
+// palette, with the divisions and the blend of the original renderer.
+CRGB gReferenceLeds[NUM_LEDS];
+
+void referenceFrame(long frame, int resolution, long count) {
+  long base = (frame / resolution) % count;
+  uint8_t blendFactor = (uint8_t)((255L * (frame % resolution)) / resolution);
+  for (int i = 0; i < NUM_LEDS; ++i) {
+    long index = (base + i) % count;
+    CRGB a = gReferencePalette[(uint8_t)((index * 256L) / count)];
+    CRGB b = gReferencePalette[(uint8_t)((((index + 1) % count) * 256L) / count)];
+    gReferenceLeds[i] = blend(a, b, blendFactor);
+  }
+}
+
+double elapsedNs(Clock::time_point start) {
+  return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+}
+
+struct TimingResult {
+  double renderNs;     // per frame
+  double referenceNs;  // per frame
+  double ratio() const { return renderNs / referenceNs; }
+};
+
+// Best of many short interleaved rounds of both renderers, which filters
+// out preemption and frequency ramps.
+TimingResult timeCase(const TimingCase& c) {
+  selectPalette(0);
+  RebuildVirtualLeds(c.scale, c.resolution);
+  const long count = gVirtualLedCount;
+
+  long batch = 1;
+  for (;;) {
+    auto start = Clock::now();
+    for (long f = 0; f < batch; ++f) referenceFrame(f, c.resolution, count);
+    if (elapsedNs(start) > 50e3 || batch >= (1L << 20)) break;
+    batch *= 2;
+  }
+
+  TimingResult best = { 1e30, 1e30 };
+  long frame = 0;
+  for (int round = 0; round < 64; ++round) {
+    auto start = Clock::now();
+    for (long f = 0; f < batch; ++f) FillLEDsFromPaletteColors(frame + f, c.resolution, c.scale);
+    best.renderNs = std::min(best.renderNs, elapsedNs(start) / batch);
+    start = Clock::now();
+    for (long f = 0; f < batch; ++f) referenceFrame(frame + f, c.resolution, count);
+    best.referenceNs = std::min(best.referenceNs, elapsedNs(start) / batch);
+    frame += batch;
+  }
+  return best;
+}
+
+// The value recorded by --update: the median of several measurements, so
+// neither a slow nor an unusually fast stretch ends up in the golden file.
+TimingResult recordCase(const TimingCase& c) {
+  std::vector<TimingResult> results;
+  for (int i = 0; i < 7; ++i) results.push_back(timeCase(c));
+  std::sort(results.begin(), results.end(),
+            [](const TimingResult& a, const TimingResult& b) { return a.ratio() < b.ratio(); });
+  return results[results.size() / 2];
+}
+
+// On a shared or virtual machine the render occasionally runs at half speed
+// for tens of milliseconds while the reference does not, so a case is
+// measured again a little later (up to `attempts` times) until its ratio is
+// within `budget`; the lowest ratio seen is returned. A real regression
+// stays over budget every time.
+TimingResult measureCase(const TimingCase& c, int attempts, double budget) {
+  TimingResult best = timeCase(c);
+  for (int i = 1; i < attempts && best.ratio() > budget; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20 * i));
+    TimingResult t = timeCase(c);
+    if (t.ratio() < best.ratio()) best = t;
+  }
+  return best;
+}
+
+struct Golden {
+  std::vector<uint32_t> hashes;  // in frameCases() order
+  std::vector<double> ratios;    // in kTimingCases order
+};
+
+bool readGolden(const char* path, Golden& golden) {
+  FILE* file = fopen(path, "r");
+  if (!file) {
+    fprintf(stderr, "%s: cannot open (run the golden-update target to create it)\n", path);
+    return false;
+  }
+  char line[256];
+  while (fgets(line, sizeof(line), file)) {
+    unsigned hash;
+    double ratio;
+    float scale;
+    int palette, res;
+    if (sscanf(line, "frames %d %f %d %x", &palette, &scale, &res, &hash) == 4) {
+      golden.hashes.push_back(hash);
+    } else if (sscanf(line, "timing %f %d %lf", &scale, &res, &ratio) == 3) {
+      golden.ratios.push_back(ratio);
+    }
+  }
+  fclose(file);
+  return true;
+}
+
+int update(const char* path, bool timing) {
+  FILE* file = fopen(path, "w");
+  if (!file) {
+    fprintf(stderr, "%s: cannot write\n", path);
+    return 1;
+  }
+  fprintf(file, "# Golden frames and render cost for this configuration (see test/test_golden.cpp).\n");
+  fprintf(file, "# frames <palette> <scale> <resolution> <FNV-1a of the frame sequence>\n");
+  for (const FrameCase& c : frameCases()) {
+    fprintf(file, "frames %d %.2f %d %08x\n", c.palette, c.scale, c.resolution, renderCase(c));
+  }
+  if (timing) {
+    fprintf(file, "# timing <scale> <resolution> <render / reference cost>  (ns per frame when recorded)\n");
+    for (const TimingCase& c : kTimingCases) {
+      TimingResult t = recordCase(c);
+      fprintf(file, "timing %.2f %d %.3f  # %.0f / %.0f ns\n", c.scale, c.resolution,
+              t.ratio(), t.renderNs, t.referenceNs);
+    }
+  }
+  fclose(file);
+  printf("wrote %s\n", path);
+  return 0;
+}
+
+int checkFrames(const Golden& golden) {
+  const std::vector<FrameCase> cases = frameCases();
+  CHECK_EQ(golden.hashes.size(), cases.size());
+  for (size_t i = 0; i < cases.size() && i < golden.hashes.size(); ++i) {
+    uint32_t hash = renderCase(cases[i]);
+    if (hash != golden.hashes[i]) {
+      fprintf(stderr, "palette %d scale %.2f res %d: frames hash %08x, golden %08x\n",
+              cases[i].palette, cases[i].scale, cases[i].resolution, hash, golden.hashes[i]);
+      CHECK(hash == golden.hashes[i]);
+    }
+  }
+  return checkSummary();
+}
+
+int checkTiming(const Golden& golden, double tolerance) {
+  const size_t count = sizeof(kTimingCases) / sizeof(kTimingCases[0]);
+  CHECK_EQ(golden.ratios.size(), count);
+  for (size_t i = 0; i < count && i < golden.ratios.size(); ++i) {
+    const TimingCase& c = kTimingCases[i];
+    TimingResult t = measureCase(c, 8, golden.ratios[i] * tolerance);
+    double ratio = t.ratio();
+    printf("scale %.2f res %d: %.0f / %.0f ns per frame, %.3f of reference (golden %.3f)\n",
+           c.scale, c.resolution, t.renderNs, t.referenceNs, ratio, golden.ratios[i]);
+    if (ratio > golden.ratios[i] * tolerance) {
+      fprintf(stderr, "scale %.2f res %d: render cost %.3f of reference exceeds golden %.3f x %.2f\n",
+              c.scale, c.resolution, ratio, golden.ratios[i], tolerance);
+      CHECK(ratio <= golden.ratios[i] * tolerance);
+    }
+  }
+  return checkSummary();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const char* mode = nullptr;
+  const char* path = nullptr;
+  double tolerance = 1.5;
+  bool timing = true;
+  for (int i = 1; i < argc; ++i) {
+    if ((!strcmp(argv[i], "--frames") || !strcmp(argv[i], "--timing") || !strcmp(argv[i], "--update")) && i + 1 < argc) {
+      mode = argv[i];
+      path = argv[++i];
+    } else if (!strcmp(argv[i], "--no-timing")) {
+      timing = false;
+    } else if (!strcmp(argv[i], "--tolerance") && i + 1 < argc) {
+      tolerance = atof(argv[++i]);
+    } else {
+      mode = nullptr;
+      break;
+    }
+  }
+  if (!mode || tolerance < 1.0) {
+    fprintf(stderr, "usage: %s --frames|--timing|--update FILE [--tolerance X] [--no-timing]\n", argv[0]);
+    return 2;
+  }
+
+  host::serialEcho(false);
+  if (!strcmp(mode, "--update")) {
+    return update(path, timing);
+  }
+  Golden golden;
+  if (!readGolden(path, golden)) {
+    return 1;
+  }
+  return !strcmp(mode, "--frames") ? checkFrames(golden) : checkTiming(golden, tolerance);
+}
@@ -0,0 +1,141 @@
+// High-precision output (RENDER_HIGH_PRECISION): the level table follows
+// the gamma curve and the brightness, the dithered output averages to the
+// 16-bit target over 256 frames (interpolated frames included), uploads
+// are widened to 16 bits, and the sketch shows at full FastLED brightness
+// with the brightness applied in the render.
+
+#include <Arduino.h>
+#include <FastLED.h>
+#include "config.h"
+#include "animation.h"
+#include "output.h"
+#include "check.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+void setup();
+void loop();
+extern CRGB leds[];
+
+namespace {
+
+// The exact 8.8 output level for a linear 16-bit value.
+double idealLevel(double linear, uint8_t brightness) {
+  if (brightness == 0) return 0.0;
+  return pow(linear / 65536.0, RENDER_GAMMA) * 65280.0 * (brightness + 1) / 256.0;
+}
+
+// Allowed deviation of the level table and of the dithered average from the
+// ideal level: a quarter of an 8-bit step.
+const double kTolerance = 64.0;
+
+double channel(const CRGB16& c, int ch) {
+  return ch == 0 ? c.r : ch == 1 ? c.g : c.b;
+}
+
+}  // namespace
+
+int main() {
+  host::serialEcho(false);
+
+  // Level table: endpoints, monotonic, close to the curve at any brightness.
+  const uint8_t brightnesses[] = { 255, 128, 24, 3 };
+  for (uint8_t b : brightnesses) {
+    SetRenderBrightness(b);
+    CHECK_EQ(RenderLevel(0), 0);
+    uint16_t previous = 0;
+    double worst = 0.0;
+    for (long linear = 0; linear <= 65535; linear += 37) {
+      uint16_t level = RenderLevel((uint16_t)linear);
+      CHECK(level >= previous);
+      previous = level;
+      worst = std::max(worst, fabs(level - idealLevel((double)linear, b)));
+    }
+    CHECK(worst <= kTolerance);
+    CHECK(RenderLevel(65535) <= 65280);
+  }
+  SetRenderBrightness(0);
+  CHECK_EQ(RenderLevel(65535), 0);
+
+  // Dithered average: 256 renders of the same frame sum to the level of
+  // each pixel's 16-bit (interpolated) colour. A gradient palette at low
+  // brightness, where 8 bits band the most.
+  for (int i = 0; i < 16; ++i) {
+    currentPalette.entries[i] = CRGB((uint8_t)(i * 17), (uint8_t)(255 - i * 17), (uint8_t)(i * 17 / 3));
+  }
+  const float scale = 2.0f;
+  RebuildVirtualLeds(scale, 1);
+  const long patternLen = gVirtualLedCount;
+  CHECK(patternLen > 256);  // finer than the palette: 16-bit gradations
+
+  const int resolutions[] = { 1, 4 };
+  const uint8_t dim[] = { 20, 200 };
+  for (int res : resolutions) {
+    for (uint8_t b : dim) {
+      SetRenderBrightness(b);
+      const long colorShift = 4L * 37 + (res > 1 ? 1 : 0);
+      RenderKey key = FrameRenderKey(colorShift, res, scale);
+      static long sums[NUM_LEDS][3];
+      memset(sums, 0, sizeof(sums));
+      for (int frame = 0; frame < 256; ++frame) {
+        FillLEDsFromPaletteColors(colorShift, res, scale);
+        for (int k = 0; k < NUM_LEDS; ++k) {
+          sums[k][0] += leds[k].r;
+          sums[k][1] += leds[k].g;
+          sums[k][2] += leds[k].b;
+        }
+      }
+      double worst = 0.0;
+      bool dithered = false;
+      for (int k = 0; k < NUM_LEDS; ++k) {
+        const CRGB16& a = gVirtualLeds[(key.baseShift + k) % patternLen];
+        const CRGB16& n = gVirtualLeds[(key.baseShift + k + 1) % patternLen];
+        for (int ch = 0; ch < 3; ++ch) {
+          double linear = channel(a, ch) + (channel(n, ch) - channel(a, ch)) * key.blendFactor / 256.0;
+          worst = std::max(worst, fabs(sums[k][ch] - idealLevel(linear, b)));
+          dithered = dithered || sums[k][ch] % 256 != 0;
+        }
+      }
+      CHECK(worst <= kTolerance);
+      CHECK(dithered);
+    }
+  }
+
+  // Uploaded 8-bit pixels are widened to 16 bits.
+  CRGB* upload = BeginVirtualLedsUpload(3);
+  CHECK(upload != nullptr);
+  upload[0] = CRGB(1, 2, 3);
+  upload[1] = CRGB(4, 5, 6);
+  upload[2] = CRGB(255, 0, 128);
+  CHECK(CommitVirtualLedsUpload());
+  FillLEDsFromPaletteColors(0, 1, scale);
+  CHECK_EQ(gVirtualLedCount, 3);
+  CHECK_EQ(gVirtualLeds[0].r, 257);
+  CHECK_EQ(gVirtualLeds[0].b, 771);
+  CHECK_EQ(gVirtualLeds[1].g, 5 * 257);
+  CHECK_EQ(gVirtualLeds[2].r, 65535);
+  CHECK_EQ(gVirtualLeds[2].g, 0);
+  CHECK_EQ(gVirtualLeds[2].b, 128 * 257);
+
+  // In the sketch, FastLED shows at full brightness and a brightness change
+  // re-renders the frame with the new levels.
+  setup();
+  for (int i = 0; i < 100; ++i) {
+    host::advanceMicros(1000);
+    loop();
+  }
+  CHECK_EQ(FastLED.getBrightness(), 255);
+  outputSetBrightness(10);
+  host::advanceMicros(OUTPUT_MAX_LATENCY_MS * 1000UL);
+  loop();
+  CHECK_EQ(FastLED.getBrightness(), 255);
+  int brightest = 0;
+  for (int k = 0; k < NUM_LEDS; ++k) {
+    brightest = std::max(brightest, (int)std::max(leds[k].r, std::max(leds[k].g, leds[k].b)));
+  }
+  CHECK(brightest > 0 && brightest <= 11);
+
+  return checkSummary();
+}
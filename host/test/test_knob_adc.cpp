@@ -0,0 +1,110 @@
+// Knob pipeline: fixed-point mapping against the float original, the
+// oversampling / EMA filter, channel rotation, and the sketch's knobs
+// driven through it.
+
+#include <Arduino.h>
+#include <FastLED.h>
+#include "config.h"
+#include "animation.h"
+#include "knob.h"
+#include "knob_adc.h"
+#include "ram_plan.h"
+#include "check.h"
+
+#include <cmath>
+
+void setup();
+void loop();
+extern int brightness;
+extern float bpm;
+extern float waveLengthScale;
+
+namespace {
+
+// Polls until every knob has taken `blocks` more readings.
+void pollBlocks(int blocks) {
+  for (int i = 0; i < blocks * KNOB_ADC_OVERSAMPLE * 3; ++i) knobAdcPoll();
+}
+
+void runLoops(int loops) {
+  for (int i = 0; i < loops; ++i) {
+    host::advanceMicros(1000);
+    loop();
+  }
+}
+
+}  // namespace
+
+int main() {
+  host::serialEcho(false);
+
+  // Fixed-point mapping: endpoints exact, integers within one step of the
+  // float version, floats within rounding.
+  CHECK_EQ(mapKnobReading<int>(0, 0, 255), 0);
+  CHECK_EQ(mapKnobReading<int>(1023 << 6, 0, 255), 255);
+  CHECK_EQ(mapKnobReading<int>(0xFFFF, 0, 255), 255);
+  CHECK_EQ(mapKnobReading<int>(100 << 6, 0, 255, 200, 900), 0);
+  for (int raw = 0; raw <= 1023; ++raw) {
+    host::setAnalog(A5, raw);
+    int fixedValue = calculateKnobValueForPinFixed<int>(A5, 0, 255);
+    int floatValue = calculateKnobValueForPin<int>(A5, 0, 255);
+    CHECK(abs(fixedValue - floatValue) <= 1);
+    float fixedBpm = calculateKnobValueForPinFixed<float>(A5, 0.01f, 35.0f);
+    float floatBpm = calculateKnobValueForPin<float>(A5, 0.01f, 35.0f);
+    CHECK(std::fabs(fixedBpm - floatBpm) < 1e-3f);
+  }
+
+  // The sketch registers its three knobs in setup().
+  host::setAnalog(A0, 512);
+  host::setAnalog(A1, 0);
+  host::setAnalog(A2, 1023);
+  setup();
+  CHECK(!knobAdcReady(0));
+  pollBlocks(1);
+  CHECK(knobAdcReady(0) && knobAdcReady(1) && knobAdcReady(2));
+
+  // The first block sets the value directly; each channel reads its pin.
+  CHECK_EQ(knobAdcRead(0), 512 << 6);
+  CHECK_EQ(knobAdcRead(1), 0);
+  CHECK_EQ(knobAdcRead(2), 1023 << 6);
+
+  // A step moves 1 / 2^KNOB_ADC_EMA_SHIFT of the way per block.
+  host::setAnalog(A0, 768);
+  pollBlocks(1);
+  CHECK_EQ(knobAdcRead(0), (512 << 6) + ((256 << 6) >> KNOB_ADC_EMA_SHIFT));
+  pollBlocks(40);
+  CHECK(std::abs((int)knobAdcRead(0) - (768 << 6)) < (1 << KNOB_ADC_EMA_SHIFT));
+
+  // Sample noise of +/-8 steps averages out within the oversampled block.
+  for (int i = 0; i < KNOB_ADC_OVERSAMPLE * 3 * 20; ++i) {
+    host::setAnalog(A0, (i % 2) ? 760 : 776);
+    knobAdcPoll();
+  }
+  CHECK(std::abs((int)(knobAdcRead(0) >> KNOB_ADC_FRACTION_BITS) - 768) <= 1);
+
+  // End to end: the knobs drive brightness, BPM and wave length scale.
+  host::setAnalog(A0, 1023);
+  host::setAnalog(A1, 1023);
+  host::setAnalog(A2, 0);
+  // The sketch's change thresholds still apply on top of the filter.
+  runLoops(2000);
+  CHECK(BRIGHTNESS_MAX - brightness <= BRIGHTNESS_CHANGE_THRESHOLD);
+  CHECK(std::fabs(bpm - (float)BPM_MAX) <= (float)BPM_CHANGE_THRESHOLD);
+  CHECK(std::fabs(waveLengthScale - (float)WAVE_LENGTH_SCALE_MIN) <= (float)WAVE_LENGTH_SCALE_CHANGE_THRESHOLD);
+  runLoops(100);
+  CHECK_EQ(FastLED.getBrightness(), brightness);
+
+  // The wave length knob spans the scales whose pattern fits: halfway is
+  // halfway there, and the end of its travel is the longest wave.
+  host::setAnalog(A2, 512);
+  runLoops(2000);
+  CHECK(std::fabs(waveLengthScale - (float)(WAVE_LENGTH_SCALE_MIN + kPlanWaveLengthScaleMax) / 2) <=
+        (float)WAVE_LENGTH_SCALE_CHANGE_THRESHOLD);
+  CHECK(gVirtualLedCount < kPlanPatternPixels);
+  host::setAnalog(A2, 1023);
+  runLoops(2000);
+  CHECK(std::fabs(waveLengthScale - kPlanWaveLengthScaleMax) <= (float)WAVE_LENGTH_SCALE_CHANGE_THRESHOLD);
+  CHECK(kPlanWaveLengthScaleMax < (float)WAVE_LENGTH_SCALE_MAX);  // capped by VIRTUAL_LEDS_MAX in this build
+
+  return checkSummary();
+}
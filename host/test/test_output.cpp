@@ -0,0 +1,111 @@
+// Frame-coalescing output stage: at most one show per update, brightness
+// changes merged into frames, nothing shown when nothing visible changed,
+// and the sketch itself showing once per frame.
+
+#include <Arduino.h>
+#include <FastLED.h>
+#include "config.h"
+#include "animation.h"
+#include "output.h"
+#include "check.h"
+
+void setup();
+void loop();
+
+namespace {
+
+int renders = 0;
+
+void countRender() {
+  ++renders;
+}
+
+RenderKey key(long baseShift) {
+  RenderKey k = { 0, 100, baseShift, 0 };
+  return k;
+}
+
+}  // namespace
+
+int main() {
+  host::serialEcho(false);
+  unsigned long now = 1000000;
+  const unsigned long latency = OUTPUT_MAX_LATENCY_MS * 1000UL;
+
+  // The first update renders and shows the initial frame.
+  outputSetup(countRender, 100);
+  unsigned long shows = FastLED.showCount();
+  CHECK(outputUpdate(now));
+  CHECK_EQ(renders, 1);
+  CHECK_EQ(FastLED.showCount(), shows + 1);
+  CHECK(!outputUpdate(now));  // nothing dirty
+
+  // Frame, pattern and brightness changes within one loop: one show.
+  outputMarkFrame(key(1));
+  outputMarkDirty(OUTPUT_DIRTY_PATTERN);
+  outputSetBrightness(120);
+  CHECK(outputUpdate(now += 1000));
+  CHECK_EQ(renders, 2);
+  CHECK_EQ(FastLED.getBrightness(), 120);
+  CHECK_EQ(outputStats().shows, 2);
+  CHECK_EQ(outputStats().coalesced, 2);
+
+  // A frame identical to the last one is not shown.
+  outputMarkFrame(key(1));
+  CHECK(!outputUpdate(now += 1000));
+  CHECK_EQ(outputStats().skipped, 1);
+
+  // Brightness alone waits for the next frame...
+  outputSetBrightness(130);
+  CHECK(!outputUpdate(now += 1000));
+  outputMarkFrame(key(2));
+  CHECK(outputUpdate(now += 1000));
+  CHECK_EQ(renders, 3);
+  CHECK_EQ(FastLED.getBrightness(), 130);
+
+  // ...but no longer than OUTPUT_MAX_LATENCY_MS, and without a render.
+  outputSetBrightness(140);
+  CHECK(!outputUpdate(now + latency - 1));
+  CHECK(outputUpdate(now += latency));
+  CHECK_EQ(renders, 3);
+  CHECK_EQ(FastLED.getBrightness(), 140);
+
+  // Setting the same brightness again is not a change.
+  outputSetBrightness(140);
+  CHECK(!outputUpdate(now += latency));
+
+  // Going dark shows one black frame, then nothing until brightness returns.
+  outputSetBrightness(0);
+  CHECK(outputUpdate(now += latency));
+  shows = FastLED.showCount();
+  const unsigned long skipped = outputStats().skipped;
+  for (long frame = 3; frame < 13; ++frame) {
+    outputMarkFrame(key(frame));
+    CHECK(!outputUpdate(now += 1000));
+  }
+  CHECK_EQ(FastLED.showCount(), shows);
+  CHECK_EQ(outputStats().skipped, skipped + 10);
+  const int rendersWhileDark = renders;
+
+  // Back from dark: the dropped frames are rendered before showing.
+  outputSetBrightness(50);
+  CHECK(outputUpdate(now += latency));
+  CHECK_EQ(renders, rendersWhileDark + 1);
+  CHECK_EQ(FastLED.showCount(), shows + 1);
+
+  // The sketch shows once per frame: at 5 BPM on 300 LEDs a frame is due
+  // every 40 ms, so one virtual second of 1 ms loops yields 25 shows.
+  setup();
+  for (int i = 0; i < 100; ++i) {
+    host::advanceMicros(1000);
+    loop();
+  }
+  shows = FastLED.showCount();
+  for (int i = 0; i < 1000; ++i) {
+    host::advanceMicros(1000);
+    loop();
+  }
+  CHECK_EQ(FastLED.showCount() - shows, 25);
+
+  return checkSummary();
+}
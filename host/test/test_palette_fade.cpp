@@ -0,0 +1,192 @@
+// Palette registry and crossfade: the registry loads 16-entry palettes and
+// gradients (custom ones included), gradients are sampled with the stops
+// kept exactly, the inline sampler matches ColorFromPalette(); the fade
+// does bounded work per step and per pass and arrives exactly at the
+// target; switching from the sketch by serial command and button.
+
+#include <Arduino.h>
+#include <FastLED.h>
+#include "config.h"
+#include "animation.h"
+#include "palette.h"
+#include "check.h"
+
+#include <cstdlib>
+#include <cstring>
+
+void setup();
+void loop();
+void selectPalette(uint8_t index);
+extern uint8_t gPaletteIndex;
+
+namespace {
+
+bool samePalette(const CRGBPalette16& a, const CRGBPalette16& b) {
+  return memcmp(a.entries, b.entries, sizeof(a.entries)) == 0;
+}
+
+int changedEntries(const CRGBPalette16& a, const CRGBPalette16& b) {
+  int changed = 0;
+  for (int i = 0; i < 16; ++i) {
+    if (a.entries[i] != b.entries[i]) ++changed;
+  }
+  return changed;
+}
+
+int maxChannelDelta(const CRGBPalette16& a, const CRGBPalette16& b) {
+  int delta = 0;
+  for (int i = 0; i < 16; ++i) {
+    delta = std::max(delta, abs(a.entries[i].r - b.entries[i].r));
+    delta = std::max(delta, abs(a.entries[i].g - b.entries[i].g));
+    delta = std::max(delta, abs(a.entries[i].b - b.entries[i].b));
+  }
+  return delta;
+}
+
+CRGBPalette16 loaded(uint8_t index) {
+  CRGBPalette16 palette;
+  paletteLoad(index, palette);
+  return palette;
+}
+
+// Runs the sketch until the palette fade is over and its pattern is shown.
+void runUntilFaded() {
+  for (int i = 0; i < 20000 && (paletteFadeActive() || VirtualLedsRebuildPending()); ++i) {
+    host::advanceMicros(1000);
+    loop();
+  }
+}
+
+// The shown pattern was built from the current palette.
+bool patternMatchesPalette() {
+  for (long i = 0; i < gVirtualLedCount; ++i) {
+    if (gVirtualLeds[i] != ColorFromPalette(currentPalette, (uint8_t)((i * 256L) / gVirtualLedCount))) return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+int main() {
+  host::serialEcho(false);
+
+  // Registry: the predefined palettes in order, then the custom ones.
+  CHECK_EQ(gPaletteCount, 10);
+  CHECK(samePalette(loaded(0), OceanColors_p));
+  CHECK(samePalette(loaded(3), HeatColors_p));
+  CHECK(samePalette(loaded(7), RainbowStripeColors_p));
+  CHECK(samePalette(loaded(gPaletteCount), OceanColors_p));  // out of range: the first
+  const CRGBPalette16 halves = loaded(9);
+  CHECK(halves[7] == CRGB(255, 0, 0));
+  CHECK(halves[8] == CRGB(0, 0, 255));
+
+  // The renderers' sampler is FastLED's linear blend, index for index.
+  const CRGBPalette16 rainbow = RainbowColors_p;
+  bool sameSamples = true;
+  for (int i = 0; i < 256; ++i) {
+    sameSamples = sameSamples && paletteSample(halves, (uint8_t)i) == ColorFromPalette(halves, (uint8_t)i) &&
+                  paletteSample(rainbow, (uint8_t)i) == ColorFromPalette(rainbow, (uint8_t)i);
+  }
+  CHECK(sameSamples);
+
+  // Gradient: end stops exact, entries between two stops interpolated, and
+  // a hard edge (two stops at index 128) kept on its side of each entry.
+  const CRGBPalette16 edge = loaded(8);
+  CHECK(edge[0] == CRGB(0, 0, 0));
+  CHECK(edge[15] == CRGB(0, 255, 0));
+  CHECK(edge[7] == CRGB(lerp8by8(0, 255, (uint8_t)(119 * 256 / 128)), 0, 0));  // index 119
+  const uint8_t f = (uint8_t)((136 - 128) * 256 / 127);                         // index 136
+  CHECK(edge[8] == CRGB(0, lerp8by8(0, 255, f), lerp8by8(255, 0, f)));
+  // The 16 entries are an approximation: rendered, the hard edge becomes a
+  // blend from entry 7 to entry 8 over a sixteenth of the palette.
+  CHECK(paletteSample(edge, 112) == edge[7]);
+  CHECK(paletteSample(edge, 128) == edge[8]);
+  const CRGB mid = paletteSample(edge, 120);
+  CHECK(mid.r > 0 && mid.b > 0);
+  CHECK(mid == CRGB(lerp8by8(edge[7].r, edge[8].r, 128), lerp8by8(edge[7].g, edge[8].g, 128),
+                    lerp8by8(edge[7].b, edge[8].b, 128)));
+  static const uint8_t ramp[] PROGMEM = { 0, 0, 0, 0, 255, 255, 255, 255 };
+  CRGBPalette16 grey;
+  paletteLoadGradient(ramp, grey);
+  for (int k = 0; k < 16; ++k) CHECK_EQ(grey[k].r, k * 17);
+
+  // Module: steps touch at most maxEntries entries, a pass moves each
+  // channel by at most PALETTE_FADE_STEP, and the fade ends on the target.
+  const uint16_t perStep = 5;
+  currentPalette = LavaColors_p;
+  const CRGBPalette16 target = OceanColors_p;
+  paletteFadeTo(OceanColors_p);
+  CHECK(paletteFadeActive());
+  int passes = 0;
+  CRGBPalette16 passStart = currentPalette;
+  for (int call = 0; call < 10000 && paletteFadeActive(); ++call) {
+    const CRGBPalette16 before = currentPalette;
+    bool passDone = paletteFadeStep(perStep);
+    CHECK(changedEntries(before, currentPalette) <= perStep);
+    if (passDone) {
+      ++passes;
+      CHECK(maxChannelDelta(passStart, currentPalette) <= PALETTE_FADE_STEP);
+      passStart = currentPalette;
+    }
+  }
+  CHECK(!paletteFadeActive());
+  CHECK(samePalette(currentPalette, target));
+  CHECK(passes <= (255 + PALETTE_FADE_STEP - 1) / PALETTE_FADE_STEP);
+  CHECK(!paletteFadeStep(perStep));
+
+  // Sketch: a serial digit fades to that palette and the strip follows.
+  setup();
+  const uint8_t command[] = { '3' };
+  host::serialFeed(command, sizeof(command));
+  host::advanceMicros(1000);
+  loop();
+  CHECK_EQ(gPaletteIndex, 3);
+  CHECK(paletteFadeActive());
+  runUntilFaded();
+  CHECK(!paletteFadeActive());
+  CHECK(samePalette(currentPalette, HeatColors_p));
+  CHECK(patternMatchesPalette());
+
+  // Unknown commands and out-of-range indices are ignored.
+  const uint8_t ignored[] = { 'x' };
+  host::serialFeed(ignored, sizeof(ignored));
+  loop();
+  selectPalette(gPaletteCount);
+  CHECK_EQ(gPaletteIndex, 3);
+  CHECK(!paletteFadeActive());
+
+  // Button: a bounce shorter than the debounce time does nothing, a held
+  // press selects the next palette once.
+  host::setDigitalInput(PALETTE_BUTTON_PIN, HIGH);
+  loop();
+  host::setDigitalInput(PALETTE_BUTTON_PIN, LOW);
+  host::advanceMicros(1000);
+  loop();
+  host::setDigitalInput(PALETTE_BUTTON_PIN, HIGH);
+  for (int i = 0; i < 100; ++i) {
+    host::advanceMicros(1000);
+    loop();
+  }
+  CHECK_EQ(gPaletteIndex, 3);
+  host::setDigitalInput(PALETTE_BUTTON_PIN, LOW);
+  for (int i = 0; i < 100; ++i) {
+    host::advanceMicros(1000);
+    loop();
+  }
+  CHECK_EQ(gPaletteIndex, 4);
+  runUntilFaded();
+  CHECK(samePalette(currentPalette, ForestColors_p));
+  CHECK(patternMatchesPalette());
+
+  // A custom gradient is selected like any other.
+  const uint8_t custom[] = { '8' };
+  host::serialFeed(custom, sizeof(custom));
+  host::advanceMicros(1000);
+  loop();
+  CHECK_EQ(gPaletteIndex, 8);
+  runUntilFaded();
+  CHECK(samePalette(currentPalette, edge));
+  CHECK(patternMatchesPalette());
+
+  return checkSummary();
+}
@@ -0,0 +1,203 @@
+// Warm boot: the persisted record in the EEPROM shim. The module on its own
+// (one byte per call, the ring of slots, torn and stale records), then the
+// sketch saving its settings and phase and resuming them from setup(), and
+// the boot timing 't' reports.
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include "config.h"
+#include "effects.h"
+#include "persist.h"
+#include "check.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+extern int brightness;
+extern float bpm;
+extern float waveLengthScale;
+void setup();
+void loop();
+void handleCommandByte(uint8_t c);
+PersistState liveState();
+
+namespace {
+
+PersistState makeState(uint8_t brightness, uint32_t phase) {
+  PersistState state = {};
+  state.palette = 1;
+  state.effect = 0;
+  state.brightness = brightness;
+  state.centiBpm = 500;
+  state.milliWave = 1000;
+  state.phase = phase;
+  return state;
+}
+
+bool same(const PersistState& a, const PersistState& b) {
+  return a.palette == b.palette && a.effect == b.effect && a.brightness == b.brightness && a.centiBpm == b.centiBpm &&
+         a.milliWave == b.milliWave && a.phase == b.phase;
+}
+
+// The records' CRC-8 (polynomial 0x07).
+uint8_t crc8(const uint8_t* data, int length) {
+  uint8_t crc = 0;
+  for (int i = 0; i < length; ++i) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; ++bit) crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+  }
+  return crc;
+}
+
+// Writes the whole of a started save.
+void finishSave(const PersistState& state) {
+  while (persistBusy()) {
+    host::advanceMicros(1000);
+    persistUpdate(state, millis());
+  }
+}
+
+// Runs the sketch for `ms` of virtual time, a loop() per millisecond;
+// returns the most EEPROM bytes one loop() wrote.
+unsigned long runFor(unsigned long ms) {
+  unsigned long most = 0;
+  for (unsigned long i = 0; i < ms; ++i) {
+    const unsigned long before = host::eepromWrites();
+    host::advanceMicros(1000);
+    loop();
+    if (host::eepromWrites() - before > most) most = host::eepromWrites() - before;
+  }
+  return most;
+}
+
+// Value of ` name=` in the [BOOT] line of the 't' report; -1 if missing.
+long bootField(const char* name) {
+  host::serialTakeOutput();
+  handleCommandByte('t');
+  const std::string text = host::serialTakeOutput();
+  const size_t line = text.find("[BOOT]");
+  if (line == std::string::npos) return -1;
+  const size_t at = text.find(std::string(" ") + name + "=", line);
+  return at == std::string::npos ? -1 : atol(text.c_str() + at + strlen(name) + 2);
+}
+
+}  // namespace
+
+int main() {
+  host::serialEcho(false);
+  host::serialCapture(true);
+  host::setMicros(1000000);
+  PersistState state;
+
+  // Erased EEPROM: nothing to restore.
+  CHECK(!persistSetup(state));
+
+  // A save writes one byte per call, and none while the previous write
+  // is still running.
+  persistSave(makeState(10, 1), millis());
+  persistUpdate(makeState(10, 1), millis());
+  const unsigned long at = micros();
+  const unsigned long written = host::eepromWrites();
+  persistUpdate(makeState(10, 1), millis());
+  CHECK_EQ(host::eepromWrites(), written);
+  CHECK_EQ(micros(), at);
+  finishSave(makeState(10, 1));
+  CHECK_EQ(host::eepromWrites(), (long)kPersistRecordBytes);
+  CHECK(persistSetup(state));
+  CHECK(same(state, makeState(10, 1)));
+
+  // Saves go round the ring of slots: three rounds write each byte of the
+  // area about three times, and nothing outside it.
+  const int saves = 3 * kPersistSlots;
+  for (int i = 0; i < saves; ++i) {
+    persistSave(makeState((uint8_t)i, (uint32_t)i * 1000), millis());
+    finishSave(makeState((uint8_t)i, (uint32_t)i * 1000));
+  }
+  unsigned long most = 0;
+  for (int a = 0; a <= E2END; ++a) {
+    if (a >= PERSIST_EEPROM_OFFSET + PERSIST_EEPROM_BYTES) CHECK_EQ(host::eepromWrites(a), 0);
+    if (host::eepromWrites(a) > most) most = host::eepromWrites(a);
+  }
+  CHECK(most <= 4);
+  CHECK(persistSetup(state));
+  CHECK(same(state, makeState((uint8_t)(saves - 1), (uint32_t)(saves - 1) * 1000)));
+
+  // Power lost halfway through a save: the record before it is used.
+  persistSave(makeState(200, 7), millis());
+  for (int i = 0; i < kPersistRecordBytes / 2; ++i) {
+    host::advanceMicros(5000);
+    persistUpdate(makeState(200, 7), millis());
+  }
+  CHECK(persistBusy());
+  CHECK(persistSetup(state));
+  CHECK(same(state, makeState((uint8_t)(saves - 1), (uint32_t)(saves - 1) * 1000)));
+
+  // A record of another layout or of a build with other defaults (the
+  // layout byte and the stamp after the sequence) is ignored, even with a
+  // valid CRC.
+  for (int field = 2; field <= 3; ++field) {
+    host::eepromErase();
+    CHECK(!persistSetup(state));
+    persistSave(makeState(10, 1), millis());
+    finishSave(makeState(10, 1));
+    CHECK(persistSetup(state));
+    uint8_t record[kPersistRecordBytes];
+    for (int i = 0; i < kPersistRecordBytes; ++i) record[i] = EEPROM.read(PERSIST_EEPROM_OFFSET + i);
+    record[field] ^= 1;
+    record[kPersistRecordBytes - 1] = crc8(record, kPersistRecordBytes - 1);
+    for (int i = 0; i < kPersistRecordBytes; ++i) EEPROM.write(PERSIST_EEPROM_OFFSET + i, record[i]);
+    CHECK(!persistSetup(state));
+  }
+
+  // The sketch on a new board starts from the defaults and shows its first
+  // frame right after setup(), with no fixed delay.
+  host::eepromErase();
+  const long start = (long)micros();
+  setup();
+  CHECK_EQ(brightness, BRIGHTNESS);
+  runFor(100);
+  CHECK_EQ(bootField("restored"), 0);
+  CHECK(bootField("setup") - start < 1000);
+  CHECK(bootField("first_frame") >= bootField("setup"));
+  CHECK(bootField("first_frame") - start < 50000);
+
+  // Changed settings are saved once they held for PERSIST_SAVE_MS, a byte
+  // per loop at most.
+  handleCommandByte('n');
+  handleCommandByte('e');
+  brightness = 77;
+  bpm = 12.5f;
+  waveLengthScale = 1.75f;
+  const PersistState live = liveState();
+  const uint16_t before = persistSaves();
+  CHECK(runFor(PERSIST_SAVE_MS - 500) <= 1);
+  CHECK_EQ(persistSaves(), before);
+  CHECK(runFor(2000) <= 1);
+  CHECK_EQ(persistSaves(), before + 1);
+
+  // Power cycle: setup() resumes them.
+  brightness = BRIGHTNESS;
+  bpm = BPM;
+  waveLengthScale = WAVE_LENGTH_SCALE;
+  gPaletteIndex = PALETTE_INDEX;
+  setup();
+  CHECK_EQ(gPaletteIndex, live.palette);
+  CHECK_EQ(effectIndex(), live.effect);
+  CHECK_EQ(brightness, 77);
+  CHECK_EQ(liveState().centiBpm, 1250);
+  CHECK_EQ(liveState().milliWave, 1750);
+  CHECK_EQ(bootField("restored"), 1);
+
+  // The phase alone is saved every PERSIST_PHASE_MS, and the animation
+  // resumes from it.
+  runFor(PERSIST_PHASE_MS + 1000);
+  PersistState saved;
+  CHECK(persistSetup(saved));
+  CHECK(saved.phase > 0);
+  CHECK(saved.phase <= liveState().phase);
+  setup();
+  CHECK_EQ(liveState().phase, saved.phase);
+
+  return checkSummary();
+}
@@ -0,0 +1,132 @@
+// Power estimation: FrameLoad() from the pattern's prefix sums against the
+// load of the frame actually rendered (all strips, folds, tiling, partial
+// sections, interpolation, background rebuilds and uploads), the current
+// limit arithmetic, and the sketch keeping its frames within POWER_LIMIT_MA.
+// Built for variants with a limit set; the direct palette build has no
+// pattern and must report that instead.
+
+#include <Arduino.h>
+#include <FastLED.h>
+#include "config.h"
+#include "animation.h"
+#include "power.h"
+#include "check.h"
+
+#include <cstdlib>
+
+void setup();
+void loop();
+
+namespace {
+
+// The estimate of an interpolated frame blends two windows; the render
+// rounds every channel of every blended pixel down. The high-precision
+// render dithers, and blends before the gamma curve: as the curve is
+// convex, its interpolated frames are overestimated, never under.
+bool withinTolerance(uint32_t estimate, uint32_t exact, bool interpolated) {
+  const long perPixel = POWER_MA_RED + POWER_MA_GREEN + POWER_MA_BLUE;
+  const long error = (long)estimate - (long)exact;
+  if (RENDER_HIGH_PRECISION) {
+    const long dither = (long)(exact / 50) + 2 * perPixel * powerLedCount();
+    return error >= -dither && (interpolated || error <= dither);
+  }
+  return labs(error) <= (interpolated ? perPixel * powerLedCount() : 0);
+}
+
+// Renders the frame and compares its load with the estimate made before.
+bool estimateMatches(long frame, int res, float scale) {
+  uint32_t estimate = 0;
+  if (!FrameLoad(frame, res, scale, estimate)) return false;
+  FillLEDsFromPaletteColors(frame, res, scale);
+  const uint32_t exact = powerLedsLoad();
+  const bool interpolated = res > 1 && frame % res != 0;
+  if (!withinTolerance(estimate, exact, interpolated)) {
+    fprintf(stderr, "frame %ld res %d scale %.2f: estimate %lu, rendered %lu\n",
+            frame, res, scale, (unsigned long)estimate, (unsigned long)exact);
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+int main() {
+  host::serialEcho(false);
+  currentPalette = RainbowColors_p;
+  SetRenderBrightness(255);
+
+  CHECK(kPowerEstimate);
+  CHECK(POWER_LIMIT_MA > 0);
+
+  if (RENDER_DIRECT_PALETTE) {
+    // No pattern to keep sums of: measured from leds[] instead.
+    uint32_t load = 0;
+    RebuildVirtualLeds(1.0f, 1);
+    CHECK(!FrameLoad(0, 1, 1.0f, load));
+  } else {
+    // Every window position, short (tiled), equal and long patterns.
+    const int resolutions[] = { 1, 3 };
+    const float scales[] = { 0.01f, 0.3f, 1.0f, 2.7f, 8.0f };
+    for (float scale : scales) {
+      for (int res : resolutions) {
+        RebuildVirtualLeds(scale, res);
+        const long span = gVirtualLedCount * res;
+        const long step = span > 200 ? span / 97 : 1;
+        for (long frame = 0; frame < span + res; frame += step) {
+          CHECK(estimateMatches(frame, res, scale));
+        }
+        CHECK(estimateMatches(123456L * res + 1, res, scale));
+      }
+    }
+
+    // During a background rebuild the old pattern renders; once the new
+    // one is complete it is swapped in by the render and estimated from.
+    RebuildVirtualLeds(1.0f, 1);
+    currentPalette = LavaColors_p;
+    RequestVirtualLedsRebuild(0.5f);
+    bool built = StepVirtualLedsRebuild(3);
+    if (!built) CHECK(estimateMatches(17, 1, 1.0f));
+    while (!built) built = StepVirtualLedsRebuild(3);
+    CHECK(estimateMatches(18, 1, 0.5f));
+
+    // An uploaded pattern.
+    CRGB* slot = BeginVirtualLedsUpload(5);
+    CHECK(slot != nullptr);
+    if (slot) {
+      for (int i = 0; i < 5; ++i) slot[i] = CRGB(50 * i, 255, 7);
+      CHECK(CommitVirtualLedsUpload());
+      CHECK(estimateMatches(2, 1, 1.0f));
+      CHECK(estimateMatches(5, 2, 1.0f));
+    }
+    currentPalette = RainbowColors_p;
+  }
+
+  // Limit arithmetic: the chosen brightness is the highest within budget.
+  const long leds = powerLedCount();
+  const uint32_t white = (uint32_t)leds * powerPixelLoad(255, 255, 255);
+  CHECK_EQ(powerMilliamps(0, 255), POWER_MA_IDLE * leds);
+  CHECK_EQ(powerMilliamps(white, 255), (POWER_MA_RED + POWER_MA_GREEN + POWER_MA_BLUE + POWER_MA_IDLE) * leds);
+  const uint8_t limited = powerLimitBrightness(white, 255);
+  CHECK(limited < 255);
+  CHECK(powerMilliamps(white, limited) <= (uint32_t)POWER_LIMIT_MA);
+  CHECK(powerMilliamps(white, limited + 1) > (uint32_t)POWER_LIMIT_MA);
+  CHECK_EQ(powerLimitBrightness(0, 200), 200);
+  CHECK_EQ(powerLimitBrightness(white, 0), 0);
+  CHECK(powerLimitBrightness(white, limited) == limited);
+
+  // The sketch dims its frames to the budget. With the high-precision
+  // render the brightness is in the levels, FastLED stays at 255.
+  setup();
+  for (int i = 0; i < 3000; ++i) {
+    host::advanceMicros(1000);
+    loop();
+    if (i % 100 != 99) continue;
+    const uint8_t shown = FastLED.getBrightness();
+    const uint32_t milliamps = powerMilliamps(powerLedsLoad(), shown);
+    CHECK(milliamps <= (uint32_t)POWER_LIMIT_MA + (RENDER_HIGH_PRECISION ? POWER_LIMIT_MA / 20 : 0));
+    if (RENDER_HIGH_PRECISION) CHECK_EQ(shown, 255);
+    else CHECK(shown < BRIGHTNESS);
+  }
+
+  return checkSummary();
+}
@@ -0,0 +1,134 @@
+// Adaptive render quality: the level ladder for any RESOLUTION, stepping
+// down under load or skipped frames, holding inside the hysteresis band,
+// stepping back up after QUALITY_HOLD_FRAMES calm frames, and the sketch
+// keeping its BPM speed while a slow show() pushes it down a level.
+// Built for a RESOLUTION 4 variant.
+
+#include <Arduino.h>
+#include <FastLED.h>
+#include "config.h"
+#include "animation.h"
+#include "quality.h"
+#include "check.h"
+
+#include <cstring>
+
+void setup();
+void loop();
+extern float waveLengthScale;
+
+namespace {
+
+// Records `frames` rendered frames of `cost` µs at a 1000 µs period;
+// returns how many changed the level.
+int record(int frames, unsigned long cost) {
+  int changes = 0;
+  for (int i = 0; i < frames; ++i) {
+    if (qualityRecord(cost, 1000)) ++changes;
+  }
+  return changes;
+}
+
+// Frames until the level changes (-1: not within `limit`).
+int framesToChange(unsigned long cost, int limit) {
+  for (int i = 1; i <= limit; ++i) {
+    if (qualityRecord(cost, 1000)) return i;
+  }
+  return -1;
+}
+
+}  // namespace
+
+int main() {
+  host::serialEcho(false);
+  CHECK(QUALITY_ADAPTIVE);
+  CHECK_EQ(RESOLUTION, 4);
+
+  // Ladder: powers of two up to RESOLUTION, the last one whole steps only.
+  qualitySetup(1);
+  CHECK_EQ(qualityMaxLevel(), 0);
+  CHECK_EQ(record(20, 100000), 0);
+  CHECK_EQ(qualityFrame(7), 7L);
+  qualitySetup(3);
+  CHECK_EQ(qualityMaxLevel(), 2);
+  CHECK_EQ(record(8, 100000), 2);
+  CHECK_EQ(qualityStep(), 3);
+  CHECK_EQ(qualityFrame(7), 6L);
+  CHECK_EQ(qualityFrame(9), 9L);
+
+  // Over QUALITY_HIGH_LOAD: down once the first frames have settled, and
+  // not again while the lower level has room.
+  qualitySetup(8);
+  CHECK_EQ(framesToChange(950, 10), 4);
+  CHECK_EQ(qualityLevel(), 1);
+  CHECK_EQ(qualityStep(), 2);
+  CHECK_EQ(qualityFrame(13), 12L);
+  CHECK_EQ(record(500, 950), 0);  // 47% of 2000 µs, 95% of 1000 µs: stays
+  CHECK_EQ(framesToChange(1900, 20) > 0, true);
+  CHECK_EQ(qualityLevel(), 2);
+
+  // Back up one level at a time, after QUALITY_HOLD_FRAMES calm frames.
+  const int up = framesToChange(100, 1000);
+  CHECK(up >= QUALITY_HOLD_FRAMES && up <= QUALITY_HOLD_FRAMES + 8);
+  CHECK_EQ(qualityLevel(), 1);
+  CHECK_EQ(framesToChange(100, 1000), QUALITY_HOLD_FRAMES);
+  CHECK_EQ(qualityLevel(), 0);
+  CHECK_EQ(qualityCost(), 100UL);
+
+  // Skipped frames step down even when the average looks fine (once the
+  // last change has settled), and reset the count towards stepping up.
+  CHECK_EQ(record(8, 100), 0);
+  qualityNoteSkipped(2);
+  CHECK(qualityRecord(100, 1000));
+  CHECK_EQ(qualityLevel(), 1);
+  CHECK_EQ(record(QUALITY_HOLD_FRAMES - 1, 100), 0);
+  qualityNoteSkipped(1);
+  CHECK(qualityRecord(100, 1000));
+  CHECK_EQ(qualityLevel(), 2);
+  CHECK_EQ(framesToChange(100, 1000), QUALITY_HOLD_FRAMES);
+
+  // A stopped frame timer (period 0) is never overloaded.
+  qualitySetup(8);
+  for (int i = 0; i < 10; ++i) CHECK(!qualityRecord(100000, 0));
+
+  // The sketch: at 5 BPM / 300 LEDs / RESOLUTION 4 a frame is due every
+  // 10 ms. A 9.5 ms show() does not leave enough of it, so every second
+  // sub-frame is rendered; the pattern still moves at the BPM speed.
+  setup();
+  const unsigned long start = micros();
+  FastLED.setShowMicros(9500);
+  for (int i = 0; i < 2000; ++i) {
+    host::advanceMicros(1000);
+    loop();
+  }
+  CHECK_EQ(qualityLevel(), 1);
+
+  const unsigned long shows = FastLED.showCount();
+  const unsigned long second = micros() + 1000000;
+  int checked = 0;
+  while ((long)(micros() - second) < 0) {
+    host::advanceMicros(1000);
+    const unsigned long frame = (micros() - start) / 10000;  // looper of this loop()
+    const unsigned long before = FastLED.showCount();
+    loop();
+    if (FastLED.showCount() == before) continue;
+    CRGB shown[NUM_LEDS];
+    memcpy(shown, leds, sizeof(shown));
+    FillLEDsFromPaletteColors(frame - frame % 2, RESOLUTION, waveLengthScale);
+    CHECK_EQ(memcmp(shown, leds, sizeof(shown)), 0);
+    ++checked;
+  }
+  CHECK(checked > 0);
+  const unsigned long rendered = FastLED.showCount() - shows;
+  CHECK(rendered >= 45 && rendered <= 55);  // 100 sub-frames a second, every second one
+
+  // With the show fast again the full resolution comes back.
+  FastLED.setShowMicros(2000);
+  for (int i = 0; i < 3000; ++i) {
+    host::advanceMicros(1000);
+    loop();
+  }
+  CHECK_EQ(qualityLevel(), 0);
+
+  return checkSummary();
+}
@@ -0,0 +1,90 @@
+// RAM plan: the planned sizes against what the modules hold (the longest
+// pattern, the effect state, the zones' arena, the extra strips), and the
+// plan printed by ramPlanReport() and the 't' command. Built for the
+// telemetry and the zones variants; a plan over the SRAM failing the build
+// is the ram_plan_over_sram test (host/CMakeLists.txt).
+
+#include <Arduino.h>
+#include <FastLED.h>
+#include "config.h"
+#include "animation.h"
+#include "effects.h"
+#include "ram_plan.h"
+#include "strips.h"
+#include "telemetry.h"
+#include "zones.h"
+#include "check.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+void setup();
+void handleCommandByte(uint8_t c);
+
+namespace {
+
+// Value of ` name=` in a report line; -1 if missing.
+long field(const std::string& line, const char* name) {
+  const size_t at = line.find(std::string(" ") + name + "=");
+  return at == std::string::npos ? -1 : atol(line.c_str() + at + strlen(name) + 2);
+}
+
+}  // namespace
+
+int main() {
+  host::serialEcho(false);
+  host::serialCapture(true);
+  setup();
+
+  // The longest wave fills a pattern slot: the section at
+  // WAVE_LENGTH_SCALE_MAX, capped by VIRTUAL_LEDS_MAX.
+  RebuildVirtualLeds(WAVE_LENGTH_SCALE_MAX, RESOLUTION);
+  CHECK_EQ(gVirtualLedCount, kPlanPatternPixels);
+  CHECK_EQ(kPlanPatternPixels, (long)VIRTUAL_LEDS_MAX);
+  RebuildVirtualLeds(1.0f, RESOLUTION);
+  CHECK_EQ(gVirtualLedCount, kPlanSectionLeds);
+
+  for (uint8_t i = 0; i < effectCount(); ++i) {
+    if (!strcmp(effectName(i), "fire")) CHECK_EQ(effectRamBytes(i), kPlanEffectBytes);
+    if (!strcmp(effectName(i), "zones")) CHECK_EQ(effectRamBytes(i), kZoneArenaPixels * (long)sizeof(CRGB));
+  }
+  CHECK_EQ((long)gZoneRamBytes, kZoneArenaPixels * (long)sizeof(CRGB));
+  long stripLeds = 0;
+  for (uint8_t s = 0; s < gExtraStripCount; ++s) stripLeds += gExtraStrips[s].length;
+  CHECK_EQ(stripLeds, kPlanStripLeds);
+#ifdef ANIMATION_ZONES
+  // Zones 0 and 1 share their 100-pixel pattern; then 15 and 40 pixels.
+  CHECK_EQ(kZoneArenaPixels, 155L);
+  CHECK_EQ(kPlanStripLeds, (long)(NUM_LEDS + NUM_LEDS / 2 + NUM_LEDS / 3 + 7));
+#endif
+
+  // The report lists every entry, and they add up to the total. The host
+  // has no board SRAM and no readings.
+  host::serialTakeOutput();
+  ramPlanReport();
+  const std::string text = host::serialTakeOutput();
+  const std::string plan = text.substr(0, text.find('\n'));
+  CHECK(plan.rfind("[RAM] plan leds=", 0) == 0);
+  CHECK_EQ(field(plan, "leds"), (long)sizeof(leds));
+  CHECK_EQ(field(plan, "pattern"), 2 * kPlanPatternPixels * (long)sizeof(VirtualPixel));
+  CHECK_EQ(field(plan, "palette"), RENDER_DIRECT_PALETTE ? 256L * (long)sizeof(CRGB) : (long)sizeof(CRGB));
+  CHECK_EQ(field(plan, "telemetry"), (long)tel::kRamBytes);
+  CHECK_EQ(field(plan, "reserve"), (long)RAM_PLAN_RESERVE_BYTES);
+  long sum = 0;
+  for (const char* name : { "leds", "strips", "pattern", "palette", "loads", "levels", "effects", "zones", "audio", "telemetry",
+                            "reserve" }) {
+    CHECK(field(plan, name) >= 0);
+    sum += field(plan, name);
+  }
+  CHECK_EQ(field(plan, "total"), sum);
+  CHECK_EQ(sum, kRamPlanBytes);
+  CHECK(plan.find(" of 0") != std::string::npos);
+  CHECK(text.find("[RAM] static=0 free=0 headroom=0") != std::string::npos);
+
+  // 't' prints it along with the telemetry.
+  handleCommandByte('t');
+  CHECK_EQ(host::serialTakeOutput().find("[RAM] plan") != std::string::npos, tel::enabled);
+
+  return checkSummary();
+}
@@ -0,0 +1,172 @@
+// Cooperative scheduler: priority and deadline order within a pass, frames
+// never held up by tasks that do not fit before the next boundary, overdue
+// tasks still running when frames fill the CPU, periodic releases that skip
+// rather than burst, and the statistics and report. Tasks spend their run
+// time on the virtual clock.
+
+#include <Arduino.h>
+#include "config.h"
+#include "scheduler.h"
+#include "check.h"
+
+#include <string>
+
+namespace {
+
+std::string trace;           // names (first letter) of the tasks run, in order
+unsigned long frameCost = 0;  // µs each task spends
+unsigned long slowCost = 0;
+unsigned long frameDue = 0;   // boundary of the event-driven frame task
+unsigned long frameLate = 0;  // worst start after its boundary, measured here
+bool eventReady = false;
+
+void runFrame() {
+  trace += 'f';
+  host::advanceMicros(frameCost);
+}
+
+void runSlow() {
+  trace += 's';
+  host::advanceMicros(slowCost);
+}
+
+void runA() { trace += 'a'; }
+void runB() { trace += 'b'; eventReady = false; }
+void runC() { trace += 'c'; }
+
+bool bReady(unsigned long, unsigned long&) {
+  return eventReady;
+}
+
+// A frame every 1000 µs, reported through ready() like the sketch's.
+bool frameReady(unsigned long now, unsigned long& due) {
+  due = frameDue;
+  return (long)(now - frameDue) >= 0;
+}
+
+void runEventFrame() {
+  const unsigned long late = micros() - frameDue;
+  if (late > frameLate) frameLate = late;
+  frameDue += 1000;
+  host::advanceMicros(frameCost);
+}
+
+// Calls schedulerRun() every `step` µs of idle time for `us` µs.
+void runFor(unsigned long us, unsigned long step) {
+  const unsigned long end = micros() + us;
+  while ((long)(micros() - end) < 0) {
+    schedulerRun();
+    host::advanceMicros(step);
+  }
+}
+
+std::string report() {
+  host::serialTakeOutput();
+  schedulerReport();
+  return host::serialTakeOutput();
+}
+
+}  // namespace
+
+int main() {
+  host::serialEcho(false);
+  host::serialCapture(true);
+
+  // One pass: the frame first, then by priority, ties by deadline; each
+  // task at most once, nothing before its release.
+  {
+    static const SchedTask tasks[] = {
+      { "a", runA, nullptr, 1000, 5000, 2 },
+      { "frame", runFrame, nullptr, 1000, 1000, 0 },
+      { "b", runB, bReady, 0, 1000, 1 },
+      { "c", runC, nullptr, 1000, 2000, 2 },
+    };
+    host::setMicros(0);
+    frameCost = 0;
+    schedulerSetup(tasks, 4);
+    eventReady = true;
+    trace.clear();
+    CHECK_EQ(schedulerRun(), 1);
+    CHECK_EQ(trace.compare("b"), 0);
+    host::advanceMicros(1000);
+    trace.clear();
+    CHECK_EQ(schedulerRun(), 3);
+    CHECK_EQ(trace.compare("fca"), 0);
+    CHECK_EQ(schedulerRun(), 0);
+    CHECK_EQ(schedulerStats(2).runs, 1UL);
+  }
+
+  // Slack: the slow task (600 µs) only starts when it ends before the next
+  // frame, so frames start on time although the pair would not fit
+  // anywhere in a period. Its first run has no worst case to go by; the
+  // one learned is kept when the statistics are cleared.
+  {
+    static const SchedTask tasks[] = {
+      { "frame", runEventFrame, frameReady, 0, 100, 0 },
+      { "slow", runSlow, nullptr, 1700, 2000, 2 },
+    };
+    host::setMicros(0);
+    frameCost = 100;
+    slowCost = 600;
+    frameDue = 1000;
+    schedulerSetup(tasks, 2);
+    runFor(5000, 50);
+    frameLate = 0;
+    schedulerResetStats();
+    runFor(1000000, 50);
+    CHECK(frameLate <= 50);
+    CHECK_EQ(schedulerStats(0).missed, 0UL);
+    CHECK(schedulerStats(0).worstLate <= 50);
+    CHECK_EQ(schedulerStats(1).worstMicros, 600UL);
+    CHECK(schedulerStats(1).runs >= 1000000 / 1700 - 1);
+    CHECK(schedulerStats(1).worstLate < 1000);
+    CHECK_EQ(schedulerStats(1).missed, 0UL);
+  }
+
+  // Overload: frames alone take longer than their period. The knob-like
+  // task never fits, but once past its deadline it gets a turn after the
+  // frame of a pass.
+  {
+    static const SchedTask tasks[] = {
+      { "frame", runFrame, nullptr, 1000, 1000, 0 },
+      { "slow", runSlow, nullptr, 1000, 5000, 2 },
+    };
+    host::setMicros(0);
+    frameCost = 1200;
+    slowCost = 10;
+    schedulerSetup(tasks, 2);
+    runFor(1000000, 1);
+    const SchedStats& slow = schedulerStats(1);
+    CHECK(slow.runs >= 1000000 / (1000 + 5000 + 1200 + 10));
+    CHECK_EQ(slow.missed, slow.runs);
+    CHECK(slow.worstLate <= 5000 + 1200 + 10);
+    CHECK(schedulerStats(0).runs >= 1000000 / (1200 + 10) - 1);
+  }
+
+  // A periodic task that falls behind runs once, not once per missed
+  // period, and is late by the whole gap.
+  {
+    static const SchedTask tasks[] = {
+      { "a", runA, nullptr, 1000, 2000, 2 },
+    };
+    host::setMicros(0);
+    schedulerSetup(tasks, 1);
+    host::advanceMicros(10500);
+    trace.clear();
+    CHECK_EQ(schedulerRun(), 1);
+    CHECK_EQ(schedulerRun(), 0);
+    host::advanceMicros(999);
+    CHECK_EQ(schedulerRun(), 0);
+    host::advanceMicros(1);
+    CHECK_EQ(schedulerRun(), 1);
+    CHECK_EQ(trace.compare("aa"), 0);
+    CHECK_EQ(schedulerStats(0).worstLate, 9500UL);
+    CHECK_EQ(schedulerStats(0).missed, 1UL);
+
+    CHECK_EQ(report().compare("[SCHED] a n=2 worst=0 late=9500 missed=1 (us)\r\n"), 0);
+    schedulerResetStats();
+    CHECK_EQ(report().compare("[SCHED] a n=0 worst=0 late=0 missed=0 (us)\r\n"), 0);
+  }
+
+  return checkSummary();
+}
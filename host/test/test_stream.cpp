@@ -0,0 +1,290 @@
+// Binary serial streaming: packets and Adalight frames fed a byte at a time
+// land in leds[] and are shown once and acknowledged, rejected packets are
+// answered with a NAK and never shown, patterns and commands reach the
+// animation, and the animation resumes once the host stops streaming.
+
+#include <Arduino.h>
+#include <FastLED.h>
+#include "config.h"
+#include "animation.h"
+#include "effects.h"
+#include "palette.h"
+#include "ram_plan.h"
+#include "stream.h"
+#include "check.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+
+void setup();
+void loop();
+extern CRGB leds[];
+extern int brightness;
+extern float bpm;
+extern uint8_t gPaletteIndex;
+extern float waveLengthScale;
+
+namespace {
+
+typedef std::vector<uint8_t> Bytes;
+
+Bytes packet(uint8_t type, const Bytes& payload) {
+  Bytes out;
+  out.reserve(payload.size() + 7);
+  out.push_back(0xC9);
+  out.push_back(type);
+  out.push_back((uint8_t)(payload.size() >> 8));
+  out.push_back((uint8_t)payload.size());
+  out.insert(out.end(), payload.begin(), payload.end());
+  unsigned sum1 = 0, sum2 = 0;
+  for (size_t i = 1; i < out.size(); ++i) {
+    sum1 = (sum1 + out[i]) % 255;
+    sum2 = (sum2 + sum1) % 255;
+  }
+  out.push_back((uint8_t)sum2);
+  out.push_back((uint8_t)sum1);
+  out.push_back(0x36);
+  return out;
+}
+
+Bytes framePayload(long pixels, uint8_t seed) {
+  Bytes rgb;
+  for (long i = 0; i < pixels * 3; ++i) rgb.push_back((uint8_t)(seed + i * 7));
+  return rgb;
+}
+
+bool ledsEqual(const Bytes& rgb) {
+  return memcmp(leds, rgb.data(), rgb.size()) == 0;
+}
+
+void step(unsigned long us = 1000) {
+  host::advanceMicros(us);
+  loop();
+}
+
+// Feeds `bytes` in chunks of `chunk`, one loop per chunk.
+void feed(const Bytes& bytes, size_t chunk) {
+  for (size_t i = 0; i < bytes.size(); i += chunk) {
+    size_t n = std::min(chunk, bytes.size() - i);
+    host::serialFeed(bytes.data() + i, n);
+    step();
+  }
+}
+
+// Runs loops until the parser has consumed everything that was fed.
+void drain() {
+  for (int i = 0; i < 100 && Serial.available() > 0; ++i) step();
+}
+
+std::string replies() {
+  return host::serialTakeOutput();
+}
+
+}  // namespace
+
+int main() {
+  host::serialEcho(false);
+  host::serialCapture(true);
+  setup();
+  for (int i = 0; i < 100; ++i) step();
+  replies();
+
+  // A frame trickling in a few bytes per loop: nothing is shown while it is
+  // half received, then it is shown once and acknowledged.
+  Bytes rgb = framePayload(NUM_LEDS, 1);
+  Bytes frame = packet(0xDA, rgb);
+  unsigned long shows = FastLED.showCount();
+  host::serialFeed(frame.data(), frame.size() / 2);
+  for (int i = 0; i < 50; ++i) step();
+  CHECK_EQ(FastLED.showCount(), shows);
+  CHECK(streamBusy());
+  host::serialFeed(frame.data() + frame.size() / 2, frame.size() - frame.size() / 2);
+  drain();
+  CHECK(ledsEqual(rgb));
+  CHECK_EQ(FastLED.showCount(), shows + 1);
+  CHECK(replies() == std::string(1, (char)STREAM_ACK));
+
+  // While streaming the animation does not touch leds[] or show on its own.
+  shows = FastLED.showCount();
+  for (int i = 0; i < 500; ++i) step();
+  CHECK(ledsEqual(rgb));
+  CHECK_EQ(FastLED.showCount(), shows);
+
+  // Byte-at-a-time delivery, one show per frame.
+  for (uint8_t seed = 2; seed < 5; ++seed) {
+    rgb = framePayload(NUM_LEDS, seed);
+    shows = FastLED.showCount();
+    feed(packet(0xDA, rgb), 1);
+    CHECK(ledsEqual(rgb));
+    CHECK_EQ(FastLED.showCount(), shows + 1);
+    CHECK(replies() == std::string(1, (char)STREAM_ACK));
+  }
+
+  // A corrupted frame is rejected and not shown; the next good one is.
+  Bytes bad = packet(0xDA, framePayload(NUM_LEDS, 9));
+  bad[100] ^= 0x01;
+  shows = FastLED.showCount();
+  feed(bad, 64);
+  CHECK(replies() == std::string(1, (char)STREAM_NAK));
+  CHECK(!streamLedsIntact());
+  CHECK_EQ(FastLED.showCount(), shows);
+  rgb = framePayload(NUM_LEDS, 10);
+  feed(packet(0xDA, rgb), 64);
+  CHECK(ledsEqual(rgb));
+  CHECK(streamLedsIntact());
+  CHECK_EQ(FastLED.showCount(), shows + 1);
+  CHECK(replies() == std::string(1, (char)STREAM_ACK));
+
+  // Garbage, an unknown packet type and a wrong trailer are rejected; the
+  // parser finds the next packet.
+  Bytes noise = { 'x', 'y', 0x00, 0xFF };
+  feed(noise, 4);
+  feed(packet(0x42, Bytes(5, 0)), 16);
+  Bytes trailer = packet(0xC0, Bytes(1, 'A'));
+  trailer.back() = 0x00;
+  feed(trailer, 16);
+  CHECK(replies() == std::string(2, (char)STREAM_NAK));
+  rgb = framePayload(NUM_LEDS, 11);
+  feed(packet(0xDA, rgb), 256);
+  CHECK(ledsEqual(rgb));
+  CHECK(replies() == std::string(1, (char)STREAM_ACK));
+
+  // A packet that stalls is given up after STREAM_PACKET_TIMEOUT_MS.
+  Bytes stalled = packet(0xDA, framePayload(NUM_LEDS, 12));
+  host::serialFeed(stalled.data(), 20);
+  step();
+  step(STREAM_PACKET_TIMEOUT_MS * 1000UL + 1000);
+  CHECK(!streamBusy());
+  CHECK(replies() == std::string(1, (char)STREAM_NAK));
+
+  // Adalight: header with count - 1 and its check byte, then raw RGB.
+  rgb = framePayload(NUM_LEDS, 13);
+  Bytes ada = { 'A', 'd', 'a', (uint8_t)((NUM_LEDS - 1) >> 8), (uint8_t)(NUM_LEDS - 1) };
+  ada.push_back((uint8_t)(ada[3] ^ ada[4] ^ 0x55));
+  ada.insert(ada.end(), rgb.begin(), rgb.end());
+  shows = FastLED.showCount();
+  feed(ada, 100);
+  CHECK(ledsEqual(rgb));
+  CHECK_EQ(FastLED.showCount(), shows + 1);
+  replies();
+
+  // A frame longer than the strip is cut off, not written past leds[].
+  rgb = framePayload(NUM_LEDS + 5, 14);
+  feed(packet(0xDA, rgb), 256);
+  CHECK(ledsEqual(Bytes(rgb.begin(), rgb.begin() + NUM_LEDS * 3)));
+  CHECK(replies() == std::string(1, (char)STREAM_ACK));
+
+  // Commands.
+  feed(packet(0xC0, Bytes{ 'B', 77 }), 8);
+  CHECK_EQ(brightness, 77);
+  feed(packet(0xC0, Bytes{ 'S', 0x03, 0xE8 }), 8);  // 10.00 BPM
+  CHECK(bpm > 9.99f && bpm < 10.01f);
+  feed(packet(0xC0, Bytes{ 'P', 2 }), 8);
+  CHECK_EQ(gPaletteIndex, 2);
+  feed(packet(0xC0, Bytes{ 'E', 2 }), 8);
+  CHECK_EQ(effectIndex(), 2);
+  feed(packet(0xC0, Bytes{ 'E', 0 }), 8);
+  CHECK_EQ(effectIndex(), 0);
+  CHECK(replies() == std::string(5, (char)STREAM_ACK));
+  feed(packet(0xC0, Bytes{ 'B' }), 8);        // missing argument
+  feed(packet(0xC0, Bytes{ 'P', 200 }), 8);   // no such palette
+  feed(packet(0xC0, Bytes{ 'E', 200 }), 8);   // no such effect
+  feed(packet(0xC0, Bytes{ '?' }), 8);        // unknown command
+  CHECK(replies() == std::string(4, (char)STREAM_NAK));
+  CHECK_EQ(brightness, 77);
+
+  // Values outside the knob ranges are held to them, as on restore.
+  float savedBpm = bpm;
+  float savedWave = waveLengthScale;
+  feed(packet(0xC0, Bytes{ 'B', 255 }), 8);
+  CHECK_EQ(brightness, BRIGHTNESS_MAX);
+  feed(packet(0xC0, Bytes{ 'S', 0xFF, 0xFF }), 8);  // 655.35 BPM
+  CHECK(bpm == (float)BPM_MAX);
+  feed(packet(0xC0, Bytes{ 'W', 0xFF, 0xFF }), 8);  // 65.535 x
+  CHECK(waveLengthScale == kPlanWaveLengthScaleMax);
+  feed(packet(0xC0, Bytes{ 'W', 0x00, 0x01 }), 8);  // 0.001 x
+  CHECK(waveLengthScale == (float)WAVE_LENGTH_SCALE_MIN);
+  CHECK(replies() == std::string(4, (char)STREAM_ACK));
+  uint16_t milliWave = (uint16_t)(savedWave * 1000.0f + 0.5f);
+  feed(packet(0xC0, Bytes{ 'B', 77 }), 8);
+  feed(packet(0xC0, Bytes{ 'S', 0x03, 0xE8 }), 8);
+  feed(packet(0xC0, Bytes{ 'W', (uint8_t)(milliWave >> 8), (uint8_t)milliWave }), 8);
+  CHECK(bpm == savedBpm);
+  CHECK(std::fabs(waveLengthScale - savedWave) < 0.001f);
+  replies();
+
+  // Brightness changes while streaming ride along with the next frame.
+  rgb = framePayload(NUM_LEDS, 15);
+  feed(packet(0xDA, rgb), 256);
+  CHECK_EQ(FastLED.getBrightness(), 77);
+  replies();
+
+  // 'A' resumes the animation right away.
+  shows = FastLED.showCount();
+  feed(packet(0xC0, Bytes{ 'A' }), 8);
+  for (int i = 0; i < 200; ++i) step();
+  CHECK(FastLED.showCount() > shows + 1);
+  CHECK(!ledsEqual(Bytes(rgb.begin(), rgb.end())));
+  replies();
+
+  // Single-character commands still work between packets while animating.
+  uint8_t palette = gPaletteIndex;
+  feed(Bytes{ 'n' }, 1);
+  CHECK_EQ(gPaletteIndex, palette + 1);
+
+  // A pattern upload replaces the virtual pattern from the next frame on.
+  for (int i = 0; i < 5000 && (paletteFadeActive() || VirtualLedsRebuildPending()); ++i) step();
+  Bytes pattern;
+  for (int i = 0; i < 50; ++i) {
+    pattern.push_back(10);
+    pattern.push_back(20);
+    pattern.push_back(30);
+  }
+  feed(packet(0xDB, pattern), 64);
+  CHECK(replies() == std::string(1, (char)STREAM_ACK));
+  for (int i = 0; i < 100; ++i) step();
+  CHECK_EQ(gVirtualLedCount, 50);
+  CHECK(leds[0] == CRGB(10, 20, 30));
+  CHECK(leds[NUM_LEDS - 1] == CRGB(10, 20, 30));
+  feed(packet(0xDB, Bytes(4, 0)), 64);  // not whole pixels
+  CHECK(replies() == std::string(1, (char)STREAM_NAK));
+
+  // Streaming ends by itself STREAM_TIMEOUT_MS after the last frame.
+  rgb = framePayload(NUM_LEDS, 16);
+  feed(packet(0xDA, rgb), 256);
+  replies();
+  shows = FastLED.showCount();
+  for (unsigned long t = 0; t < STREAM_TIMEOUT_MS; t += 10) step(10000);
+  CHECK_EQ(FastLED.showCount(), shows);
+  for (int i = 0; i < 100; ++i) step(10000);
+  CHECK(FastLED.showCount() > shows);
+  CHECK(leds[0] == CRGB(10, 20, 30));
+
+  // A rebuild requested halfway through a pattern upload (a palette fade
+  // step, the wave knob) wins: the upload is rejected and writes nothing
+  // more, neither into the rebuilt pattern nor, once that is swapped in,
+  // into the pattern being rendered.
+  Bytes odd;
+  for (int i = 0; i < 50; ++i) {
+    odd.push_back(1);
+    odd.push_back(2);
+    odd.push_back(3);
+  }
+  const Bytes upload = packet(0xDB, odd);
+  const size_t half = upload.size() / 2;
+  feed(Bytes(upload.begin(), upload.begin() + half), 64);
+  RequestVirtualLedsRebuild(waveLengthScale);
+  for (int i = 0; i < 1000 && VirtualLedsRebuildPending(); ++i) step(50);
+  CHECK(!VirtualLedsRebuildPending());
+  const long rebuilt = gVirtualLedCount;
+  feed(Bytes(upload.begin() + half, upload.end()), 64);
+  CHECK(replies() == std::string(1, (char)STREAM_NAK));
+  for (int i = 0; i < 100; ++i) step();
+  CHECK_EQ(gVirtualLedCount, rebuilt);
+  for (int i = 0; i < NUM_LEDS; ++i) CHECK(leds[i] != CRGB(1, 2, 3));
+
+  return checkSummary();
+}
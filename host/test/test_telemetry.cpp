@@ -0,0 +1,99 @@
+// Frame-time telemetry: bucket boundaries, saturation-free counting, the
+// serial report, and the probes and current estimates the sketch records
+// per loop() and scheduler task.
+
+#include <Arduino.h>
+#include <FastLED.h>
+#include "config.h"
+#include "telemetry.h"
+#include "check.h"
+
+#include <string>
+
+void setup();
+void loop();
+
+namespace {
+
+// Records one sample of `micros` µs through a Timer on the virtual clock.
+void sample(tel::Probe probe, unsigned long micros) {
+  tel::Timer timer;
+  host::advanceMicros(micros);
+  timer.stop(probe);
+}
+
+std::string report() {
+  host::serialTakeOutput();
+  tel::report();
+  return host::serialTakeOutput();
+}
+
+// The line of the report for one probe.
+std::string line(const std::string& text, const std::string& name) {
+  size_t start = text.find("[TEL] " + name + " ");
+  if (start == std::string::npos) return "";
+  return text.substr(start, text.find('\r', start) - start);
+}
+
+}  // namespace
+
+int main() {
+  host::serialEcho(false);
+  host::serialCapture(true);
+  CHECK(tel::enabled);
+
+  // Bucket b holds [2^(b-1), 2^b) µs; the last one everything above.
+  tel::reset();
+  sample(tel::Probe::Render, 0);
+  sample(tel::Probe::Render, 1);
+  sample(tel::Probe::Render, 2);
+  sample(tel::Probe::Render, 3);
+  sample(tel::Probe::Render, 1000);
+  sample(tel::Probe::Render, 100000);
+  tel::missedFrames(3);
+  std::string text = report();
+  CHECK(text.find("late 1, skipped frames 3") != std::string::npos);
+  CHECK_EQ(line(text, "render").compare("[TEL] render n=6 avg=16834 max=100000 hist=1 1 2 0 0 0 0 0 0 0 1 0 0 0 0 1"), 0);
+  CHECK_EQ(line(text, "show").compare("[TEL] show n=0 avg=0 max=0 hist=0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0"), 0);
+  CHECK_EQ(line(text, "power").compare("[TEL] power n=0 avg=0 max=0 limited=0 (mA)"), 0);
+
+  // Reset clears everything.
+  tel::reset();
+  text = report();
+  CHECK(text.find("late 0, skipped frames 0") != std::string::npos);
+  CHECK(line(text, "render").find("n=0 ") != std::string::npos);
+
+  // The sketch answers 't' with a report; over one virtual second at
+  // 5 BPM / 300 LEDs it shows 25 frames and idles the other loops.
+  setup();
+  host::advanceMicros(1000);
+  loop();
+  const uint8_t clear[] = { 'T' };
+  host::serialFeed(clear, sizeof(clear));
+  loop();
+  for (int i = 0; i < 1000; ++i) {
+    host::advanceMicros(1000);
+    loop();
+  }
+  host::serialTakeOutput();
+  const uint8_t ask[] = { 't' };
+  host::serialFeed(ask, sizeof(ask));
+  loop();
+  text = host::serialTakeOutput();
+  CHECK(line(text, "frame").find("n=25 ") != std::string::npos);
+  CHECK(line(text, "show").find("n=25 ") != std::string::npos);
+  CHECK(line(text, "render").find("n=25 ") != std::string::npos);
+  // The sensor is a 5 ms scheduler task; the scheduler lines follow.
+  CHECK(line(text, "sensor").find("n=200 ") != std::string::npos);
+  CHECK(text.find("[SCHED] ranging n=200 ") != std::string::npos);
+  CHECK(text.find("[SCHED] frame n=") != std::string::npos);
+  CHECK(line(text, "idle").find("n=976 ") != std::string::npos);
+  // Every shown frame has a current estimate; no limit is set here.
+  CHECK(line(text, "power").find("n=25 ") != std::string::npos);
+  CHECK(line(text, "power").find(" limited=0 (mA)") != std::string::npos);
+  CHECK(line(text, "power").find("max=0 ") == std::string::npos);
+  // RESOLUTION 1 leaves no quality level to drop to.
+  CHECK_EQ(line(text, "quality").compare("[TEL] quality level=0 step=1 max=0 changes=0"), 0);
+
+  return checkSummary();
+}
@@ -0,0 +1,113 @@
+// Ultrasound driver against a simulated HC-SR04: the trigger pulse is seen
+// through the digitalWrite hook, and the echo edges are replayed on the echo
+// pin at exact virtual times, firing the driver's interrupt handler.
+
+#include <Arduino.h>
+#include "config.h"
+#include "ultrasound.h"
+#include "echo_timer.h"
+#include "check.h"
+
+namespace {
+
+struct SimulatedSensor {
+  unsigned int distanceCm = 0;  // 0 = no echo (sensor times out)
+  unsigned long riseAt = 0;
+  unsigned long fallAt = 0;
+  bool pending = false;
+  int triggers = 0;
+};
+
+SimulatedSensor sensor;
+
+// HC-SR04 timing: echo starts ~450 µs after the trigger; without an echo the
+// pulse stays high for ~38 ms.
+void onWrite(uint8_t pin, uint8_t level) {
+  if (pin != US_TRIG_PIN || level != LOW) return;
+  ++sensor.triggers;
+  sensor.riseAt = micros() + 450;
+  unsigned long width = sensor.distanceCm ? sensor.distanceCm * US_ROUNDTRIP_CM : 38000;
+  sensor.fallAt = sensor.riseAt + width;
+  sensor.pending = true;
+}
+
+unsigned long now() {
+  return micros();
+}
+
+// Moves the virtual clock to t, replaying echo edges that fall in between.
+void advanceTo(unsigned long t) {
+  if (sensor.pending && sensor.riseAt <= t && host::digitalLevel(US_ECHO_PIN) == LOW) {
+    host::setMicros(sensor.riseAt);
+    host::setDigitalInput(US_ECHO_PIN, HIGH);
+  }
+  if (sensor.pending && sensor.fallAt <= t) {
+    host::setMicros(sensor.fallAt);
+    host::setDigitalInput(US_ECHO_PIN, LOW);
+    sensor.pending = false;
+  }
+  host::setMicros(t);
+}
+
+// Runs the driver every 200 µs for `ms` milliseconds. Returns the last
+// reading (0 if none) and records the longest single update call.
+float run(unsigned long ms, unsigned long* longestCall) {
+  float reading = 0;
+  const unsigned long end = now() + ms * 1000UL;
+  while (now() < end) {
+    advanceTo(now() + 200);
+    unsigned long before = now();
+    ultrasoundUpdate();
+    unsigned long spent = now() - before;
+    if (spent > *longestCall) *longestCall = spent;
+    if (ultrasoundHasReading()) reading = ultrasoundRead_cm();
+  }
+  return reading;
+}
+
+}  // namespace
+
+int main() {
+  host::serialEcho(false);
+  host::onDigitalWrite(onWrite);
+  host::setMicros(1000000);
+  ultrasoundSetup();
+
+  unsigned long longest = 0;
+
+  // In-range targets are measured to the centimetre.
+  const unsigned int distances[] = { 5, 12, 20, 33, US_MAX_DISTANCE_CM };
+  for (unsigned int cm : distances) {
+    sensor.distanceCm = cm;
+    CHECK_EQ((long)run(130, &longest), cm);
+  }
+
+  // Pings are paced at 60 ms.
+  int before = sensor.triggers;
+  run(600, &longest);
+  CHECK(sensor.triggers - before >= 9 && sensor.triggers - before <= 11);
+
+  // Beyond the range: no reading at all.
+  sensor.distanceCm = US_MAX_DISTANCE_CM + 20;
+  run(130, &longest);
+  CHECK(!ultrasoundHasReading());
+  run(130, &longest);
+  CHECK(!ultrasoundHasReading());
+
+  // No echo: the sensor holds ECHO high for 38 ms and the driver waits it
+  // out instead of re-triggering into a busy sensor.
+  sensor.distanceCm = 0;
+  before = sensor.triggers;
+  run(200, &longest);
+  CHECK(!ultrasoundHasReading());
+  CHECK(sensor.triggers - before <= 3);
+
+  // And it recovers once a target is back.
+  sensor.distanceCm = 18;
+  CHECK_EQ((long)run(200, &longest), 18);
+
+  // The loop is never held for more than the trigger pulse, whatever the range.
+  CHECK(longest <= 10);
+
+  return checkSummary();
+}
@@ -0,0 +1,191 @@
+// Ultrasound array: three simulated HC-SR04s (US_SENSORS in the host
+// config) pinged in turn. Checks the round-robin order, that no sensor is
+// triggered while another's ping is out or within US_GUARD_MS of its echo,
+// the per-sensor readings and their median, and the LEDs each sensor dims.
+
+#include <Arduino.h>
+#include <FastLED.h>
+#include "config.h"
+#include "ultrasound.h"
+#include "echo_timer.h"
+#include "check.h"
+
+#include <vector>
+
+extern CRGB leds[];
+void setup();
+void setLeds();
+void handleUltrasound();
+
+namespace {
+
+struct SimulatedSensor {
+  uint8_t trig;
+  uint8_t echo;
+  unsigned int distanceCm;  // 0 = no echo (sensor times out)
+  unsigned int spikeCm;     // answered once instead of distanceCm
+  unsigned long riseAt;
+  unsigned long fallAt;
+  bool pending;
+  bool trigHigh;
+};
+
+SimulatedSensor sensors[] = {
+  { 7, 2, 10, 0, 0, 0, false, false },
+  { 8, 3, 20, 0, 0, 0, false, false },
+  { 9, 18, 30, 0, 0, 0, false, false },
+};
+constexpr uint8_t kSensors = sizeof(sensors) / sizeof(sensors[0]);
+
+struct Trigger {
+  uint8_t sensor;
+  unsigned long at;
+};
+std::vector<Trigger> triggers;
+// Triggers while another sensor's echo was still to come. The tail of a
+// no-echo pulse does not count: that ping is long gone, and the driver
+// ignores the sensor until it is its turn again.
+int overlaps = 0;
+
+// A trigger is the falling edge of a pulse on TRIG.
+void onWrite(uint8_t pin, uint8_t level) {
+  for (uint8_t s = 0; s < kSensors; ++s) {
+    SimulatedSensor& sensor = sensors[s];
+    if (pin != sensor.trig) continue;
+    const bool pulse = sensor.trigHigh && level == LOW;
+    sensor.trigHigh = level == HIGH;
+    if (!pulse) continue;
+    for (const SimulatedSensor& other : sensors) {
+      if (other.pending && other.fallAt - other.riseAt < 38000) ++overlaps;
+    }
+    triggers.push_back({ s, micros() });
+    const unsigned int cm = sensor.spikeCm ? sensor.spikeCm : sensor.distanceCm;
+    sensor.spikeCm = 0;
+    sensor.riseAt = micros() + 450;
+    sensor.fallAt = sensor.riseAt + (cm ? cm * US_ROUNDTRIP_CM : 38000);
+    sensor.pending = true;
+  }
+}
+
+unsigned long now() {
+  return micros();
+}
+
+// Moves the virtual clock to t, replaying echo edges that fall in between.
+void advanceTo(unsigned long t) {
+  for (SimulatedSensor& sensor : sensors) {
+    if (sensor.pending && sensor.riseAt <= t && host::digitalLevel(sensor.echo) == LOW) {
+      host::setMicros(sensor.riseAt);
+      host::setDigitalInput(sensor.echo, HIGH);
+    }
+    if (sensor.pending && sensor.fallAt <= t) {
+      host::setMicros(sensor.fallAt);
+      host::setDigitalInput(sensor.echo, LOW);
+      sensor.pending = false;
+    }
+  }
+  host::setMicros(t);
+}
+
+float lastReading[kSensors];
+int readings[kSensors];
+std::vector<float> seen[kSensors];
+
+// Runs the driver every 200 µs for `ms` milliseconds, collecting each
+// sensor's readings and the longest single update call.
+void run(unsigned long ms, unsigned long* longestCall) {
+  const unsigned long end = now() + ms * 1000UL;
+  while (now() < end) {
+    advanceTo(now() + 200);
+    unsigned long before = now();
+    ultrasoundUpdate();
+    unsigned long spent = now() - before;
+    if (spent > *longestCall) *longestCall = spent;
+    for (uint8_t s = 0; s < kSensors; ++s) {
+      if (!ultrasoundHasReading(s)) continue;
+      lastReading[s] = ultrasoundRead_cm(s);
+      seen[s].push_back(lastReading[s]);
+      ++readings[s];
+    }
+  }
+}
+
+}  // namespace
+
+int main() {
+  host::serialEcho(false);
+  host::onDigitalWrite(onWrite);
+  host::setMicros(1000000);
+  ultrasoundSetup();
+  CHECK_EQ(US_SENSOR_COUNT, kSensors);
+
+  unsigned long longest = 0;
+
+  // Every sensor reads its own target.
+  run(1000, &longest);
+  for (uint8_t s = 0; s < kSensors; ++s) {
+    CHECK(readings[s] > 0);
+    CHECK_EQ((long)lastReading[s], sensors[s].distanceCm);
+  }
+
+  // Sensors are pinged in turn, one at a time, each at most every 60 ms
+  // and never within US_GUARD_MS of the previous ping's echo.
+  CHECK(triggers.size() >= 3 * kSensors);
+  CHECK_EQ(overlaps, 0);
+  for (size_t i = 1; i < triggers.size(); ++i) {
+    const Trigger& prev = triggers[i - 1];
+    CHECK_EQ(triggers[i].sensor, (prev.sensor + 1) % kSensors);
+    const unsigned long echoEnd = 450 + sensors[prev.sensor].distanceCm * US_ROUNDTRIP_CM;
+    CHECK(triggers[i].at - prev.at >= echoEnd + US_GUARD_MS * 1000UL);
+    if (i >= kSensors) CHECK(triggers[i].at - triggers[i - kSensors].at >= 60000UL);
+  }
+
+  // A single stray echo does not move the median.
+  for (uint8_t s = 0; s < kSensors; ++s) seen[s].clear();
+  sensors[1].spikeCm = 6;
+  run(1000, &longest);
+  CHECK(!seen[1].empty());
+  for (float cm : seen[1]) CHECK_EQ((long)cm, 20);
+
+  // A target that moves is followed once most of the window agrees.
+  sensors[1].distanceCm = 25;
+  run(1000, &longest);
+  CHECK_EQ((long)lastReading[1], 25);
+
+  // A sensor that loses its target stops reading; the others carry on
+  // while it waits out its 38 ms no-echo pulses.
+  sensors[2].distanceCm = 0;
+  run(500, &longest);
+  readings[0] = readings[2] = 0;
+  run(1000, &longest);
+  CHECK_EQ(readings[2], 0);
+  CHECK(readings[0] > 0);
+  CHECK_EQ(overlaps, 0);
+
+  // The loop is never held for more than one trigger pulse.
+  CHECK(longest <= 10);
+
+  // Each sensor sits over its own LEDs.
+  long first = -1, count = -1;
+  ultrasoundSpan(1, first, count);
+  CHECK_EQ(first, 100);
+  CHECK_EQ(count, 100);
+
+  // In the sketch a near target leaves its LEDs lit, a far one dims them.
+  setup();
+  sensors[0].distanceCm = US_MIN_DISTANCE_CM;
+  sensors[1].distanceCm = (US_MIN_DISTANCE_CM + US_MAX_DISTANCE_CM) / 2;
+  sensors[2].distanceCm = US_MAX_DISTANCE_CM;
+  for (int i = 0; i < 5000; ++i) {
+    advanceTo(now() + 200);
+    handleUltrasound();
+  }
+  setLeds();
+  long lit[kSensors] = {};
+  for (int i = 0; i < NUM_LEDS; ++i) lit[i / 100] += leds[i].r + leds[i].g + leds[i].b;
+  CHECK(lit[0] > 0);
+  CHECK(lit[1] > 0 && lit[1] < lit[0]);
+  CHECK_EQ(lit[2], 0);
+
+  return checkSummary();
+}
@@ -0,0 +1,82 @@
+// Double-buffered virtual pattern: a background rebuild never changes what
+// is rendered until it is complete, takes effect at the next frame, and
+// produces the same pattern as a synchronous rebuild.
+
+#include <Arduino.h>
+#include <FastLED.h>
+#include "config.h"
+#include "animation.h"
+#include "check.h"
+
+#include <vector>
+
+namespace {
+
+std::vector<CRGB> snapshot() {
+  return std::vector<CRGB>(leds, leds + NUM_LEDS);
+}
+
+bool same(const std::vector<CRGB>& a, const std::vector<CRGB>& b) {
+  for (size_t i = 0; i < a.size(); ++i) {
+    if (a[i] != b[i]) return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+int main() {
+  host::serialEcho(false);
+  currentPalette = RainbowColors_p;
+
+  // Reference: the frame a synchronous rebuild at scale 1.7 produces.
+  RebuildVirtualLeds(1.7f, 1);
+  const long longCount = gVirtualLedCount;
+  FillLEDsFromPaletteColors(42, 1, 1.7f);
+  const std::vector<CRGB> target = snapshot();
+
+  RebuildVirtualLeds(0.5f, 1);
+  const long shortCount = gVirtualLedCount;
+  const CRGB* shortPattern = gVirtualLeds;
+  FillLEDsFromPaletteColors(42, 1, 0.5f);
+  const std::vector<CRGB> before = snapshot();
+  CHECK(!same(before, target));
+
+  // Rebuild in small steps; every intermediate frame still shows the old pattern.
+  RequestVirtualLedsRebuild(1.7f);
+  int steps = 0;
+  while (!StepVirtualLedsRebuild(16)) {
+    ++steps;
+    FillLEDsFromPaletteColors(42, 1, 1.7f);
+    CHECK(same(snapshot(), before));
+    CHECK_EQ(gVirtualLedCount, shortCount);
+    CHECK(gVirtualLeds == shortPattern);
+  }
+  CHECK_EQ(steps, (longCount + 15) / 16 - 1);
+
+  // Completed, but not yet swapped: the pattern changes at the next frame.
+  CHECK_EQ(gVirtualLedCount, shortCount);
+  FillLEDsFromPaletteColors(42, 1, 1.7f);
+  CHECK_EQ(gVirtualLedCount, longCount);
+  CHECK(same(snapshot(), target));
+  CHECK(gVirtualLeds != shortPattern);
+
+  // A new request restarts an unfinished rebuild with the latest scale.
+  RequestVirtualLedsRebuild(3.0f);
+  StepVirtualLedsRebuild(10);
+  RequestVirtualLedsRebuild(0.5f);
+  while (!StepVirtualLedsRebuild(10)) {
+  }
+  FillLEDsFromPaletteColors(42, 1, 0.5f);
+  CHECK_EQ(gVirtualLedCount, shortCount);
+  CHECK(same(snapshot(), before));
+
+  // Stepping with nothing requested is a no-op.
+  CHECK(!StepVirtualLedsRebuild(100));
+
+  // Scales beyond the arena are capped to VIRTUAL_LEDS_MAX.
+  RebuildVirtualLeds(WAVE_LENGTH_SCALE_MAX * 10, 1);
+  CHECK(gVirtualLedCount <= VIRTUAL_LEDS_MAX);
+
+  return checkSummary();
+}
@@ -0,0 +1,163 @@
+// Independent zones: the pattern arena (zones with the same palette and
+// pattern length sharing one pattern), every zone pixel against a per-pixel
+// reference of its own palette, speed, fold and direction, dark gaps and
+// extra strips, and the sketch showing the zones through the "zones"
+// effect. Built for the HOST_ZONES variant (config/config_override.h).
+
+#include <Arduino.h>
+#include <FastLED.h>
+#include "config.h"
+#include "animation.h"
+#include "effects.h"
+#include "zones.h"
+#include "check.h"
+
+#include <cstring>
+
+void setup();
+void loop();
+
+namespace {
+
+// The HOST_ZONES table.
+const uint8_t kPalette[] = { 0, 0, 2, 6 };
+const long kFirst[] = { 0, 110, 210, 280 };
+const long kLength[] = { 100, 100, 60, 20 };
+const float kBpm[] = { 5.0f, 10.0f, 12.0f, 2.5f };
+const long kPatternLength[] = { 100, 100, 15, 40 };
+
+// Pattern pixel of a zone, from the palette expanded to 256 entries.
+CRGB referencePattern(uint8_t zone, long index, long count) {
+  CRGBPalette16 palette;
+  paletteLoad(kPalette[zone], palette);
+  const CRGBPalette256 expanded = palette;
+  return expanded[(uint8_t)((index * 256L) / count)];
+}
+
+// One pixel of a zone, mapped as the main strip's per-pixel renderer maps
+// it, with the zone's own pattern and colorShift.
+CRGB referencePixel(uint8_t zone, long physicalIndex, long shift, int resolution) {
+  const LedStrip& strip = zoneStrip(zone);
+  const long folds = strip.parts < 1 ? 1 : strip.parts;
+  const long unique = (strip.length + folds - 1) / folds;
+  const long count = kPatternLength[zone];
+
+  long base = (shift / resolution) % count;
+  if (base < 0) base += count;
+  uint8_t phase = (uint8_t)(shift % resolution);
+  uint8_t blendFactor = (uint8_t)((255L * phase) / resolution);
+
+  long logical = strip.reversed ? (strip.length - physicalIndex - 1) : physicalIndex;
+  long canonical = logical;
+  if (folds > 1) {
+    long section = logical / unique;
+    long offset = logical % unique;
+    canonical = (strip.folded && section % 2 == 1) ? unique - 1 - offset : offset;
+    if (strip.folded && !strip.reversed) canonical = unique - 1 - canonical;
+  }
+  long index = (base + canonical) % count;
+  if (resolution == 1 || blendFactor == 0) return referencePattern(zone, index, count);
+  return blend(referencePattern(zone, index, count), referencePattern(zone, (index + 1) % count, count), blendFactor);
+}
+
+// leds[] and the extra strips hold zonesRender(frame, resolution).
+bool matchesReference(long frame, int resolution) {
+  long end = 0;
+  for (uint8_t z = 0; z < gZoneCount; ++z) {
+    for (long i = end; i < kFirst[z]; ++i) {
+      if (leds[i] != CRGB(CRGB::Black)) return false;
+    }
+    const long shift = zoneFrame(z, frame);
+    for (long i = 0; i < kLength[z]; ++i) {
+      if (zoneStrip(z).leds[i] != referencePixel(z, i, shift, resolution)) {
+        fprintf(stderr, "frame %ld res %d zone %u pixel %ld differs\n", frame, resolution, z, i);
+        return false;
+      }
+    }
+    end = kFirst[z] + kLength[z];
+  }
+  for (long i = end; i < NUM_LEDS; ++i) {
+    if (leds[i] != CRGB(CRGB::Black)) return false;
+  }
+  for (uint8_t s = 0; s < gExtraStripCount; ++s) {
+    for (long i = 0; i < gExtraStrips[s].length; ++i) {
+      if (gExtraStrips[s].leds[i] != CRGB(CRGB::Black)) return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+int main() {
+  host::serialEcho(false);
+
+  // Table and arena: zones 0 and 1 share a pattern, the others own one.
+  CHECK_EQ(gZoneCount, 4);
+  CHECK_EQ(gZonePatternCount, 3);
+  CHECK_EQ(gZoneRamBytes, (uint16_t)((100 + 15 + 40) * sizeof(CRGB)));
+  for (uint8_t z = 0; z < gZoneCount; ++z) {
+    long length = 0;
+    zonePattern(z, length);
+    CHECK_EQ(length, kPatternLength[z]);
+    CHECK(zoneStrip(z).leds == &leds[kFirst[z]]);
+    CHECK_EQ(zoneStrip(z).length, kLength[z]);
+  }
+  long length = 0;
+  CHECK(zonePattern(0, length) == zonePattern(1, length));
+  CHECK(zonePattern(2, length) != zonePattern(0, length));
+  CHECK(zoneStrip(1).reversed);
+  CHECK(zoneStrip(2).folded);
+  CHECK_EQ(zoneStrip(2).parts, 2L);
+
+  // Speed: a beat of the main wave (NUM_LEDS steps at BPM) moves each zone
+  // by its length scaled by its BPM.
+  for (uint8_t z = 0; z < gZoneCount; ++z) {
+    CHECK_EQ(zoneFrame(z, 0), 0L);
+    CHECK_EQ(zoneFrame(z, NUM_LEDS), (long)(kLength[z] * kBpm[z] / BPM));
+  }
+  CHECK_EQ(zoneFrame(1, 3), 2L);  // twice the steps of zone 0, over a third of the rate
+
+  // Every pixel, whole steps and interpolated.
+  uint8_t zones = effectCount();
+  for (uint8_t e = 0; e < effectCount(); ++e) {
+    if (!strcmp(effectName(e), "zones")) zones = e;
+  }
+  CHECK(zones < effectCount());
+  CHECK_EQ(effectRamBytes(zones), gZoneRamBytes);
+  CHECK(effectSelect(zones, 1.0f));
+  const int resolutions[] = { 1, 2, 4 };
+  const long frames[] = { 0, 1, 2, 3, 99, 300, 301, 12345, 1000003 };
+  for (int res : resolutions) {
+    for (long frame : frames) {
+      fill_solid(leds, NUM_LEDS, CRGB::White);
+      effectRender(frame, res, 1.0f);
+      CHECK(matchesReference(frame, res));
+    }
+  }
+
+  // The sketch: 'e' up to the zones, then every shown frame is the zones
+  // at the frame timer's frame (5 BPM, 300 LEDs: one every 40 ms).
+  setup();
+  const unsigned long start = micros();
+  while (effectIndex() != zones) {
+    const uint8_t command = 'e';
+    host::serialFeed(&command, 1);
+    host::advanceMicros(1000);
+    loop();
+  }
+  const unsigned long stop = micros() + 1000000;
+  int checked = 0;
+  while ((long)(micros() - stop) < 0) {
+    host::advanceMicros(1000);
+    const long frame = (long)((micros() - start) / 40000);
+    const unsigned long before = FastLED.showCount();
+    loop();
+    if (FastLED.showCount() == before) continue;
+    CHECK(matchesReference(frame, RESOLUTION));
+    ++checked;
+  }
+  CHECK(checked >= 20);
+
+  return checkSummary();
+}
@@ -0,0 +1,124 @@
+// WAV files for the host audio tests and tools: 8- and 16-bit PCM read
+// (channels mixed to mono), 16-bit mono written, resampling to the
+// sketch's AUDIO_SAMPLE_RATE and conversion to microphone ADC readings.
+//
+//   wav::Audio audio;
+//   wav::read("music.wav", audio);                  // false if unsupported
+//   std::vector<float> mic = wav::resample(audio, AUDIO_SAMPLE_RATE);
+//   audioPush(wav::toAdc(mic[i]));
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace wav {
+
+struct Audio {
+  uint32_t rate = 0;
+  std::vector<float> samples;  // mono, -1..1
+};
+
+namespace detail {
+inline uint32_t le(const uint8_t* p, int bytes) {
+  uint32_t value = 0;
+  for (int i = bytes - 1; i >= 0; --i) value = (value << 8) | p[i];
+  return value;
+}
+inline void put(std::vector<uint8_t>& out, uint32_t value, int bytes) {
+  for (int i = 0; i < bytes; ++i) out.push_back((uint8_t)(value >> (8 * i)));
+}
+}  // namespace detail
+
+inline bool read(const std::string& path, Audio& audio) {
+  FILE* file = fopen(path.c_str(), "rb");
+  if (!file) return false;
+  std::vector<uint8_t> data;
+  uint8_t buffer[4096];
+  size_t n;
+  while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) data.insert(data.end(), buffer, buffer + n);
+  fclose(file);
+  if (data.size() < 12 || memcmp(&data[0], "RIFF", 4) || memcmp(&data[8], "WAVE", 4)) return false;
+
+  uint16_t format = 0, channels = 0, bits = 0;
+  audio.rate = 0;
+  audio.samples.clear();
+  for (size_t at = 12; at + 8 <= data.size();) {
+    const uint32_t size = detail::le(&data[at + 4], 4);
+    const uint8_t* body = &data[at + 8];
+    if (at + 8 + size > data.size()) return false;
+    if (!memcmp(&data[at], "fmt ", 4) && size >= 16) {
+      format = (uint16_t)detail::le(body, 2);
+      channels = (uint16_t)detail::le(body + 2, 2);
+      audio.rate = detail::le(body + 4, 4);
+      bits = (uint16_t)detail::le(body + 14, 2);
+    } else if (!memcmp(&data[at], "data", 4)) {
+      if (format != 1 || channels == 0 || (bits != 8 && bits != 16)) return false;
+      const size_t frame = channels * (bits / 8);
+      for (size_t i = 0; i + frame <= size; i += frame) {
+        float sum = 0;
+        for (uint16_t c = 0; c < channels; ++c) {
+          const uint8_t* p = body + i + c * (bits / 8);
+          sum += bits == 8 ? (p[0] - 128) / 128.0f : (int16_t)detail::le(p, 2) / 32768.0f;
+        }
+        audio.samples.push_back(sum / channels);
+      }
+      return audio.rate > 0;
+    }
+    at += 8 + size + (size & 1);
+  }
+  return false;
+}
+
+inline bool write(const std::string& path, const Audio& audio) {
+  std::vector<uint8_t> out;
+  const uint32_t bytes = (uint32_t)audio.samples.size() * 2;
+  out.insert(out.end(), { 'R', 'I', 'F', 'F' });
+  detail::put(out, 36 + bytes, 4);
+  out.insert(out.end(), { 'W', 'A', 'V', 'E', 'f', 'm', 't', ' ' });
+  detail::put(out, 16, 4);
+  detail::put(out, 1, 2);  // PCM
+  detail::put(out, 1, 2);  // mono
+  detail::put(out, audio.rate, 4);
+  detail::put(out, audio.rate * 2, 4);
+  detail::put(out, 2, 2);
+  detail::put(out, 16, 2);
+  out.insert(out.end(), { 'd', 'a', 't', 'a' });
+  detail::put(out, bytes, 4);
+  for (float s : audio.samples) {
+    const float clipped = s < -1.0f ? -1.0f : s > 1.0f ? 1.0f : s;
+    detail::put(out, (uint16_t)(int16_t)std::lround(clipped * 32767.0f), 2);
+  }
+  FILE* file = fopen(path.c_str(), "wb");
+  if (!file) return false;
+  const bool ok = fwrite(out.data(), 1, out.size(), file) == out.size();
+  return fclose(file) == 0 && ok;
+}
+
+// Averages the input over each output sample period (a box filter against
+// aliasing, as a microphone amplifier's low-pass would).
+inline std::vector<float> resample(const Audio& audio, uint32_t rate) {
+  std::vector<float> out;
+  if (audio.rate == 0 || rate == 0) return out;
+  const double step = (double)audio.rate / rate;
+  for (double at = 0; at + step <= audio.samples.size(); at += step) {
+    const size_t first = (size_t)at;
+    const size_t last = (size_t)(at + step);
+    float sum = 0;
+    for (size_t i = first; i < last; ++i) sum += audio.samples[i];
+    out.push_back(last > first ? sum / (last - first) : audio.samples[first]);
+  }
+  return out;
+}
+
+// 10-bit ADC reading of a microphone amplifier biased to mid-supply, with
+// full scale at +-400 steps.
+inline uint16_t toAdc(float sample) {
+  long value = std::lround(512.0f + sample * 400.0f);
+  return (uint16_t)(value < 0 ? 0 : value > 1023 ? 1023 : value);
+}
+
+}  // namespace wav
@@ -0,0 +1,74 @@
+// Feeds a WAV file through the sketch's beat tracker (audio.h), as the
+// microphone would: resampled to AUDIO_SAMPLE_RATE, one sample every
+// 1 / AUDIO_SAMPLE_RATE s of virtual time.
+//
+// Prints once per --interval seconds (default 1):
+//   AUDIO t=<s> bpm=<tracked BPM, 0 = none> phase=<0-1 beat> bands=<0-255 x 4>
+// and at the end the tracker's cost on this machine:
+//   COST hops=<n> ns/hop=<average wall time of audioProcess()>
+// With --expect-bpm B it exits non-zero unless the last tracked tempo is
+// within 2% of B.
+
+#include <Arduino.h>
+#include "config.h"
+#include "audio.h"
+#include "../test/wav.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+int main(int argc, char** argv) {
+  const char* path = nullptr;
+  double interval = 1.0;
+  double expectBpm = 0.0;
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "--interval") && i + 1 < argc) {
+      interval = atof(argv[++i]);
+    } else if (!strcmp(argv[i], "--expect-bpm") && i + 1 < argc) {
+      expectBpm = atof(argv[++i]);
+    } else if (argv[i][0] != '-' && !path) {
+      path = argv[i];
+    } else {
+      path = nullptr;
+      break;
+    }
+  }
+  wav::Audio audio;
+  if (!path || interval <= 0 || !wav::read(path, audio)) {
+    fprintf(stderr, "usage: %s <8/16-bit PCM .wav> [--interval seconds] [--expect-bpm bpm]\n", argv[0]);
+    return 2;
+  }
+
+  const std::vector<float> mic = wav::resample(audio, AUDIO_SAMPLE_RATE);
+  const unsigned long sampleMicros = 1000000UL / AUDIO_SAMPLE_RATE;
+  const unsigned long intervalMicros = (unsigned long)(interval * 1e6);
+  audioSetup();
+  host::setMicros(0);
+  unsigned long nextReport = intervalMicros;
+  long hops = 0;
+  std::chrono::nanoseconds spent(0);
+  for (size_t i = 0; i < mic.size(); ++i) {
+    host::setMicros(i * sampleMicros);
+    audioPush(wav::toAdc(mic[i]));
+    const auto start = std::chrono::steady_clock::now();
+    while (audioProcess()) ++hops;
+    spent += std::chrono::steady_clock::now() - start;
+
+    if (micros() >= nextReport) {
+      printf("AUDIO t=%.1f bpm=%.2f phase=%.2f bands=%u %u %u %u\n", micros() / 1e6, audioMilliBpm() / 1000.0,
+             audioBeatPhase(micros()) / 65536.0, audioBandLevel(0), audioBandLevel(1), audioBandLevel(2),
+             audioBandLevel(3));
+      nextReport += intervalMicros;
+    }
+  }
+  printf("COST hops=%ld ns/hop=%lld\n", hops, hops ? (long long)(spent.count() / hops) : 0LL);
+
+  if (expectBpm > 0 && std::fabs(audioMilliBpm() / 1000.0 - expectBpm) > expectBpm * 0.02) {
+    fprintf(stderr, "tracked %.2f BPM, expected %.2f\n", audioMilliBpm() / 1000.0, expectBpm);
+    return 1;
+  }
+  return 0;
+}
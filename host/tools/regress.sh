@@ -0,0 +1,11 @@
+#!/bin/sh
+# Golden-frame regression and render timing across the configuration matrix:
+# configures and builds the host tree (Release), then runs the golden suite.
+#
+#   host/tools/regress.sh [build dir]     (default: host/build)
+set -e
+host=$(cd "$(dirname "$0")/.." && pwd)
+build=${1:-$host/build}
+cmake -S "$host" -B "$build" -DCMAKE_BUILD_TYPE=Release
+cmake --build "$build" -j"$(nproc)"
+ctest --test-dir "$build" -L golden --output-on-failure
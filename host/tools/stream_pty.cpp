@@ -0,0 +1,92 @@
+// Runs the sketch against a pseudo-terminal, so a serial client on Linux
+// can talk to it like to a board (see stream_sender.py).
+//
+// Prints "PTY <slave path> <NUM_LEDS>" once, then runs loop() with the
+// virtual clock following wall time. After every FastLED.show() it prints
+// "SHOW <FNV-1a of leds[]> <brightness>", which lets a scripted sender check
+// what reached the strip. Stops after --seconds (default 30).
+
+#include <Arduino.h>
+#include <FastLED.h>
+#include "config.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+void setup();
+void loop();
+extern CRGB leds[];
+
+namespace {
+
+uint32_t fnv1a(const uint8_t* data, size_t len) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < len; ++i) {
+    hash = (hash ^ data[i]) * 16777619u;
+  }
+  return hash;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  double seconds = 30.0;
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "--seconds") && i + 1 < argc) {
+      seconds = atof(argv[++i]);
+    } else {
+      fprintf(stderr, "usage: %s [--seconds N]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+    perror("posix_openpt");
+    return 1;
+  }
+  const char* path = ptsname(master);
+  // Keep a slave handle open: raw mode for whoever opens it next, and no
+  // hangup on the master while no client is connected.
+  int slave = open(path, O_RDWR | O_NOCTTY);
+  if (slave < 0) {
+    perror(path);
+    return 1;
+  }
+  termios tio;
+  tcgetattr(slave, &tio);
+  cfmakeraw(&tio);
+  tcsetattr(slave, TCSANOW, &tio);
+  fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+
+  setvbuf(stdout, nullptr, _IOLBF, 0);
+  host::serialAttachFd(master);
+  setup();
+  printf("PTY %s %d\n", path, NUM_LEDS);
+
+  const auto start = std::chrono::steady_clock::now();
+  const unsigned long base = micros();
+  unsigned long shows = FastLED.showCount();
+  for (;;) {
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (elapsed > seconds) break;
+    host::setMicros(base + (unsigned long)(elapsed * 1e6));
+    loop();
+    if (FastLED.showCount() != shows) {
+      shows = FastLED.showCount();
+      printf("SHOW %08x %d\n", fnv1a((const uint8_t*)leds, sizeof(CRGB) * NUM_LEDS), FastLED.getBrightness());
+    }
+    // Sleep until input arrives, or for 1 ms.
+    pollfd input = { master, POLLIN, 0 };
+    poll(&input, 1, 1);
+  }
+  close(slave);
+  close(master);
+  return 0;
+}
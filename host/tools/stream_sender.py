@@ -0,0 +1,214 @@
+#!/usr/bin/env python3
+"""Scripted sender for the binary serial streaming protocol (stream.h).
+
+Streams frames to a board, or checks the protocol end to end against the
+host build running on a pseudo-terminal:
+
+  stream_sender.py /dev/ttyACM0 --baud 500000 --leds 300   # rainbow demo
+  stream_sender.py --spawn build/stream_pty_n300_p1      # protocol checks
+
+Frames are sent stop-and-wait: the next frame goes out when the previous
+one has been acknowledged (0x06), i.e. once it was handed to FastLED.show().
+A NAK (0x15) or a missing reply resends the frame.
+"""
+
+import argparse
+import colorsys
+import os
+import queue
+import select
+import subprocess
+import sys
+import termios
+import threading
+import time
+import tty
+
+ACK = 0x06
+NAK = 0x15
+FRAME = 0xDA
+PATTERN = 0xDB
+COMMAND = 0xC0
+
+
+def packet(kind, payload):
+    """0xC9 type size payload sum2 sum1 0x36, Fletcher-16 over type..payload."""
+    body = bytes([kind, len(payload) >> 8, len(payload) & 0xFF]) + bytes(payload)
+    sum1 = sum2 = 0
+    for b in body:
+        sum1 = (sum1 + b) % 255
+        sum2 = (sum2 + sum1) % 255
+    return b"\xC9" + body + bytes([sum2, sum1, 0x36])
+
+
+def fnv1a(data):
+    h = 2166136261
+    for b in data:
+        h = ((h ^ b) * 16777619) & 0xFFFFFFFF
+    return h
+
+
+def open_serial(path, baud):
+    fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+    tty.setraw(fd)
+    attrs = termios.tcgetattr(fd)
+    speed = getattr(termios, "B%d" % baud)
+    attrs[4] = attrs[5] = speed
+    termios.tcsetattr(fd, termios.TCSANOW, attrs)
+    termios.tcflush(fd, termios.TCIOFLUSH)
+    return fd
+
+
+def reply(fd, timeout):
+    """Waits for an ACK or NAK; other bytes (debug output) are skipped."""
+    deadline = time.monotonic() + timeout
+    while True:
+        left = deadline - time.monotonic()
+        if left <= 0 or not select.select([fd], [], [], left)[0]:
+            return None
+        for b in os.read(fd, 256):
+            if b in (ACK, NAK):
+                return b
+
+
+def send(fd, data, timeout=0.5, retries=5):
+    """Sends a packet until it is acknowledged; returns the number of tries."""
+    for attempt in range(1, retries + 1):
+        os.write(fd, data)
+        if reply(fd, timeout) == ACK:
+            return attempt
+    raise RuntimeError("no ACK after %d tries" % retries)
+
+
+def rainbow(leds, phase):
+    out = bytearray()
+    for i in range(leds):
+        r, g, b = colorsys.hsv_to_rgb(((i / leds) + phase) % 1.0, 1.0, 1.0)
+        out += bytes([int(r * 255), int(g * 255), int(b * 255)])
+    return bytes(out)
+
+
+def demo(args):
+    fd = open_serial(args.port, args.baud)
+    time.sleep(2.0)  # most boards reset when the port opens
+    start = time.monotonic()
+    for n in range(args.frames):
+        send(fd, packet(FRAME, rainbow(args.leds, n / 100.0)))
+    elapsed = time.monotonic() - start
+    print("%d frames in %.2f s: %.1f frames/s" % (args.frames, elapsed, args.frames / elapsed))
+    send(fd, packet(COMMAND, b"A"))
+    return 0
+
+
+class Sketch:
+    """The host build on a pty; collects its SHOW lines in the background."""
+
+    def __init__(self, exe):
+        self.proc = subprocess.Popen([exe, "--seconds", "60"], stdout=subprocess.PIPE, text=True)
+        header = self.proc.stdout.readline().split()
+        if len(header) != 3 or header[0] != "PTY":
+            raise RuntimeError("unexpected output: %r" % header)
+        self.path, self.leds = header[1], int(header[2])
+        self.shows = queue.Queue()
+        threading.Thread(target=self._collect, daemon=True).start()
+
+    def _collect(self):
+        for line in self.proc.stdout:
+            parts = line.split()
+            if parts and parts[0] == "SHOW":
+                self.shows.put((int(parts[1], 16), int(parts[2])))
+
+    def drain(self):
+        seen = []
+        while not self.shows.empty():
+            seen.append(self.shows.get())
+        return seen
+
+    def next_show(self, timeout=2.0):
+        return self.shows.get(timeout=timeout)
+
+    def close(self):
+        self.proc.terminate()
+        self.proc.wait()
+
+
+def check(args):
+    sketch = Sketch(args.spawn)
+    failures = []
+
+    def expect(cond, what):
+        if not cond:
+            failures.append(what)
+            print("FAIL: " + what, file=sys.stderr)
+
+    try:
+        fd = open_serial(sketch.path, 115200)
+        leds = sketch.leds
+
+        # The first frame takes the strip over from the animation.
+        send(fd, packet(FRAME, rainbow(leds, 0.0)))
+        time.sleep(0.1)
+        sketch.drain()
+
+        # Every acknowledged frame is shown exactly as sent, in order.
+        frames = [rainbow(leds, n / 50.0) for n in range(args.frames)]
+        start = time.monotonic()
+        tries = 0
+        for rgb in frames:
+            tries += send(fd, packet(FRAME, rgb))
+            expect(sketch.next_show()[0] == fnv1a(rgb), "frame shown as sent")
+        elapsed = time.monotonic() - start
+        expect(tries == len(frames), "no resends on a clean line")
+        print("%d frames stop-and-wait in %.3f s: %.0f frames/s" % (len(frames), elapsed, len(frames) / elapsed))
+
+        # A corrupted frame is refused and never shown.
+        bad = bytearray(packet(FRAME, rainbow(leds, 0.5)))
+        bad[10] ^= 0x01
+        os.write(fd, bytes(bad))
+        expect(reply(fd, 1.0) == NAK, "corrupted frame refused")
+        time.sleep(0.05)
+        expect(sketch.drain() == [], "corrupted frame not shown")
+
+        # Commands are acknowledged; brightness shows with the next frame.
+        expect(send(fd, packet(COMMAND, bytes([ord("B"), 40]))) == 1, "brightness command")
+        rgb = rainbow(leds, 0.25)
+        send(fd, packet(FRAME, rgb))
+        expect(sketch.next_show() == (fnv1a(rgb), 40), "frame shown at new brightness")
+
+        # Adalight frames are shown too (Adalight senders ignore replies).
+        rgb = rainbow(leds, 0.75)
+        count = leds - 1
+        os.write(fd, b"Ada" + bytes([count >> 8, count & 0xFF, (count >> 8) ^ (count & 0xFF) ^ 0x55]) + rgb)
+        expect(sketch.next_show()[0] == fnv1a(rgb), "Adalight frame shown")
+        reply(fd, 0.2)
+
+        # 'A' hands the strip back to the animation, which shows on its own.
+        send(fd, packet(COMMAND, b"A"))
+        sketch.drain()
+        time.sleep(0.5)
+        expect(len(sketch.drain()) > 0, "animation resumed")
+        os.close(fd)
+    finally:
+        sketch.close()
+
+    print("%d failure(s)" % len(failures))
+    return 1 if failures else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("port", nargs="?", help="serial device of the board")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--leds", type=int, default=300, help="NUM_LEDS of the board")
+    parser.add_argument("--frames", type=int, default=200)
+    parser.add_argument("--spawn", help="run the protocol checks against this host build (stream_pty_*)")
+    args = parser.parse_args()
+    if args.spawn:
+        return check(args)
+    if not args.port:
+        parser.error("a serial port or --spawn is required")
+    return demo(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())